@@ -0,0 +1,75 @@
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+template <template <typename> class Allocator> using IntTree = RedBlackTree<int, std::less<int>, Allocator>;
+
+std::vector<int> random_keys(size_t size) {
+    std::mt19937 rng(42);
+    std::vector<int> keys(size);
+    for (auto &key : keys) {
+        key = static_cast<int>(rng());
+    }
+    return keys;
+}
+
+// Fill the tree and destroy it
+template <template <typename> class Allocator> void BM_build_destroy(benchmark::State &state) {
+    std::vector<int> keys = random_keys(state.range(0));
+    for (auto _ : state) {
+        IntTree<Allocator> tree;
+        for (auto &key : keys) {
+            tree.insert(key);
+        }
+        benchmark::DoNotOptimize(tree.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Only destroy already filled tree
+template <template <typename> class Allocator> void BM_destroy(benchmark::State &state) {
+    std::vector<int> keys = random_keys(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto tree = std::make_unique<IntTree<Allocator>>();
+        for (auto &key : keys) {
+            tree->insert(key);
+        }
+        state.ResumeTiming();
+        tree.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Erase and insert keys in the tree of the constant size
+template <template <typename> class Allocator> void BM_churn(benchmark::State &state) {
+    std::vector<int> keys = random_keys(state.range(0));
+    IntTree<Allocator> tree;
+    for (auto &key : keys) {
+        tree.insert(key);
+    }
+
+    std::mt19937 rng(7);
+    for (auto _ : state) {
+        int &key = keys[rng() % keys.size()];
+        tree.erase(key);
+        key = static_cast<int>(rng());
+        tree.insert(key);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_build_destroy<NewDeleteAllocator>)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_build_destroy<PoolAllocator>)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_destroy<NewDeleteAllocator>)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_destroy<PoolAllocator>)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_churn<NewDeleteAllocator>)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_churn<PoolAllocator>)->RangeMultiplier(10)->Range(1000, 1000000);
+
+} // namespace Benchmarks
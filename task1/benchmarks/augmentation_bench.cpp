@@ -0,0 +1,54 @@
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+using SumTree = RedBlackTree<int, std::less<int>, NewDeleteAllocator, TreeNode<int, SumAugmentation<int64_t>>>;
+
+// Tree of 10^6 keys 0, 1, ..., sums are taken over the ranges of the given width
+constexpr int AggregateTreeSize = 1000000;
+
+template <typename TreeT> TreeT aggregate_tree() {
+    std::vector<int> keys(AggregateTreeSize);
+    for (int i = 0; i < AggregateTreeSize; ++i) {
+        keys[i] = i;
+    }
+    return TreeT(keys.begin(), keys.end());
+}
+
+// Sum of the range by walking its keys
+static void BM_range_walk(benchmark::State &state) {
+    auto tree = aggregate_tree<RedBlackTree<int>>();
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> low_dist(0, AggregateTreeSize - state.range(0));
+    for (auto _ : state) {
+        int low = low_dist(rng);
+        int64_t sum = 0;
+        for (auto it = tree.lower_bound(low); it != tree.end() && *it < low + state.range(0); ++it) {
+            sum += *it;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+// Sum of the range from the aggregates of the augmented tree
+static void BM_range_aggregate(benchmark::State &state) {
+    auto tree = aggregate_tree<SumTree>();
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> low_dist(0, AggregateTreeSize - state.range(0));
+    for (auto _ : state) {
+        int low = low_dist(rng);
+        benchmark::DoNotOptimize(tree.aggregate(low, low + state.range(0) - 1));
+    }
+}
+
+BENCHMARK(BM_range_walk)->RangeMultiplier(100)->Range(10, 100000);
+BENCHMARK(BM_range_aggregate)->RangeMultiplier(100)->Range(10, 100000);
+
+} // namespace Benchmarks
@@ -0,0 +1,119 @@
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+using BatchTree = RedBlackTree<int, std::less<int>, PoolAllocator>;
+
+constexpr int BatchTreeSize = 1000000;
+
+std::vector<int> batch_keys(size_t size, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> keys(size);
+    for (auto &key : keys) {
+        key = static_cast<int>(rng());
+    }
+    return keys;
+}
+
+// Insert and erase the batch into the big tree key by key
+void BM_per_key_update(benchmark::State &state) {
+    std::vector<int> keys = batch_keys(BatchTreeSize, 42);
+    BatchTree tree(keys.begin(), keys.end());
+    std::vector<int> batch = batch_keys(state.range(0), 7);
+    for (auto _ : state) {
+        for (auto &key : batch) {
+            tree.insert(key);
+        }
+        for (auto &key : batch) {
+            tree.erase(key);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Insert and erase the batch into the big tree with split and join
+template <Execution execution> void BM_batch_update(benchmark::State &state) {
+    std::vector<int> keys = batch_keys(BatchTreeSize, 42);
+    BatchTree tree(keys.begin(), keys.end());
+    std::vector<int> batch = batch_keys(state.range(0), 7);
+    for (auto _ : state) {
+        tree.insert_batch(batch.begin(), batch.end(), execution);
+        tree.erase_batch(batch.begin(), batch.end(), execution);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Erase every third key, walking the tree and erasing key by key
+void BM_per_key_filter(benchmark::State &state) {
+    std::vector<int> keys = batch_keys(state.range(0), 42);
+    for (auto _ : state) {
+        state.PauseTiming();
+        BatchTree tree(keys.begin(), keys.end());
+        std::vector<int> erased;
+        state.ResumeTiming();
+        for (int key : tree) {
+            if (key % 3 == 0) {
+                erased.push_back(key);
+            }
+        }
+        for (int key : erased) {
+            tree.erase(key);
+        }
+        benchmark::DoNotOptimize(tree.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Erase every third key, joining the surviving subtrees
+template <Execution execution> void BM_filter(benchmark::State &state) {
+    std::vector<int> keys = batch_keys(state.range(0), 42);
+    for (auto _ : state) {
+        state.PauseTiming();
+        BatchTree tree(keys.begin(), keys.end());
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(tree.filter([](int key) { return key % 3 != 0; }, execution));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Sum of all keys by the iteration
+void BM_iterate_sum(benchmark::State &state) {
+    std::vector<int> keys = batch_keys(state.range(0), 42);
+    BatchTree tree(keys.begin(), keys.end());
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (int key : tree) {
+            sum += key;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Sum of all keys by the parallel reduce
+void BM_parallel_reduce(benchmark::State &state) {
+    std::vector<int> keys = batch_keys(state.range(0), 42);
+    BatchTree tree(keys.begin(), keys.end());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tree.parallel_reduce(
+            int64_t{0}, [](int key) { return int64_t{key}; }, std::plus<int64_t>()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_per_key_update)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK(BM_batch_update<Execution::Sequential>)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK(BM_batch_update<Execution::Parallel>)->RangeMultiplier(10)->Range(10000, 1000000)->UseRealTime();
+BENCHMARK(BM_per_key_filter)->RangeMultiplier(10)->Range(100000, 1000000);
+BENCHMARK(BM_filter<Execution::Sequential>)->RangeMultiplier(10)->Range(100000, 1000000);
+BENCHMARK(BM_filter<Execution::Parallel>)->RangeMultiplier(10)->Range(100000, 1000000)->UseRealTime();
+BENCHMARK(BM_iterate_sum)->RangeMultiplier(10)->Range(100000, 1000000);
+BENCHMARK(BM_parallel_reduce)->RangeMultiplier(10)->Range(100000, 1000000)->UseRealTime();
+
+} // namespace Benchmarks
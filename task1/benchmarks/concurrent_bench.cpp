@@ -0,0 +1,67 @@
+#include "concurrent_tree.hpp"
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+constexpr int ReadTreeSize = 1000000;
+
+std::vector<int> read_keys() {
+    std::vector<int> keys(ReadTreeSize);
+    for (int i = 0; i < ReadTreeSize; ++i) {
+        keys[i] = 2 * i;
+    }
+    return keys;
+}
+
+// Lookups from every thread into the shared tree, guarded by the mutex
+void BM_mutex_contains(benchmark::State &state) {
+    static std::mutex mutex;
+    static std::vector<int> keys = read_keys();
+    static RedBlackTree<int> tree(keys.begin(), keys.end());
+
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> key_dist(0, 2 * ReadTreeSize);
+    for (auto _ : state) {
+        int key = key_dist(rng);
+        std::lock_guard<std::mutex> lock(mutex);
+        benchmark::DoNotOptimize(tree.contains(key));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Lock-free lookups from every thread into the shared tree
+// If with_writer, the first thread updates the tree instead
+template <bool WithWriter> void BM_concurrent_contains(benchmark::State &state) {
+    static std::vector<int> keys = read_keys();
+    static ConcurrentRedBlackTree<int> tree(keys.begin(), keys.end());
+
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> key_dist(0, 2 * ReadTreeSize);
+    if (WithWriter && state.thread_index() == 0) {
+        for (auto _ : state) {
+            int key = key_dist(rng);
+            tree.insert(key);
+            tree.erase(key);
+        }
+        state.SetLabel("writer");
+        return;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tree.contains(key_dist(rng)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_mutex_contains)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_concurrent_contains<false>)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_concurrent_contains<true>)->ThreadRange(2, 16)->UseRealTime();
+
+} // namespace Benchmarks
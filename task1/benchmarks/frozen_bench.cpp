@@ -0,0 +1,44 @@
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+// Keys 0, 2, 4, ... of the given size
+static std::vector<int> even_keys(size_t size) {
+    std::vector<int> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    return keys;
+}
+
+// Random lookups of present and absent keys in the big tree, bound by cache misses
+template <typename TreeT> void BM_frozen_lookup(benchmark::State &state) {
+    std::vector<int> keys = even_keys(state.range(0));
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+    TreeT lookup_tree = [&tree]() {
+        if constexpr (std::is_same_v<TreeT, RedBlackTree<int>>) {
+            return std::move(tree);
+        } else {
+            return tree.freeze();
+        }
+    }();
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> key_dist(0, 2 * keys.size());
+    for (auto _ : state) {
+        int key = key_dist(rng);
+        benchmark::DoNotOptimize(lookup_tree.contains(key));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_frozen_lookup<RedBlackTree<int>>)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK(BM_frozen_lookup<FrozenTree<int>>)->RangeMultiplier(10)->Range(1000, 10000000);
+
+} // namespace Benchmarks
@@ -0,0 +1,66 @@
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+// Image of the tree of random keys of the given size, written once per size
+static std::string image_path(size_t size) {
+    std::string path = "image_bench_" + std::to_string(size) + ".image";
+    std::vector<int> keys(size);
+    std::mt19937 rng(42);
+    for (auto &key : keys) {
+        key = rng();
+    }
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+    tree.save(path);
+    return path;
+}
+
+// Startup by inserting the keys of the tree one by one
+static void BM_image_reinsert(benchmark::State &state) {
+    std::vector<int> keys(state.range(0));
+    std::mt19937 rng(42);
+    for (auto &key : keys) {
+        key = rng();
+    }
+    for (auto _ : state) {
+        RedBlackTree<int> tree;
+        for (int key : keys) {
+            tree.insert(key);
+        }
+        benchmark::DoNotOptimize(tree.size());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Startup by building live nodes from the image
+static void BM_image_load(benchmark::State &state) {
+    std::string path = image_path(state.range(0));
+    for (auto _ : state) {
+        RedBlackTree<int> tree;
+        benchmark::DoNotOptimize(tree.load(path));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Startup by mapping the image and using it in place
+static void BM_image_map(benchmark::State &state) {
+    std::string path = image_path(state.range(0));
+    for (auto _ : state) {
+        MappedTree<int> tree;
+        benchmark::DoNotOptimize(tree.load(path));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_image_reinsert)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_image_load)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_image_map)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+} // namespace Benchmarks
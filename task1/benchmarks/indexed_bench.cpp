@@ -0,0 +1,84 @@
+#include "indexed_tree.hpp"
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+using IndexedTree = IndexedRedBlackTree<int>;
+using PooledTree = RedBlackTree<int, std::less<int>, PoolAllocator>;
+
+// Random keys in [0, 2 * size)
+static std::vector<int> random_keys(size_t size, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> key_dist(0, 2 * size);
+    std::vector<int> keys(size);
+    for (int &key : keys) {
+        key = key_dist(rng);
+    }
+    return keys;
+}
+
+// Random lookups in the big tree, bound by cache misses, bytes per node are reported
+template <typename TreeT> void BM_indexed_lookup(benchmark::State &state) {
+    std::vector<int> keys = random_keys(state.range(0), 3);
+    TreeT tree(keys.begin(), keys.end());
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> key_dist(0, 2 * keys.size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tree.contains(key_dist(rng)));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if constexpr (std::is_same_v<TreeT, IndexedTree>) {
+        state.counters["node_bytes"] = TreeT::NodeBytes;
+    } else {
+        state.counters["node_bytes"] = sizeof(TreeNode<int>);
+    }
+}
+
+// Random inserts into the growing tree
+template <typename TreeT> void BM_indexed_insert(benchmark::State &state) {
+    std::vector<int> keys = random_keys(state.range(0), 5);
+    for (auto _ : state) {
+        TreeT tree;
+        for (int key : keys) {
+            tree.insert(key);
+        }
+        benchmark::DoNotOptimize(tree.size());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Split of the tree at the given percent of its keys and join of the parts back. Pointer trees do both in
+// O(log n), indexed tree copies the smaller part out in split and moves it back in join
+template <typename TreeT> void BM_indexed_split_join(benchmark::State &state) {
+    std::vector<int> keys = random_keys(state.range(0), 9);
+    TreeT tree(keys.begin(), keys.end());
+    int split_key = static_cast<int>(2 * keys.size() * state.range(1) / 100);
+
+    for (auto _ : state) {
+        auto [left, right] = tree.split(split_key);
+        left.join(right);
+        tree = std::move(left);
+        benchmark::DoNotOptimize(tree.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_indexed_lookup<RedBlackTree<int>>)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK(BM_indexed_lookup<PooledTree>)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK(BM_indexed_lookup<IndexedTree>)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK(BM_indexed_insert<RedBlackTree<int>>)->RangeMultiplier(100)->Range(1000, 1000000);
+BENCHMARK(BM_indexed_insert<PooledTree>)->RangeMultiplier(100)->Range(1000, 1000000);
+BENCHMARK(BM_indexed_insert<IndexedTree>)->RangeMultiplier(100)->Range(1000, 1000000);
+BENCHMARK(BM_indexed_split_join<RedBlackTree<int>>)->ArgsProduct({{1000, 100000, 1000000}, {1, 10, 50}});
+BENCHMARK(BM_indexed_split_join<PooledTree>)->ArgsProduct({{1000, 100000, 1000000}, {1, 10, 50}});
+BENCHMARK(BM_indexed_split_join<IndexedTree>)->ArgsProduct({{1000, 100000, 1000000}, {1, 10, 50}});
+
+} // namespace Benchmarks
@@ -0,0 +1,56 @@
+#include "interval_tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+// Random intervals of length up to 1000 with starts in [0, 10^8)
+static std::vector<Interval<int>> random_intervals(size_t size) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> start_dist(0, 100000000);
+    std::uniform_int_distribution<int> length_dist(0, 1000);
+    std::vector<Interval<int>> intervals(size);
+    for (auto &interval : intervals) {
+        interval.low = start_dist(rng);
+        interval.high = interval.low + length_dist(rng);
+    }
+    return intervals;
+}
+
+// Overlap query of the short interval by scanning all intervals
+static void BM_interval_scan(benchmark::State &state) {
+    std::vector<Interval<int>> intervals = random_intervals(state.range(0));
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> point_dist(0, 100000000);
+    for (auto _ : state) {
+        int low = point_dist(rng);
+        size_t found = 0;
+        for (auto &interval : intervals) {
+            found += interval.overlaps(low, low + 1000);
+        }
+        benchmark::DoNotOptimize(found);
+    }
+}
+
+// Overlap query of the short interval in the IntervalTree
+static void BM_interval_tree(benchmark::State &state) {
+    std::vector<Interval<int>> intervals = random_intervals(state.range(0));
+    IntervalTree<int> tree(intervals.begin(), intervals.end());
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> point_dist(0, 100000000);
+    for (auto _ : state) {
+        int low = point_dist(rng);
+        size_t found = 0;
+        tree.for_each_overlapping(low, low + 1000, [&found](const Interval<int> &) { ++found; });
+        benchmark::DoNotOptimize(found);
+    }
+}
+
+BENCHMARK(BM_interval_scan)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_interval_tree)->RangeMultiplier(10)->Range(1000, 1000000);
+
+} // namespace Benchmarks
@@ -0,0 +1,75 @@
+#include "tree.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+// Number of keys in the looked up batch
+constexpr size_t LookupBatchSize = 4096;
+
+// Tree of the random keys and the batch of random present and absent keys
+struct LookupBatch {
+    RedBlackTree<int> m_tree;
+    std::vector<int> m_keys;
+
+    explicit LookupBatch(size_t size) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> key_dist(0, 2 * size);
+        std::vector<int> keys(size);
+        for (auto &key : keys) {
+            key = key_dist(rng);
+        }
+        m_tree.assign(keys.begin(), keys.end());
+        m_keys.resize(LookupBatchSize);
+        for (auto &key : m_keys) {
+            key = key_dist(rng);
+        }
+    }
+};
+
+// Batch, looked up key by key
+static void BM_lookup_batch_serial(benchmark::State &state) {
+    LookupBatch batch(state.range(0));
+    std::vector<char> contained(LookupBatchSize);
+    for (auto _ : state) {
+        for (size_t i = 0; i < LookupBatchSize; ++i) {
+            contained[i] = batch.m_tree.contains(batch.m_keys[i]);
+        }
+        benchmark::DoNotOptimize(contained.data());
+    }
+    state.SetItemsProcessed(state.iterations() * LookupBatchSize);
+}
+
+// Unsorted batch, looked up by the interleaved searches
+static void BM_lookup_batch_interleaved(benchmark::State &state) {
+    LookupBatch batch(state.range(0));
+    std::vector<char> contained(LookupBatchSize);
+    for (auto _ : state) {
+        batch.m_tree.contains_batch(batch.m_keys.begin(), batch.m_keys.end(), contained.begin());
+        benchmark::DoNotOptimize(contained.data());
+    }
+    state.SetItemsProcessed(state.iterations() * LookupBatchSize);
+}
+
+// Sorted batch, looked up by the single traversal
+static void BM_lookup_batch_sorted(benchmark::State &state) {
+    LookupBatch batch(state.range(0));
+    std::sort(batch.m_keys.begin(), batch.m_keys.end());
+    std::vector<char> contained(LookupBatchSize);
+    for (auto _ : state) {
+        batch.m_tree.contains_batch(batch.m_keys.begin(), batch.m_keys.end(), contained.begin());
+        benchmark::DoNotOptimize(contained.data());
+    }
+    state.SetItemsProcessed(state.iterations() * LookupBatchSize);
+}
+
+BENCHMARK(BM_lookup_batch_serial)->RangeMultiplier(10)->Range(10000, 10000000);
+BENCHMARK(BM_lookup_batch_interleaved)->RangeMultiplier(10)->Range(10000, 10000000);
+BENCHMARK(BM_lookup_batch_sorted)->RangeMultiplier(10)->Range(10000, 10000000);
+
+} // namespace Benchmarks
@@ -0,0 +1,62 @@
+#include "multiset.hpp"
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+// Stream of events, where 80% of the keys repeat the earlier ones
+static std::vector<int> duplicate_keys(size_t size) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, size / 5 - 1);
+    std::vector<int> keys(size);
+    for (int &key : keys) {
+        key = key_dist(rng);
+    }
+    return keys;
+}
+
+// Insert the stream into the tree, that stores every copy in its own node, and count copies of the keys
+void BM_duplicates_tree(benchmark::State &state) {
+    std::vector<int> keys = duplicate_keys(state.range(0));
+    size_t nodes = 0;
+    for (auto _ : state) {
+        RedBlackTree<int> tree;
+        for (int key : keys) {
+            tree.insert(key);
+        }
+        for (size_t i = 0; i < keys.size(); i += 8) {
+            benchmark::DoNotOptimize(tree.count_in_range(keys[i], keys[i]));
+        }
+        nodes = tree.size();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+    state.counters["nodes"] = nodes;
+}
+
+// Insert the stream into the multiset, that stores the run of copies in one node, and count copies of the keys
+void BM_duplicates_multiset(benchmark::State &state) {
+    std::vector<int> keys = duplicate_keys(state.range(0));
+    size_t nodes = 0;
+    for (auto _ : state) {
+        RedBlackMultiset<int> multiset;
+        for (int key : keys) {
+            multiset.insert(key);
+        }
+        for (size_t i = 0; i < keys.size(); i += 8) {
+            benchmark::DoNotOptimize(multiset.count(keys[i]));
+        }
+        nodes = multiset.distinct_size();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+    state.counters["nodes"] = nodes;
+}
+
+BENCHMARK(BM_duplicates_tree)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK(BM_duplicates_multiset)->RangeMultiplier(10)->Range(10000, 1000000);
+
+} // namespace Benchmarks
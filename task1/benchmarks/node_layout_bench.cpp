@@ -0,0 +1,109 @@
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+template <typename NodeT> using LayoutTree = RedBlackTree<int, std::less<int>, PoolAllocator, NodeT>;
+
+// Shuffled keys 0, 2, 4, ...
+std::vector<int> shuffled_keys(size_t size) {
+    std::vector<int> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    return keys;
+}
+
+// Random lookups of present and absent keys in the big tree, bound by cache misses
+template <typename NodeT> void BM_layout_find(benchmark::State &state) {
+    std::vector<int> keys = shuffled_keys(state.range(0));
+    LayoutTree<NodeT> tree(keys.begin(), keys.end());
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> key_dist(0, 2 * keys.size());
+    for (auto _ : state) {
+        int key = key_dist(rng);
+        benchmark::DoNotOptimize(tree.contains(key));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["node_bytes"] = sizeof(NodeT);
+}
+
+// Random inserts into the big tree
+template <typename NodeT> void BM_layout_insert(benchmark::State &state) {
+    std::vector<int> keys = shuffled_keys(state.range(0));
+    LayoutTree<NodeT> tree(keys.begin(), keys.end());
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> key_dist(0, 2 * keys.size());
+    for (auto _ : state) {
+        tree.insert(key_dist(rng));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["node_bytes"] = sizeof(NodeT);
+}
+
+// Shuffled distinct string keys with scattered leading digits, like hashes or identifiers,
+// longer than the inline buffer of std::string, so every key is on the heap
+std::vector<std::string> string_keys(size_t size) {
+    std::vector<std::string> keys;
+    for (int key : shuffled_keys(size)) {
+        // Multiplication by the odd number, coprime with 10, is a permutation of the residues
+        std::string digits = std::to_string(uint64_t(key) * 2654435761 % 10000000000);
+        keys.push_back(std::string(10 - digits.size(), '0') + digits + "_payload_suffix");
+    }
+    return keys;
+}
+
+// Random lookups of present and absent string keys in the big tree
+template <typename Comparator, typename NodeT> void BM_layout_find_string(benchmark::State &state) {
+    std::vector<std::string> keys = string_keys(state.range(0));
+    RedBlackTree<std::string, Comparator, PoolAllocator, NodeT> tree(keys.begin(), keys.end());
+    std::vector<std::string> lookups = string_keys(2 * state.range(0));
+    std::shuffle(lookups.begin(), lookups.end(), std::mt19937(7));
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tree.contains(lookups[i]));
+        i = i + 1 == lookups.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["node_bytes"] = sizeof(NodeT);
+}
+
+// Intersection of the string trees, that splits one tree by every key of the other
+template <typename Comparator, typename NodeT> void BM_layout_intersect_string(benchmark::State &state) {
+    std::vector<std::string> keys = string_keys(state.range(0));
+    std::vector<std::string> other_keys = string_keys(state.range(0) / 2);
+    using Tree = RedBlackTree<std::string, Comparator, PoolAllocator, NodeT>;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Tree tree(keys.begin(), keys.end());
+        Tree other(other_keys.begin(), other_keys.end());
+        state.ResumeTiming();
+        tree.intersect_with(other);
+        benchmark::DoNotOptimize(tree.size());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+BENCHMARK(BM_layout_find<TreeNode<int>>)->RangeMultiplier(10)->Range(100000, 10000000);
+BENCHMARK(BM_layout_find<CompactTreeNode<int>>)->RangeMultiplier(10)->Range(100000, 10000000);
+BENCHMARK(BM_layout_insert<TreeNode<int>>)->RangeMultiplier(10)->Range(100000, 10000000);
+BENCHMARK(BM_layout_insert<CompactTreeNode<int>>)->RangeMultiplier(10)->Range(100000, 10000000);
+BENCHMARK(BM_layout_find_string<std::less<std::string>, TreeNode<std::string>>)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK(BM_layout_find_string<std::less<std::string>, PrefixTreeNode<std::string>>)
+    ->RangeMultiplier(10)
+    ->Range(10000, 1000000);
+BENCHMARK(BM_layout_intersect_string<std::less<std::string>, TreeNode<std::string>>)->Range(100000, 100000);
+BENCHMARK(BM_layout_intersect_string<StringCompare, TreeNode<std::string>>)->Range(100000, 100000);
+BENCHMARK(BM_layout_intersect_string<StringCompare, PrefixTreeNode<std::string>>)->Range(100000, 100000);
+
+} // namespace Benchmarks
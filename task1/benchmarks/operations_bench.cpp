@@ -0,0 +1,366 @@
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+// Containers of keys 0, 1, ..., size - 1 are measured with sizes 10^3, 10^4, ... up to this one
+// It is 10^6 by default and may be raised up to 10^8 with TASK1_BENCH_MAX_SIZE environment variable
+size_t max_size() {
+    const char *env = std::getenv("TASK1_BENCH_MAX_SIZE");
+    return env ? std::strtoull(env, nullptr, 10) : 1000000;
+}
+
+// Number of precomputed lookup keys, that are cycled through by find
+constexpr size_t LookupKeys = 1 << 16;
+
+// Order, in which keys are inserted and erased, or distribution of the looked up keys
+enum class Distribution { Sequential, Random, Zipf };
+
+const char *distribution_name(Distribution distribution) {
+    switch (distribution) {
+    case Distribution::Sequential:
+        return "sequential";
+    case Distribution::Random:
+        return "random";
+    default:
+        return "zipf";
+    }
+}
+
+// Zipfian ranks in [0, size) with the skew theta, generated as in YCSB
+class ZipfDistribution final {
+public:
+    ZipfDistribution(uint64_t size, double theta = 0.99) : m_size(size), m_theta(theta) {
+        double zeta2 = 1 + std::pow(0.5, theta);
+        for (uint64_t i = 1; i <= size; ++i) {
+            m_zetan += std::pow(static_cast<double>(i), -theta);
+        }
+        m_alpha = 1 / (1 - theta);
+        m_eta = (1 - std::pow(2.0 / size, 1 - theta)) / (1 - zeta2 / m_zetan);
+    }
+
+    template <typename Generator> uint64_t operator()(Generator &gen) {
+        double u = std::uniform_real_distribution<double>(0, 1)(gen);
+        double uz = u * m_zetan;
+        if (uz < 1) {
+            return 0;
+        }
+        if (uz < 1 + std::pow(0.5, m_theta)) {
+            return 1;
+        }
+        return std::min<uint64_t>(m_size - 1, m_size * std::pow(m_eta * u - m_eta + 1, m_alpha));
+    }
+
+private:
+    uint64_t m_size;
+    double m_theta;
+    double m_zetan = 0;
+    double m_alpha;
+    double m_eta;
+};
+
+// Key of the given type for the number, keys are ordered as their numbers
+template <typename KeyT> KeyT make_key(uint64_t number) {
+    if constexpr (std::is_same_v<KeyT, std::string>) {
+        std::string digits = std::to_string(number);
+        return "key" + std::string(12 - digits.size(), '0') + digits;
+    } else {
+        return static_cast<KeyT>(number);
+    }
+}
+
+// Keys 0, 1, ..., size - 1 in the order of the distribution, Zipf gives random order
+template <typename KeyT> std::vector<KeyT> ordered_keys(size_t size, Distribution distribution) {
+    std::vector<uint64_t> numbers(size);
+    for (size_t i = 0; i < size; ++i) {
+        numbers[i] = i;
+    }
+    if (distribution != Distribution::Sequential) {
+        std::shuffle(numbers.begin(), numbers.end(), std::mt19937_64(42));
+    }
+
+    std::vector<KeyT> keys;
+    keys.reserve(size);
+    for (uint64_t number : numbers) {
+        keys.push_back(make_key<KeyT>(number));
+    }
+    return keys;
+}
+
+// Keys of the container of the given size to look up
+// Zipf ranks are scattered over the keys, so that the hot keys are not neighbours
+template <typename KeyT> std::vector<KeyT> lookup_keys(size_t size, Distribution distribution) {
+    std::mt19937_64 gen(7);
+    ZipfDistribution zipf(distribution == Distribution::Zipf ? size : 1);
+    std::vector<KeyT> keys;
+    keys.reserve(LookupKeys);
+    for (size_t i = 0; i < LookupKeys; ++i) {
+        uint64_t number = 0;
+        switch (distribution) {
+        case Distribution::Sequential:
+            number = i % size;
+            break;
+        case Distribution::Random:
+            number = std::uniform_int_distribution<uint64_t>(0, size - 1)(gen);
+            break;
+        case Distribution::Zipf:
+            // Multiplication by the prime, coprime with the size, is the bijection of [0, size)
+            number = zipf(gen) * 2654435761ULL % size;
+            break;
+        }
+        keys.push_back(make_key<KeyT>(number));
+    }
+    return keys;
+}
+
+// Operations, that std::set does differently from RedBlackTree
+template <typename KeyT> bool contains(const std::set<KeyT> &set, const KeyT &key) { return set.count(key) != 0; }
+template <typename KeyT> bool contains(const RedBlackTree<KeyT> &tree, const KeyT &key) { return tree.contains(key); }
+
+// Split off keys not less than key into other container
+template <typename KeyT> std::set<KeyT> split(std::set<KeyT> &set, const KeyT &key) {
+    std::set<KeyT> right;
+    for (auto it = set.lower_bound(key); it != set.end();) {
+        right.insert(right.end(), set.extract(it++));
+    }
+    return right;
+}
+template <typename KeyT> RedBlackTree<KeyT> split(RedBlackTree<KeyT> &tree, const KeyT &key) {
+    auto [left, right] = tree.split(key);
+    tree = std::move(left);
+    return std::move(right);
+}
+
+// Append container with greater keys
+template <typename KeyT> void join(std::set<KeyT> &set, std::set<KeyT> &right) {
+    while (!right.empty()) {
+        set.insert(set.end(), right.extract(right.begin()));
+    }
+}
+template <typename KeyT> void join(RedBlackTree<KeyT> &tree, RedBlackTree<KeyT> &right) { tree.join(right); }
+
+// Add keys of the other container
+template <typename KeyT> void merge(std::set<KeyT> &set, std::set<KeyT> &other) { set.merge(other); }
+template <typename KeyT> void merge(RedBlackTree<KeyT> &tree, RedBlackTree<KeyT> &other) { tree.merge(other); }
+
+// Erase keys in [low, high]
+template <typename KeyT> void erase_range(std::set<KeyT> &set, const KeyT &low, const KeyT &high) {
+    set.erase(set.lower_bound(low), set.upper_bound(high));
+}
+template <typename KeyT> void erase_range(RedBlackTree<KeyT> &tree, const KeyT &low, const KeyT &high) {
+    tree.erase_range(low, high);
+}
+
+// Check the invariants of the container
+template <typename KeyT> bool validate(const std::set<KeyT> &set) { return true; }
+template <typename KeyT> bool validate(const RedBlackTree<KeyT> &tree) { return tree.validate(); }
+
+// Run the operation and report its time as the time of the iteration
+// Preparation around it isn't timed without pausing the timers, which costs more than the small operations
+template <typename Operation> void timed(benchmark::State &state, Operation operation) {
+    auto start = std::chrono::steady_clock::now();
+    operation();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    state.SetIterationTime(elapsed.count());
+}
+
+// Insert all keys into the empty container in the order of the distribution
+template <typename Container, typename KeyT>
+void BM_insert(benchmark::State &state, Distribution distribution) {
+    std::vector<KeyT> keys = ordered_keys<KeyT>(state.range(0), distribution);
+    for (auto _ : state) {
+        Container container;
+        timed(state, [&] {
+            for (auto &key : keys) {
+                container.insert(key);
+            }
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Append ascending keys to the empty container with end() as the hint
+template <typename Container, typename KeyT> void BM_insert_hint(benchmark::State &state) {
+    std::vector<KeyT> keys = ordered_keys<KeyT>(state.range(0), Distribution::Sequential);
+    for (auto _ : state) {
+        Container container;
+        timed(state, [&] {
+            for (auto &key : keys) {
+                container.insert(container.end(), key);
+            }
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Erase all keys from the full container in the order of the distribution
+template <typename Container, typename KeyT>
+void BM_erase(benchmark::State &state, Distribution distribution) {
+    std::vector<KeyT> keys = ordered_keys<KeyT>(state.range(0), distribution);
+    Container full(keys.begin(), keys.end());
+    for (auto _ : state) {
+        Container container = full;
+        timed(state, [&] {
+            for (auto &key : keys) {
+                container.erase(key);
+            }
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Look up keys of the distribution in the full container
+template <typename Container, typename KeyT>
+void BM_find(benchmark::State &state, Distribution distribution) {
+    std::vector<KeyT> keys = ordered_keys<KeyT>(state.range(0), Distribution::Random);
+    Container container(keys.begin(), keys.end());
+    std::vector<KeyT> lookups = lookup_keys<KeyT>(keys.size(), distribution);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(contains(container, lookups[next]));
+        next = (next + 1) % lookups.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Split the full container by the middle key, halves are joined back untimed
+template <typename Container, typename KeyT> void BM_split(benchmark::State &state) {
+    size_t size = state.range(0);
+    std::vector<KeyT> keys = ordered_keys<KeyT>(size, Distribution::Random);
+    Container container(keys.begin(), keys.end());
+    KeyT middle = make_key<KeyT>(size / 2);
+    for (auto _ : state) {
+        Container right;
+        timed(state, [&] { right = split(container, middle); });
+        join(container, right);
+    }
+}
+
+// Join two halves of the container, that are split back untimed
+template <typename Container, typename KeyT> void BM_join(benchmark::State &state) {
+    size_t size = state.range(0);
+    std::vector<KeyT> keys = ordered_keys<KeyT>(size, Distribution::Random);
+    Container container(keys.begin(), keys.end());
+    KeyT middle = make_key<KeyT>(size / 2);
+    for (auto _ : state) {
+        Container right = split(container, middle);
+        timed(state, [&] { join(container, right); });
+    }
+}
+
+// Merge two containers with interleaved keys
+template <typename Container, typename KeyT> void BM_merge(benchmark::State &state) {
+    std::vector<KeyT> keys = ordered_keys<KeyT>(state.range(0), Distribution::Random);
+    auto middle = keys.begin() + keys.size() / 2;
+    Container full_left(keys.begin(), middle);
+    Container full_right(middle, keys.end());
+    for (auto _ : state) {
+        Container left = full_left;
+        Container right = full_right;
+        timed(state, [&] { merge(left, right); });
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+
+    // Result of the last merge is checked, counters are reported per key with TASK1_STATS
+    Container left = full_left;
+    Container right = full_right;
+    TreeStats before = stats();
+    merge(left, right);
+    TreeStats merged = stats() - before;
+    if (!validate(left)) {
+        state.SkipWithError("merged tree is invalid");
+    }
+    if constexpr (StatsEnabled) {
+        state.counters["comparisons"] = static_cast<double>(merged.m_comparisons) / keys.size();
+        state.counters["rotations"] = static_cast<double>(merged.m_rotations) / keys.size();
+        state.counters["join_depth"] = merged.m_join_depth;
+    }
+}
+
+// Erase keys below the watermark at the quarter of the keys, as the retention sweep does
+template <typename Container, typename KeyT> void BM_erase_range(benchmark::State &state) {
+    size_t size = state.range(0);
+    std::vector<KeyT> keys = ordered_keys<KeyT>(size, Distribution::Random);
+    Container full(keys.begin(), keys.end());
+    KeyT low = make_key<KeyT>(0);
+    KeyT high = make_key<KeyT>(size / 4);
+    for (auto _ : state) {
+        Container container = full;
+        timed(state, [&] { erase_range(container, low, high); });
+    }
+    state.SetItemsProcessed(state.iterations() * (size / 4));
+}
+
+// Copy the full container
+template <typename Container, typename KeyT> void BM_copy(benchmark::State &state) {
+    std::vector<KeyT> keys = ordered_keys<KeyT>(state.range(0), Distribution::Random);
+    Container full(keys.begin(), keys.end());
+    for (auto _ : state) {
+        std::optional<Container> container;
+        timed(state, [&] { container.emplace(full); });
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Sizes of the containers, time is reported in microseconds
+void sizes(benchmark::internal::Benchmark *benchmark) {
+    for (size_t size = 1000; size <= max_size(); size *= 10) {
+        benchmark->Arg(size);
+    }
+    benchmark->Unit(benchmark::kMicrosecond);
+}
+
+// Sizes of the containers for the operations, that need untimed preparation and time themselves
+void timed_sizes(benchmark::internal::Benchmark *benchmark) {
+    sizes(benchmark);
+    benchmark->UseManualTime();
+}
+
+// Register all operations for the container, names are <operation>/<container>/<key>[/<distribution>]/<size>
+template <typename Container, typename KeyT> void register_container(const std::string &name) {
+    for (auto distribution : {Distribution::Sequential, Distribution::Random}) {
+        std::string suffix = name + "/" + distribution_name(distribution);
+        benchmark::RegisterBenchmark(("insert/" + suffix).c_str(), BM_insert<Container, KeyT>, distribution)
+            ->Apply(timed_sizes);
+        benchmark::RegisterBenchmark(("erase/" + suffix).c_str(), BM_erase<Container, KeyT>, distribution)
+            ->Apply(timed_sizes);
+    }
+    benchmark::RegisterBenchmark(("insert_hint/" + name).c_str(), BM_insert_hint<Container, KeyT>)->Apply(timed_sizes);
+    for (auto distribution : {Distribution::Sequential, Distribution::Random, Distribution::Zipf}) {
+        std::string suffix = name + "/" + distribution_name(distribution);
+        benchmark::RegisterBenchmark(("find/" + suffix).c_str(), BM_find<Container, KeyT>, distribution)
+            ->Apply(sizes);
+    }
+    benchmark::RegisterBenchmark(("split/" + name).c_str(), BM_split<Container, KeyT>)->Apply(timed_sizes);
+    benchmark::RegisterBenchmark(("join/" + name).c_str(), BM_join<Container, KeyT>)->Apply(timed_sizes);
+    benchmark::RegisterBenchmark(("merge/" + name).c_str(), BM_merge<Container, KeyT>)->Apply(timed_sizes);
+    benchmark::RegisterBenchmark(("erase_range/" + name).c_str(), BM_erase_range<Container, KeyT>)->Apply(timed_sizes);
+    benchmark::RegisterBenchmark(("copy/" + name).c_str(), BM_copy<Container, KeyT>)->Apply(timed_sizes);
+}
+
+template <typename KeyT> void register_key(const std::string &key_name) {
+    register_container<RedBlackTree<KeyT>, KeyT>("RedBlackTree/" + key_name);
+    register_container<std::set<KeyT>, KeyT>("std::set/" + key_name);
+}
+
+// Benchmarks are registered before main of benchmark_main runs
+const bool registered = [] {
+    register_key<int>("int");
+    register_key<int64_t>("int64");
+    register_key<std::string>("string");
+    return true;
+}();
+
+} // namespace Benchmarks
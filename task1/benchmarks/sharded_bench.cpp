@@ -0,0 +1,77 @@
+#include "sharded_tree.hpp"
+#include "tree.hpp"
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <vector>
+
+using namespace Task1;
+
+namespace Benchmarks {
+
+constexpr int ShardedTreeSize = 1000000;
+constexpr size_t ShardCount = 16;
+
+std::vector<int> sharded_keys() {
+    std::vector<int> keys(ShardedTreeSize);
+    for (int i = 0; i < ShardedTreeSize; ++i) {
+        keys[i] = 2 * i;
+    }
+    return keys;
+}
+
+// Updates from every thread into the shared tree, guarded by the mutex
+void BM_mutex_insert_erase(benchmark::State &state) {
+    static std::mutex mutex;
+    static std::vector<int> keys = sharded_keys();
+    static RedBlackTree<int> tree(keys.begin(), keys.end());
+
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> key_dist(0, 2 * ShardedTreeSize);
+    for (auto _ : state) {
+        int key = key_dist(rng);
+        std::lock_guard<std::mutex> lock(mutex);
+        tree.insert(key);
+        tree.erase(key);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Updates from every thread into the shared tree, split into shards with their own locks
+void BM_sharded_insert_erase(benchmark::State &state) {
+    static std::vector<int> keys = sharded_keys();
+    static ShardedTree<int> tree(ShardCount, keys.begin(), keys.end());
+
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> key_dist(0, 2 * ShardedTreeSize);
+    for (auto _ : state) {
+        int key = key_dist(rng);
+        tree.insert(key);
+        tree.erase(key);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Rebalancing of the shards after all new keys have gone into the last one
+void BM_sharded_rebalance(benchmark::State &state) {
+    std::vector<int> keys = sharded_keys();
+    for (auto _ : state) {
+        ShardedTree<int> tree(ShardCount, keys.begin(), keys.end());
+        for (int key = 2 * ShardedTreeSize; key < 3 * ShardedTreeSize; key += 16) {
+            tree.insert(key);
+        }
+        // Building and destroying the tree isn't timed
+        auto start = std::chrono::steady_clock::now();
+        tree.rebalance();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        state.SetIterationTime(elapsed.count());
+    }
+}
+
+BENCHMARK(BM_mutex_insert_erase)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_sharded_insert_erase)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_sharded_rebalance)->Unit(benchmark::kMicrosecond)->UseManualTime()->Iterations(20);
+
+} // namespace Benchmarks
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Task1 {
+
+// Node allocator, that allocates every node separately with new/delete
+template <typename NodeT> class NewDeleteAllocator final {
+public:
+    // Nodes can't be freed without visiting each of them
+    static constexpr bool bulk_release = false;
+
+    // Construct node from the given arguments
+    template <typename... Args> NodeT *create(Args &&...args) {
+        NodeT *node = new NodeT(std::forward<Args>(args)...);
+        count_stat(StatsCounter::LiveNodes);
+        count_stat(StatsCounter::AllocatedBytes, sizeof(NodeT));
+        return node;
+    }
+    // Destroy node and free its memory
+    void destroy(NodeT *node) {
+        delete node;
+        count_stat(StatsCounter::LiveNodes, -1);
+        count_stat(StatsCounter::AllocatedBytes, -static_cast<int64_t>(sizeof(NodeT)));
+    }
+    // Take ownership over the nodes, allocated by other
+    void adopt(NewDeleteAllocator &other) {}
+}; // class NewDeleteAllocator
+
+// Node allocator, that carves nodes out of big blocks and recycles freed nodes through the free list.
+// Copies of the allocator share the same arena, so trees, produced by split, can keep exchanging nodes.
+// Arena memory is returned only when the last allocator, referring to it, is destroyed.
+// Arena isn't synchronized, so trees, sharing it, must be used by one thread at a time, as a single tree.
+template <typename NodeT> class PoolAllocator final {
+    // Memory slot for the single node
+    union Slot {
+        // Next slot in the free list
+        Slot *m_next;
+        // Storage for the node
+        alignas(NodeT) unsigned char m_storage[sizeof(NodeT)];
+    };
+
+    // Blocks are aligned to the cache line, so nodes of the power of two size never straddle two lines
+    static constexpr std::align_val_t BlockAlignment{64};
+
+    // Deleter of the block of slots
+    struct BlockDeleter {
+        void operator()(Slot *block) const { ::operator delete[](block, BlockAlignment); }
+    };
+
+    // Storage of the allocator
+    struct Arena {
+        // Blocks of slots
+        std::vector<std::unique_ptr<Slot[], BlockDeleter>> m_blocks;
+        // Head of the free list
+        Slot *m_free = nullptr;
+        // Next never used slot in the last block
+        Slot *m_next = nullptr;
+        // Number of never used slots in the last block
+        size_t m_left = 0;
+        // Number of slots in the next block
+        size_t m_block_size = MinBlockSize;
+        // Arena, that adopted all blocks of this one
+        std::shared_ptr<Arena> m_forward;
+        // Number of nodes in use and bytes of the blocks, counted only with TASK1_STATS
+        int64_t m_live = 0;
+        int64_t m_bytes = 0;
+
+        ~Arena() {
+            count_stat(StatsCounter::LiveNodes, -m_live);
+            count_stat(StatsCounter::AllocatedBytes, -m_bytes);
+        }
+    };
+
+    static constexpr size_t MinBlockSize = 64;
+    static constexpr size_t MaxBlockSize = 65536;
+
+    // Arena of the allocator
+    std::shared_ptr<Arena> m_arena = std::make_shared<Arena>();
+
+    // Get arena, that actually holds the blocks
+    Arena &arena() {
+        while (m_arena->m_forward) {
+            m_arena = m_arena->m_forward;
+        }
+        return *m_arena;
+    }
+
+    // Allocate new block of slots
+    void grow(Arena &arena) {
+        void *block = ::operator new[](arena.m_block_size * sizeof(Slot), BlockAlignment);
+        arena.m_blocks.emplace_back(static_cast<Slot *>(block));
+        arena.m_next = arena.m_blocks.back().get();
+        arena.m_left = arena.m_block_size;
+        arena.m_block_size = std::min(arena.m_block_size * 2, MaxBlockSize);
+        if constexpr (StatsEnabled) {
+            int64_t bytes = arena.m_left * sizeof(Slot);
+            arena.m_bytes += bytes;
+            count_stat(StatsCounter::AllocatedBytes, bytes);
+        }
+    }
+
+public:
+    // Whole arena is freed at once, without visiting nodes
+    static constexpr bool bulk_release = true;
+
+    // Is this allocator the only one, referring to its arena, so that releasing the arena frees only its nodes
+    bool owns_arena() {
+        arena();
+        return m_arena.use_count() == 1;
+    }
+
+    // Construct node from the given arguments
+    template <typename... Args> NodeT *create(Args &&...args) {
+        Arena &curr = arena();
+        Slot *slot = curr.m_free;
+        if (slot) {
+            curr.m_free = slot->m_next;
+        } else {
+            if (curr.m_left == 0) {
+                grow(curr);
+            }
+            slot = curr.m_next++;
+            curr.m_left -= 1;
+        }
+        if constexpr (StatsEnabled) {
+            curr.m_live += 1;
+            count_stat(StatsCounter::LiveNodes);
+        }
+
+        return new (slot->m_storage) NodeT(std::forward<Args>(args)...);
+    }
+
+    // Destroy node and put its slot into the free list
+    void destroy(NodeT *node) {
+        node->~NodeT();
+        Slot *slot = reinterpret_cast<Slot *>(node);
+        Arena &curr = arena();
+        slot->m_next = curr.m_free;
+        curr.m_free = slot;
+        if constexpr (StatsEnabled) {
+            curr.m_live -= 1;
+            count_stat(StatsCounter::LiveNodes, -1);
+        }
+    }
+
+    // Take ownership over the nodes, allocated by other.
+    // Blocks of other are moved into this arena, and other starts using this arena too.
+    void adopt(PoolAllocator &other) {
+        Arena &curr = arena();
+        Arena &other_arena = other.arena();
+        if (&curr == &other_arena) {
+            return;
+        }
+
+        for (auto &block : other_arena.m_blocks) {
+            curr.m_blocks.push_back(std::move(block));
+        }
+        other_arena.m_blocks.clear();
+
+        while (other_arena.m_free) {
+            Slot *slot = other_arena.m_free;
+            other_arena.m_free = slot->m_next;
+            slot->m_next = curr.m_free;
+            curr.m_free = slot;
+        }
+        for (; other_arena.m_left > 0; --other_arena.m_left) {
+            Slot *slot = other_arena.m_next++;
+            slot->m_next = curr.m_free;
+            curr.m_free = slot;
+        }
+
+        curr.m_live += std::exchange(other_arena.m_live, 0);
+        curr.m_bytes += std::exchange(other_arena.m_bytes, 0);
+        other_arena.m_forward = m_arena;
+        other.m_arena = m_arena;
+    }
+}; // class PoolAllocator
+
+} // namespace Task1
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace Task1 {
+
+// Augmentation keeps the aggregate of the keys of every subtree in its root, so that aggregate of any range of keys
+// is found in O(log n). Policy is a monoid over the values, computed from the keys:
+//     value_type - type of the aggregate
+//     identity() - aggregate of no keys
+//     lift(key) - aggregate of the single key
+//     combine(lhs, rhs) - aggregate of the keys of lhs, followed by the keys of rhs, must be associative
+
+// Tree without the aggregates, nodes don't store anything for it
+struct NoAugmentation {
+    using value_type = void;
+};
+
+// Sum of the keys
+template <typename T> struct SumAugmentation {
+    using value_type = T;
+    static T identity() { return T(); }
+    template <typename K> static T lift(const K &key) { return static_cast<T>(key); }
+    static T combine(const T &lhs, const T &rhs) { return lhs + rhs; }
+};
+
+// Minimal key, maximal value of T for no keys
+template <typename T> struct MinAugmentation {
+    using value_type = T;
+    static T identity() { return std::numeric_limits<T>::max(); }
+    template <typename K> static T lift(const K &key) { return static_cast<T>(key); }
+    static T combine(const T &lhs, const T &rhs) { return std::min(lhs, rhs); }
+};
+
+// Maximal key, minimal value of T for no keys
+template <typename T> struct MaxAugmentation {
+    using value_type = T;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    template <typename K> static T lift(const K &key) { return static_cast<T>(key); }
+    static T combine(const T &lhs, const T &rhs) { return std::max(lhs, rhs); }
+};
+
+// Number of the keys, for which Predicate is true
+template <typename Predicate> struct CountAugmentation {
+    using value_type = uint64_t;
+    static uint64_t identity() { return 0; }
+    template <typename K> static uint64_t lift(const K &key) { return Predicate()(key) ? 1 : 0; }
+    static uint64_t combine(uint64_t lhs, uint64_t rhs) { return lhs + rhs; }
+};
+
+// Aggregate, stored in the node, empty for NoAugmentation
+template <typename Augmentation> class AugmentationStorage {
+public:
+    using Aggregate = typename Augmentation::value_type;
+
+    // Get aggregate of the subtree of the node
+    const Aggregate &get_aggregate() const { return m_aggregate; }
+    // Set aggregate of the subtree of the node
+    void set_aggregate(const Aggregate &aggregate) { m_aggregate = aggregate; }
+
+private:
+    Aggregate m_aggregate = Augmentation::identity();
+};
+
+template <> class AugmentationStorage<NoAugmentation> {};
+
+} // namespace Task1
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+
+#include "node.hpp"
+#include "side.hpp"
+
+namespace Task1 {
+
+// Compact node of the RedBlackTree, for int keys it takes 32 bytes instead of 56.
+// Nodes are at least 8-byte aligned, so 3 low bits of every link are free:
+// parent link holds the color, left and right links hold low and high bits of the black height.
+// Side is not stored, it is derived from the parent.
+template <typename KeyT> class CompactTreeNode final {
+private:
+  // Mask of the free low bits of the link
+  static constexpr uintptr_t TagMask = 0x7;
+  // Number of the free low bits of the link
+  static constexpr unsigned TagBits = 3;
+  // Bit of the parent link, set for black nodes
+  static constexpr uintptr_t BlackBit = 0x1;
+
+  // Left and right children of the node, low and high bits of the black height.
+  // Indexed by the side, so descent picks the link without a branch
+  uintptr_t m_links[2] = {0, 0};
+  // Parent of the node and color
+  uintptr_t m_parent = 0;
+  // Number of nodes in the subtree of the node
+  uint32_t m_size = 1;
+  // Value hold in the node
+  KeyT m_key;
+
+  // Get node from the link
+  static CompactTreeNode *untag(uintptr_t link) {
+    return reinterpret_cast<CompactTreeNode *>(link & ~TagMask);
+  }
+  // Replace node in the link, keeping its tag
+  static void retag(uintptr_t &link, CompactTreeNode *node) {
+    link = reinterpret_cast<uintptr_t>(node) | (link & TagMask);
+  }
+
+public:
+  // Compact nodes have no space for the aggregates
+  using Augmentation = NoAugmentation;
+
+  // Maximal black height, that fits into the links
+  static constexpr uint64_t MaxHeight = (uint64_t{1} << (2 * TagBits)) - 1;
+
+  // Get value hold in the node
+  const KeyT &get_key() const { return m_key; }
+  // Get color of the node
+  Color get_color() const {
+    return (m_parent & BlackBit) ? Color::Black : Color::Red;
+  }
+  // Set color of the node
+  void set_color(Color color) {
+    m_parent = color == Color::Black ? m_parent | BlackBit : m_parent & ~BlackBit;
+  }
+
+  CompactTreeNode *get_child(Side side) {
+    return untag(m_links[side == Side::Right]);
+  }
+  // Get right child of the node
+  CompactTreeNode *get_right() const { return untag(m_links[1]); }
+  // Get left child of the node
+  CompactTreeNode *get_left() const { return untag(m_links[0]); }
+  // Get parent of the node
+  CompactTreeNode *get_parent() const { return untag(m_parent); }
+  // Set right child of the node
+  void set_right(CompactTreeNode *right) {
+    retag(m_links[1], right);
+    if (right) {
+      right->set_parent(this);
+    }
+  }
+  // Set left child of the node
+  void set_left(CompactTreeNode *left) {
+    retag(m_links[0], left);
+    if (left) {
+      left->set_parent(this);
+    }
+  }
+  // Set parent of the node
+  void set_parent(CompactTreeNode *parent) { retag(m_parent, parent); }
+  // Side is derived from the parent, so there is nothing to set
+  void set_side(Side side) {}
+  // Get side of the node
+  Side get_side() const {
+    CompactTreeNode *parent = get_parent();
+    if (!parent) {
+      return Side::None;
+    }
+    return parent->get_left() == this ? Side::Left : Side::Right;
+  }
+  // Set child of the given side of the node
+  void set_child(CompactTreeNode *node, Side side) {
+    if (side == Side::None) {
+      return;
+    }
+
+    side == Side::Left ? set_left(node) : set_right(node);
+  }
+  // Is node located on the right side of the parent
+  bool is_right() const { return get_side() == Side::Right; }
+  // Is node located on the left side of the parent
+  bool is_left() const { return get_side() == Side::Left; }
+  // Get black height of the node
+  uint64_t get_height() const {
+    return (m_links[0] & TagMask) | ((m_links[1] & TagMask) << TagBits);
+  }
+  // Set black height of the node
+  void set_height(uint64_t height) {
+    assert(height <= MaxHeight);
+    m_links[0] = (m_links[0] & ~TagMask) | (height & TagMask);
+    m_links[1] = (m_links[1] & ~TagMask) | ((height >> TagBits) & TagMask);
+  }
+  // Get number of nodes in the subtree of the node
+  uint64_t get_size() const { return m_size; }
+  // Set number of nodes in the subtree of the node
+  void set_size(uint64_t size) {
+    assert(size <= UINT32_MAX);
+    m_size = static_cast<uint32_t>(size);
+  }
+
+  // CompactTreeNode constructor
+  CompactTreeNode(const KeyT &key) : m_key(key) {}
+  // CompactTreeNode constructor, constructing the key in place
+  template <typename... Args>
+  CompactTreeNode(std::in_place_t, Args &&...args)
+      : m_key(std::forward<Args>(args)...) {}
+
+  // Constructor, with data from other node
+  CompactTreeNode(const CompactTreeNode *other)
+      : m_size(other->m_size), m_key(other->m_key) {
+    set_color(other->get_color());
+    set_height(other->get_height());
+  }
+
+  CompactTreeNode(CompactTreeNode *left, CompactTreeNode *right,
+                  CompactTreeNode *parent)
+      : m_key() {
+    set_childs(left, right);
+    set_parent(parent);
+    set_color(Color::Black);
+  }
+  // Set childs of the node
+  void set_childs(CompactTreeNode *left, CompactTreeNode *right) {
+    set_left(left);
+    set_right(right);
+  }
+  // Move data from other node, that is going to be destroyed
+  void move_data(CompactTreeNode *other) { m_key = std::move(other->m_key); }
+
+  // Dump Node to graphviz
+  // log - log ostream
+  // counter - number visited nodes counter
+  // returns number of the node in reverse post order
+  uint64_t dump_to_graphviz(uint64_t &counter, std::ostream &log) const {
+    return dump_node_to_graphviz(this, counter, log);
+  }
+}; // class CompactTreeNode
+
+} // namespace Task1
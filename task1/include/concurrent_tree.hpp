@@ -0,0 +1,79 @@
+#pragma once
+
+#include "epoch.hpp"
+#include "persistent_tree.hpp"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace Task1 {
+
+// RedBlackTree for many lock-free readers and serialized writers.
+// Readers work with the immutable version of the tree, published through the atomic pointer.
+// Writers build the next version by path copying, publish it and retire the previous one,
+// which is freed through the epoch-based reclamation once no reader can access it.
+template <typename KeyT, typename Comparator = std::less<KeyT>> class ConcurrentRedBlackTree final {
+    using Version = PersistentRedBlackTree<KeyT, Comparator>;
+
+public:
+    // Default constructor
+    ConcurrentRedBlackTree() : m_version(new Version()) {}
+    // Construct tree from the range of keys
+    template <typename InputIt>
+    ConcurrentRedBlackTree(InputIt first, InputIt last) : m_version(new Version(first, last)) {}
+    ConcurrentRedBlackTree(const ConcurrentRedBlackTree &) = delete;
+    ConcurrentRedBlackTree &operator=(const ConcurrentRedBlackTree &) = delete;
+    // Destructor, there must be no concurrent readers
+    ~ConcurrentRedBlackTree() { delete m_version.load(std::memory_order_relaxed); }
+
+    // Insert key into the tree, blocks other writers
+    void insert(const KeyT &key) {
+        update([&key](Version &version) { version.insert(key); });
+    }
+    // Erase one key, equal to the given one, from the tree, blocks other writers
+    void erase(const KeyT &key) {
+        update([&key](Version &version) { version.erase(key); });
+    }
+
+    // Check, if tree contains given key, lock-free
+    bool contains(const KeyT &key) const {
+        EpochDomain::Guard guard;
+        return m_version.load(std::memory_order_seq_cst)->contains(key);
+    }
+    // Number of keys in the tree, lock-free
+    size_t size() const {
+        EpochDomain::Guard guard;
+        return m_version.load(std::memory_order_seq_cst)->size();
+    }
+    // Is tree empty, lock-free
+    bool empty() const { return size() == 0; }
+    // Consistent view of the tree, it stays valid and unchanged, while writers continue, lock-free
+    Version snapshot() const {
+        EpochDomain::Guard guard;
+        return *m_version.load(std::memory_order_seq_cst);
+    }
+
+private:
+    // Current version of the tree
+    std::atomic<Version *> m_version;
+    // Serializes writers
+    std::mutex m_write_mutex;
+
+    // Apply modification to the copy of the current version and publish it
+    template <typename Modification> void update(Modification modification);
+}; // class ConcurrentRedBlackTree
+
+template <typename KeyT, typename Comparator>
+template <typename Modification>
+void ConcurrentRedBlackTree<KeyT, Comparator>::update(Modification modification) {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    Version *current = m_version.load(std::memory_order_relaxed);
+    // Copy shares all nodes with the current version, so modification copies only the touched path
+    Version *next = new Version(*current);
+    modification(*next);
+    m_version.store(next, std::memory_order_seq_cst);
+    EpochDomain::instance().retire(current, [](void *version) { delete static_cast<Version *>(version); });
+}
+
+} // namespace Task1
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace Task1 {
+
+// Number of retired objects, after which reclamation is attempted
+constexpr size_t EpochReclaimThreshold = 64;
+
+// Epoch-based reclamation of objects, that lock-free readers may still access.
+// Readers pin the current epoch while they access shared objects,
+// every retired object is tagged with the epoch of its retirement
+// and freed when all pinned readers have moved to later epochs.
+class EpochDomain final {
+private:
+    // Epoch, pinned by the single thread
+    struct alignas(64) Record {
+        // Pinned epoch, 0 if thread is outside of the critical section
+        std::atomic<uint64_t> m_epoch = 0;
+        // Number of nested guards, accessed only by the owning thread
+        size_t m_depth = 0;
+        // Is record owned by some thread
+        bool m_used = false;
+    };
+
+    // Object, waiting to be freed
+    struct Retired {
+        // Epoch, when object was retired
+        uint64_t m_epoch;
+        void *m_object;
+        void (*m_deleter)(void *);
+    };
+
+    // Current epoch, advanced by every retirement
+    std::atomic<uint64_t> m_epoch = 1;
+    // Guards records and retired objects
+    std::mutex m_mutex;
+    // Records of all threads, deque keeps their addresses stable
+    std::deque<Record> m_records;
+    // Retired objects, not freed yet
+    std::vector<Retired> m_retired;
+
+    EpochDomain() = default;
+
+    // Record of the calling thread, registered on the first use
+    Record &own_record();
+    // Free retired objects, that no pinned reader may access, m_mutex must be held
+    void reclaim_locked();
+
+public:
+    ~EpochDomain();
+
+    // Domain, shared by all concurrent trees
+    static EpochDomain &instance();
+
+    // Pins the current epoch for its lifetime, guards may be nested
+    class Guard final {
+    public:
+        Guard();
+        ~Guard();
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        Record *m_record;
+    }; // class Guard
+
+    // Free object with deleter, once no reader may access it
+    // Object must be already unreachable for the new readers
+    void retire(void *object, void (*deleter)(void *));
+    // Free all retired objects, that no pinned reader may access
+    void reclaim();
+}; // class EpochDomain
+
+} // namespace Task1
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "allocator.hpp"
+#include "node.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Task1 {
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT> class RedBlackTree;
+
+// Allocator of the std::vector, that aligns its storage to the cache line
+template <typename T> struct CacheLineAllocator {
+    using value_type = T;
+
+    static constexpr std::align_val_t Alignment{64};
+
+    CacheLineAllocator() = default;
+    template <typename U> CacheLineAllocator(const CacheLineAllocator<U> &) {}
+
+    T *allocate(size_t size) { return static_cast<T *>(::operator new(size * sizeof(T), Alignment)); }
+    void deallocate(T *ptr, size_t) { ::operator delete(ptr, Alignment); }
+
+    template <typename U> bool operator==(const CacheLineAllocator<U> &) const { return true; }
+    template <typename U> bool operator!=(const CacheLineAllocator<U> &) const { return false; }
+};
+
+// Read-only tree with keys in the Eytzinger (BFS) order: children of the key k are 2k and 2k + 1.
+// Top levels of the tree share few cache lines, and all 2^d descendants on the depth d of the key k
+// are stored contiguously, so the descent prefetches them several levels ahead and has no pointers to chase.
+template <typename KeyT, typename Comparator = std::less<KeyT>> class FrozenTree final {
+    static_assert(std::is_default_constructible_v<KeyT> && std::is_copy_assignable_v<KeyT>,
+                  "Keys are assigned into the array of the default keys in the in-order traversal");
+
+public:
+    // Forward iterator over the keys in the ascending order
+    class Iterator final {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = KeyT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const KeyT *;
+        using reference = const KeyT &;
+
+        Iterator() = default;
+
+        reference operator*() const { return m_tree->m_keys[m_index]; }
+        pointer operator->() const { return &m_tree->m_keys[m_index]; }
+
+        Iterator &operator++() {
+            m_index = m_tree->successor(m_index);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const Iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        friend class FrozenTree;
+
+        Iterator(const FrozenTree *tree, size_t index) : m_tree(tree), m_index(index) {}
+
+        // Tree, iterated over
+        const FrozenTree *m_tree = nullptr;
+        // Index of the current key, 0 for end()
+        size_t m_index = 0;
+    }; // class Iterator
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    // Default constructor
+    FrozenTree() = default;
+    // Construct tree from the range of keys, unsorted range is sorted first
+    template <typename InputIt> FrozenTree(InputIt first, InputIt last);
+
+    // Number of keys in the tree
+    size_t size() const { return m_size; }
+    // Is tree empty
+    bool empty() const { return m_size == 0; }
+    // Iterator to the minimal key
+    Iterator begin() const { return Iterator(this, leftmost(1)); }
+    // Iterator past the maximal key
+    Iterator end() const { return Iterator(this, 0); }
+
+    // Pointer to the key, equal to the given one, nullptr if there is none
+    const KeyT *find(const KeyT &key) const { return find_key(key); }
+    // Check, if tree contains given key
+    bool contains(const KeyT &key) const { return find_key(key) != nullptr; }
+    // Iterator to the first key, not less than key
+    Iterator lower_bound(const KeyT &key) const { return Iterator(this, lower_bound_index(key)); }
+    // Iterator to the first key, greater than key
+    Iterator upper_bound(const KeyT &key) const { return Iterator(this, upper_bound_index(key)); }
+
+    // Lookups by keys of other types, comparable with KeyT, if Comparator is transparent
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    const KeyT *find(const K &key) const {
+        return find_key(key);
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    bool contains(const K &key) const {
+        return find_key(key) != nullptr;
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    Iterator lower_bound(const K &key) const {
+        return Iterator(this, lower_bound_index(key));
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    Iterator upper_bound(const K &key) const {
+        return Iterator(this, upper_bound_index(key));
+    }
+
+    // Mutable tree with the same keys, built in linear time
+    template <template <typename> class Allocator = NewDeleteAllocator, typename NodeT = TreeNode<KeyT>>
+    RedBlackTree<KeyT, Comparator, Allocator, NodeT> thaw() const;
+
+private:
+    template <typename, typename, template <typename> class, typename> friend class RedBlackTree;
+
+    // Number of keys in the cache line, descendants of the key k on this depth start with the key k * LineKeys
+    static constexpr size_t LineKeys = sizeof(KeyT) <= 64 ? 64 / sizeof(KeyT) : 1;
+
+    // Keys in the Eytzinger order, starting from the index 1, so that lines of descendants are aligned
+    std::vector<KeyT, CacheLineAllocator<KeyT>> m_keys;
+    // Number of keys in the tree
+    size_t m_size = 0;
+
+    // Construct tree from the sorted sequence of size keys
+    template <typename InputIt> FrozenTree(InputIt first, size_t size);
+
+    // Fill subtree of the index with the keys from first in the in-order traversal
+    template <typename InputIt> void fill(InputIt &first, size_t index);
+
+    // Index of the first key, for which go_right is false, 0 if there is none
+    template <typename GoRight> size_t descend(GoRight go_right) const;
+    // Index of the first key, not less than key, 0 if there is none
+    template <typename K> size_t lower_bound_index(const K &key) const {
+        return descend([&key](const KeyT &node_key) { return Comparator()(node_key, key); });
+    }
+    // Index of the first key, greater than key, 0 if there is none
+    template <typename K> size_t upper_bound_index(const K &key) const {
+        return descend([&key](const KeyT &node_key) { return !Comparator()(key, node_key); });
+    }
+    // Key, equal to the given one, nullptr if there is none
+    template <typename K> const KeyT *find_key(const K &key) const {
+        size_t index = lower_bound_index(key);
+        if (index != 0 && !Comparator()(key, m_keys[index])) {
+            return &m_keys[index];
+        }
+        return nullptr;
+    }
+
+    // Index of the minimal key in the subtree of the index, 0 for the empty tree
+    size_t leftmost(size_t index) const {
+        if (index > m_size) {
+            return 0;
+        }
+        while (2 * index <= m_size) {
+            index = 2 * index;
+        }
+        return index;
+    }
+    // Index of the next key in the ascending order, 0 if there is none
+    size_t successor(size_t index) const {
+        if (2 * index + 1 <= m_size) {
+            return leftmost(2 * index + 1);
+        }
+        // Climb while the index is the right child, then to the parent
+        return index >> (__builtin_ctzll(~index) + 1);
+    }
+}; // class FrozenTree
+
+template <typename KeyT, typename Comparator>
+template <typename InputIt>
+FrozenTree<KeyT, Comparator>::FrozenTree(InputIt first, InputIt last) {
+    using Category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, Category>) {
+        if (std::is_sorted(first, last, Comparator())) {
+            *this = FrozenTree(first, static_cast<size_t>(last - first));
+            return;
+        }
+    }
+
+    std::vector<KeyT> keys(first, last);
+    std::sort(keys.begin(), keys.end(), Comparator());
+    *this = FrozenTree(keys.begin(), keys.size());
+}
+
+template <typename KeyT, typename Comparator>
+template <typename InputIt>
+FrozenTree<KeyT, Comparator>::FrozenTree(InputIt first, size_t size) : m_keys(size + 1), m_size(size) {
+    fill(first, 1);
+}
+
+template <typename KeyT, typename Comparator>
+template <typename InputIt>
+void FrozenTree<KeyT, Comparator>::fill(InputIt &first, size_t index) {
+    if (index > m_size) {
+        return;
+    }
+    fill(first, 2 * index);
+    m_keys[index] = *first;
+    ++first;
+    fill(first, 2 * index + 1);
+}
+
+template <typename KeyT, typename Comparator>
+template <typename GoRight>
+size_t FrozenTree<KeyT, Comparator>::descend(GoRight go_right) const {
+    const KeyT *keys = m_keys.data();
+    size_t index = 1;
+    while (index <= m_size) {
+        // Descendants several levels below share the cache line, that is fetched while this level is compared.
+        // Line past the last key is never read, so the address is clamped to stay inside the array
+        __builtin_prefetch(keys + std::min(index * LineKeys, m_size));
+        index = 2 * index + go_right(keys[index]);
+    }
+    // Path turned left at the answer last time and only right after it, so the trailing ones are dropped
+    return index >> (__builtin_ctzll(~index) + 1);
+}
+
+template <typename KeyT, typename Comparator>
+template <template <typename> class Allocator, typename NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT> FrozenTree<KeyT, Comparator>::thaw() const {
+    // Keys are taken in the ascending order, so the tree is built from the iterator without copying them
+    RedBlackTree<KeyT, Comparator, Allocator, NodeT> tree;
+    tree.assign_sequence(begin(), m_size);
+    return tree;
+}
+
+} // namespace Task1
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "node.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Task1 {
+
+// Binary image of the tree: header, followed by the nodes in the ascending order of keys.
+// Children are referenced by their indices, so the image is valid at any address and is used in place,
+// when the file is mapped into memory. Image is only readable on the machine with the same byte order.
+
+// Index of the missing child
+constexpr uint32_t NoImageNode = UINT32_MAX;
+
+// Header of the image, nodes start right after it
+struct alignas(64) ImageHeader {
+    // Magic bytes "RBIMAGE1"
+    char m_magic[8];
+    // sizeof of the key and of the image node, image of other key type is rejected
+    uint32_t m_key_size;
+    uint32_t m_node_size;
+    // Number of nodes
+    uint64_t m_size;
+    // Index of the root, NoImageNode for the empty tree
+    uint32_t m_root;
+};
+
+// Node of the image
+template <typename KeyT> struct ImageNode {
+    KeyT m_key;
+    // Indices of children, left one is less than index of the node, right one is greater
+    uint32_t m_left;
+    uint32_t m_right;
+    // Number of nodes in the subtree
+    uint32_t m_size;
+    // Black height
+    uint8_t m_height;
+    // 1 for black nodes
+    uint8_t m_black;
+};
+
+// Nodes follow the header in the mapped file, that is aligned to the page
+template <typename KeyT> constexpr bool ImageAligned = alignof(ImageNode<KeyT>) <= alignof(ImageHeader);
+
+// Magic bytes in the beginning of the image file
+constexpr char ImageMagic[8] = {'R', 'B', 'I', 'M', 'A', 'G', 'E', '1'};
+
+// Header of the image with size nodes of the given key type
+template <typename KeyT> ImageHeader make_image_header(uint64_t size, uint32_t root) {
+    ImageHeader header{};
+    std::copy(std::begin(ImageMagic), std::end(ImageMagic), header.m_magic);
+    header.m_key_size = sizeof(KeyT);
+    header.m_node_size = sizeof(ImageNode<KeyT>);
+    header.m_size = size;
+    header.m_root = root;
+    return header;
+}
+
+// Read-only file, mapped into memory
+class MappedFile final {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // Map the file at path, returns false if it can't be opened or mapped
+    bool open(const std::string &path);
+    // Unmap the file
+    void close();
+    // Mapped contents of the file
+    const std::byte *data() const { return m_data; }
+    // Size of the file
+    size_t size() const { return m_size; }
+
+private:
+    const std::byte *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// Map image file and check, that it is the valid image of the keys of key_size bytes with nodes of node_size bytes
+// Pointer to the header is returned, nullptr if the image is invalid
+const ImageHeader *map_image(MappedFile &file, const std::string &path, size_t key_size, size_t node_size);
+
+// Nodes of the image, that follow the header
+template <typename KeyT> const ImageNode<KeyT> *image_nodes(const ImageHeader *header) {
+    return reinterpret_cast<const ImageNode<KeyT> *>(header + 1);
+}
+
+// Is the image consistent, so that the tree built from it can't have cycles or lose nodes and keeps the invariants.
+// Subtree of the node i with the sizes of subtrees l and r of its children is the range [i - l, i + r],
+// so it is enough to check, that ranges of the children are next to the node and sizes add up.
+// Once the shape is a tree, black heights are equal on all paths, if every child has the height of its parent
+// less the black parent, so colors and heights are checked node by node too
+template <typename KeyT> bool check_image(const ImageHeader *header) {
+    const ImageNode<KeyT> *nodes = image_nodes<KeyT>(header);
+    uint64_t size = header->m_size;
+    if (size == 0) {
+        return header->m_root == NoImageNode;
+    }
+    if (header->m_root >= size) {
+        return false;
+    }
+
+    // Children are checked to be in range before their sizes are read
+    for (uint64_t i = 0; i < size; ++i) {
+        uint32_t left = nodes[i].m_left;
+        uint32_t right = nodes[i].m_right;
+        if ((left != NoImageNode && left >= i) || (right != NoImageNode && (right <= i || right >= size))) {
+            return false;
+        }
+    }
+
+    auto subtree_size = [nodes](uint32_t index) -> uint64_t { return index == NoImageNode ? 0 : nodes[index].m_size; };
+    auto height = [nodes](uint32_t index) -> uint64_t { return index == NoImageNode ? 0 : nodes[index].m_height; };
+    auto is_red = [nodes](uint32_t index) { return index != NoImageNode && nodes[index].m_black == 0; };
+    for (uint64_t i = 0; i < size; ++i) {
+        const ImageNode<KeyT> &node = nodes[i];
+        uint32_t left = node.m_left;
+        uint32_t right = node.m_right;
+        bool sizes_valid = node.m_size == subtree_size(left) + subtree_size(right) + 1;
+        bool left_valid = left == NoImageNode || left + subtree_size(nodes[left].m_right) + 1 == i;
+        bool right_valid = right == NoImageNode || right - subtree_size(nodes[right].m_left) == i + 1;
+        if (!sizes_valid || !left_valid || !right_valid) {
+            return false;
+        }
+
+        if (node.m_black > 1 || (node.m_black && node.m_height == 0) || (!node.m_black && (is_red(left) || is_red(right)))) {
+            return false;
+        }
+        uint64_t child_height = node.m_height - node.m_black;
+        if (height(left) != child_height || height(right) != child_height) {
+            return false;
+        }
+    }
+    const ImageNode<KeyT> &root = nodes[header->m_root];
+    return header->m_root == subtree_size(root.m_left) && root.m_size == size && root.m_black;
+}
+
+// Write image of the tree with the given root into the file at path, successor gives the next node in the ascending order
+// Returns false on the write error or if the tree is too large for the image
+template <typename KeyT, typename NodeT, typename Successor>
+bool write_image(const std::string &path, NodeT *root, Successor successor) {
+    static_assert(std::is_trivially_copyable_v<KeyT> && ImageAligned<KeyT>,
+                  "Only trivially copyable keys with the alignment up to 64 are saved into the image");
+    auto subtree_size = [](const NodeT *node) -> uint64_t { return node ? node->get_size() : 0; };
+    uint64_t size = subtree_size(root);
+    if (size >= NoImageNode) {
+        return false;
+    }
+
+    NodeT *first = root;
+    while (first && first->get_left()) {
+        first = first->get_left();
+    }
+
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    ImageHeader header = make_image_header<KeyT>(size, root ? subtree_size(root->get_left()) : NoImageNode);
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // Nodes are written in the ascending order, subtree of the node i is the contiguous range around it,
+    // so indices of its children are found by sizes of the subtrees
+    constexpr size_t Batch = 4096;
+    std::vector<ImageNode<KeyT>> batch(Batch);
+    size_t filled = 0;
+    uint64_t index = 0;
+    for (NodeT *node = first; node && written; node = successor(node), ++index) {
+        const NodeT *left = node->get_left();
+        const NodeT *right = node->get_right();
+        ImageNode<KeyT> &image_node = batch[filled++];
+        image_node = ImageNode<KeyT>{};
+        image_node.m_key = node->get_key();
+        image_node.m_left = left ? index - subtree_size(left) + subtree_size(left->get_left()) : NoImageNode;
+        image_node.m_right = right ? index + 1 + subtree_size(right->get_left()) : NoImageNode;
+        image_node.m_size = node->get_size();
+        image_node.m_height = node->get_height();
+        image_node.m_black = node->get_color() == Color::Black;
+        if (filled == Batch) {
+            written = std::fwrite(batch.data(), sizeof(ImageNode<KeyT>), filled, file) == filled;
+            filled = 0;
+        }
+    }
+    if (written && filled) {
+        written = std::fwrite(batch.data(), sizeof(ImageNode<KeyT>), filled, file) == filled;
+    }
+    return std::fclose(file) == 0 && written;
+}
+
+// Read-only tree, used in place from the mapped image file, without building any nodes
+template <typename KeyT, typename Comparator = std::less<KeyT>> class MappedTree final {
+public:
+    // Map the image at path, returns false if it isn't a valid image of KeyT, tree is empty then
+    bool load(const std::string &path) {
+        static_assert(std::is_trivially_copyable_v<KeyT> && ImageAligned<KeyT>,
+                      "Only trivially copyable keys with the alignment up to 64 are saved into the image");
+        m_header = map_image(m_file, path, sizeof(KeyT), sizeof(ImageNode<KeyT>));
+        if (m_header && !check_image<KeyT>(m_header)) {
+            m_header = nullptr;
+        }
+        if (!m_header) {
+            m_file.close();
+        }
+        return m_header != nullptr;
+    }
+
+    // Number of keys in the tree
+    size_t size() const { return m_header ? m_header->m_size : 0; }
+    // Is tree empty
+    bool empty() const { return size() == 0; }
+
+    // Nodes are in the ascending order, so the keys are iterated by stepping over them
+    class Iterator final {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = KeyT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const KeyT *;
+        using reference = const KeyT &;
+
+        Iterator() = default;
+        explicit Iterator(const ImageNode<KeyT> *node) : m_node(node) {}
+
+        reference operator*() const { return m_node->m_key; }
+        pointer operator->() const { return &m_node->m_key; }
+        Iterator &operator++() {
+            ++m_node;
+            return *this;
+        }
+        Iterator operator++(int) { return Iterator(m_node++); }
+        Iterator &operator--() {
+            --m_node;
+            return *this;
+        }
+        Iterator operator+(difference_type n) const { return Iterator(m_node + n); }
+        difference_type operator-(const Iterator &other) const { return m_node - other.m_node; }
+        bool operator==(const Iterator &other) const { return m_node == other.m_node; }
+        bool operator!=(const Iterator &other) const { return m_node != other.m_node; }
+
+    private:
+        const ImageNode<KeyT> *m_node = nullptr;
+    }; // class Iterator
+
+    // Iterator to the minimal key
+    Iterator begin() const { return Iterator(m_header ? image_nodes<KeyT>(m_header) : nullptr); }
+    // Iterator past the maximal key
+    Iterator end() const { return begin() + size(); }
+
+    // Pointer to the key, equal to the given one, nullptr if there is none
+    const KeyT *find(const KeyT &key) const {
+        Iterator it = lower_bound(key);
+        return it != end() && !Comparator()(key, *it) ? &*it : nullptr;
+    }
+    // Check, if tree contains given key
+    bool contains(const KeyT &key) const { return find(key) != nullptr; }
+    // Iterator to the first key, not less than key
+    Iterator lower_bound(const KeyT &key) const {
+        return descend([&key](const KeyT &node_key) { return Comparator()(node_key, key); });
+    }
+    // Iterator to the first key, greater than key
+    Iterator upper_bound(const KeyT &key) const {
+        return descend([&key](const KeyT &node_key) { return !Comparator()(key, node_key); });
+    }
+
+private:
+    // Mapped image
+    MappedFile m_file;
+    // Header of the mapped image, nullptr if nothing is loaded
+    const ImageHeader *m_header = nullptr;
+
+    // First key, for which go_right is false, end() if there is none
+    template <typename GoRight> Iterator descend(GoRight go_right) const {
+        if (empty()) {
+            return end();
+        }
+        const ImageNode<KeyT> *nodes = image_nodes<KeyT>(m_header);
+        uint64_t answer = size();
+        uint32_t index = m_header->m_root;
+        while (index != NoImageNode) {
+            bool right = go_right(nodes[index].m_key);
+            answer = right ? answer : index;
+            index = right ? nodes[index].m_right : nodes[index].m_left;
+        }
+        return begin() + answer;
+    }
+}; // class MappedTree
+
+} // namespace Task1
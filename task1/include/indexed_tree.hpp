@@ -0,0 +1,833 @@
+#pragma once
+
+#include "node.hpp"
+#include "side.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Task1 {
+
+// RedBlackTree, whose nodes live in the arrays of the tree and are addressed by 32-bit indices.
+// Keys, children, parents and colors are in separate arrays, so the search touches only keys and children,
+// and node of the int key takes 17 bytes instead of the 56 of TreeNode. Tree has no pointers into itself,
+// so it is moved and copied as its arrays. Black heights are not stored, join counts them on the spine instead.
+// Index 0 is the black sentinel, that stands for all missing children, as in CLRS.
+// Trees don't share their arrays, so split copies the smaller part out, and join and merge move nodes of other in.
+// Arrays hold at most MaxNodes nodes, insertion, join and merge beyond it throw std::length_error.
+template <typename KeyT, typename Comparator = std::less<KeyT>> class IndexedRedBlackTree final {
+    static_assert(std::is_default_constructible_v<KeyT>, "Sentinel and free slots hold the default key");
+
+    using Index = uint32_t;
+    // Sentinel, missing child
+    static constexpr Index Nil = 0;
+    // Colors are stored in bytes
+    static constexpr uint8_t Red = static_cast<uint8_t>(Color::Red);
+    static constexpr uint8_t Black = static_cast<uint8_t>(Color::Black);
+
+public:
+    // Bidirectional iterator over the keys of the tree in the ascending order
+    class Iterator final {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = KeyT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const KeyT *;
+        using reference = const KeyT &;
+
+        Iterator() = default;
+
+        reference operator*() const { return m_tree->m_keys[m_index]; }
+        pointer operator->() const { return &m_tree->m_keys[m_index]; }
+
+        Iterator &operator++() {
+            m_index = m_tree->successor(m_index);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+        // Decrementing end() gives the maximal key
+        Iterator &operator--() {
+            m_index = m_index != Nil ? m_tree->predecessor(m_index) : m_tree->extreme(m_tree->m_root, Side::Right);
+            return *this;
+        }
+        Iterator operator--(int) {
+            Iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const Iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const Iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        friend class IndexedRedBlackTree;
+
+        Iterator(const IndexedRedBlackTree *tree, Index index) : m_tree(tree), m_index(index) {}
+
+        // Tree, iterated over
+        const IndexedRedBlackTree *m_tree = nullptr;
+        // Current node, Nil for end()
+        Index m_index = Nil;
+    }; // class Iterator
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    // Bytes of the arrays per node
+    static constexpr size_t NodeBytes = sizeof(KeyT) + 3 * sizeof(Index) + sizeof(uint8_t);
+    // Maximal number of nodes, including the freed ones, that are reused, so that indices fit into 32 bits
+    static constexpr size_t MaxNodes = UINT32_MAX - 1;
+
+    // Default constructor
+    IndexedRedBlackTree() { clear(); }
+    // Construct tree from the range of keys, sorted keys are built into the balanced tree in linear time
+    template <typename InputIt> IndexedRedBlackTree(InputIt first, InputIt last);
+
+    // Number of keys in the tree
+    size_t size() const { return m_size; }
+    // Is tree empty
+    bool empty() const { return m_size == 0; }
+    // Number of nodes in the arrays, including the freed ones
+    size_t capacity() const { return m_keys.size() - 1; }
+    // Erase all keys and free the arrays
+    void clear();
+
+    // Iterator to the minimal key
+    Iterator begin() const { return Iterator(this, extreme(m_root, Side::Left)); }
+    // Iterator past the maximal key
+    Iterator end() const { return Iterator(this, Nil); }
+
+    // Insert key, equal keys are kept, inserted after the equal ones.
+    // Throws std::length_error, if there is no free slot and the arrays already hold MaxNodes nodes
+    void insert(const KeyT &key);
+    // Erase one key, equal to the given one, if there is any
+    void erase(const KeyT &key);
+    // Iterator to the key, equal to the given one, end() if there is none
+    Iterator find(const KeyT &key) const {
+        Iterator it = lower_bound(key);
+        return it != end() && !Comparator()(key, *it) ? it : end();
+    }
+    // Check, if tree contains given key
+    bool contains(const KeyT &key) const { return find(key) != end(); }
+    // Iterator to the first key, not less than key
+    Iterator lower_bound(const KeyT &key) const {
+        return descend([&key](const KeyT &node_key) { return Comparator()(node_key, key); });
+    }
+    // Iterator to the first key, greater than key
+    Iterator upper_bound(const KeyT &key) const {
+        return descend([&key](const KeyT &node_key) { return !Comparator()(key, node_key); });
+    }
+
+    // Join another tree into this, keys of other must be not less than keys of this, other becomes empty
+    // Nodes of other are moved into the arrays of this in O(m), the smaller arrays are moved.
+    // Throws std::length_error, leaving both trees intact, if the arrays together hold more than MaxNodes nodes
+    void join(IndexedRedBlackTree &other);
+    // Split the tree by the given key into trees with keys less than key and not less than key
+    // Destroys tree, returning two trees instead, the smaller part is copied out in O(min(k, n - k))
+    std::pair<IndexedRedBlackTree, IndexedRedBlackTree> split(const KeyT &key);
+    // Add keys of other tree into this, one of the equal keys of both trees is kept, other becomes empty.
+    // Throws std::length_error as join
+    void merge(IndexedRedBlackTree &other);
+
+    // Check red-black invariants, parent links and order of the keys in O(n)
+    bool validate() const;
+
+private:
+    // Keys, the sentinel and the free slots hold the default key
+    std::vector<KeyT> m_keys;
+    // Children, searches touch only them and the keys
+    std::vector<Index> m_left;
+    std::vector<Index> m_right;
+    // Parents, Nil for the root
+    std::vector<Index> m_parent;
+    // Colors, the sentinel is black
+    std::vector<uint8_t> m_colors;
+    // Root of the tree, Nil if it is empty
+    Index m_root = Nil;
+    // Head of the list of the freed slots, linked through the left children
+    Index m_free = Nil;
+    // Number of keys
+    size_t m_size = 0;
+
+    // Child of the node on the side
+    Index &child(Index node, Side side) { return side == Side::Left ? m_left[node] : m_right[node]; }
+    Index child(Index node, Side side) const { return side == Side::Left ? m_left[node] : m_right[node]; }
+    // Is node red, sentinel is black
+    bool is_red(Index node) const { return m_colors[node] == Red; }
+
+    // Take slot for the new red node with the key, reusing the freed ones first, throws beyond MaxNodes
+    Index allocate(const KeyT &key);
+    // Put slot of the node into the free list
+    void release(Index node);
+    // Detach subtree from its parent and make its root black
+    Index make_root(Index subroot);
+    // Node with the minimal (on the Left) or the maximal (on the Right) key of the subtree, Nil for Nil
+    Index extreme(Index node, Side side) const;
+    // Next node in the ascending order, Nil after the last
+    Index successor(Index node) const;
+    // Previous node in the ascending order, Nil before the first
+    Index predecessor(Index node) const;
+    // First node, for which go_right is false, end() if there is none
+    template <typename GoRight> Iterator descend(GoRight go_right) const;
+    // Number of black nodes on the path from the node to the sentinel, counted on the leftmost path
+    uint32_t black_height(Index node) const;
+
+    // Rotate the subtree with the given root to the side around the node
+    void rotate(Index &root, Index node, Side side);
+    // Replace subtree of the node with the subtree of other in the parent, parent of the sentinel is set too
+    void transplant(Index &root, Index node, Index other);
+    // Restore the invariants after the red node is linked into the subtree with the given root
+    void insert_fixup(Index &root, Index node);
+    // Restore the invariants after the black node is unlinked above node, which may be the sentinel
+    void erase_fixup(Index &root, Index node);
+    // Unlink node from the subtree with the given root, node isn't freed
+    void unlink(Index &root, Index node);
+
+    // Join subtrees with the key node between them, returns root of the joined subtree
+    Index join(Index left_subroot, Index key_node, Index right_subroot);
+    // Join two subtrees without the key node
+    Index join(Index left_subroot, Index right_subroot);
+    // Split subtree into subtrees with keys less than key and not less than key
+    std::pair<Index, Index> split(Index subroot, const KeyT &key);
+    // Split subtree into subtree with lesser keys, node with the key (if found on the path) and subtree with the rest
+    std::tuple<Index, Index, Index> split_equal(Index subroot, const KeyT &key);
+    // Union of the subtrees, nodes of right subtree are kept for the equal keys
+    Index unite(Index left_subroot, Index right_subroot);
+    // Build subtree from the sorted range of keys, nodes on red_depth are red
+    template <typename RandomIt> Index build(RandomIt first, RandomIt last, uint32_t depth, uint32_t red_depth);
+    // Throw std::length_error, if the arrays of this and other together exceed MaxNodes
+    void check_capacity(const IndexedRedBlackTree &other) const;
+    // Move nodes of other into the arrays of this, adding its size, returns new index of the root of other
+    Index adopt(IndexedRedBlackTree &other);
+    // Copy subtree of other into the arrays of this, returns index of the copy
+    Index copy_subtree(const IndexedRedBlackTree &other, Index subroot);
+    // Free all nodes of the subtree, returns their number
+    size_t release_subtree(Index subroot);
+    // Check the subtree, whose root must have the given black height
+    bool validate_subtree(Index node, uint32_t height) const;
+}; // class IndexedRedBlackTree
+
+template <typename KeyT, typename Comparator>
+template <typename InputIt>
+IndexedRedBlackTree<KeyT, Comparator>::IndexedRedBlackTree(InputIt first, InputIt last) {
+    clear();
+    std::vector<KeyT> keys(first, last);
+    if (!std::is_sorted(keys.begin(), keys.end(), Comparator())) {
+        std::sort(keys.begin(), keys.end(), Comparator());
+    }
+    size_t size = keys.size();
+    if (size == 0) {
+        return;
+    }
+
+    // Tree, built from the middle keys, has all levels except the last one full.
+    // Nodes of the last level are red, unless it is full too.
+    uint32_t last_depth = 0;
+    while ((size_t{2} << last_depth) <= size) {
+        last_depth += 1;
+    }
+    bool full = ((size + 1) & size) == 0;
+    m_keys.reserve(size + 1);
+    m_left.reserve(size + 1);
+    m_right.reserve(size + 1);
+    m_parent.reserve(size + 1);
+    m_colors.reserve(size + 1);
+    m_root = make_root(build(keys.begin(), keys.end(), 0, full ? last_depth + 1 : last_depth));
+    m_size = size;
+}
+
+template <typename KeyT, typename Comparator> void IndexedRedBlackTree<KeyT, Comparator>::clear() {
+    // Sentinel takes the index 0
+    m_keys.assign(1, KeyT());
+    m_left.assign(1, Nil);
+    m_right.assign(1, Nil);
+    m_parent.assign(1, Nil);
+    m_colors.assign(1, Black);
+    m_keys.shrink_to_fit();
+    m_left.shrink_to_fit();
+    m_right.shrink_to_fit();
+    m_parent.shrink_to_fit();
+    m_colors.shrink_to_fit();
+    m_root = Nil;
+    m_free = Nil;
+    m_size = 0;
+}
+
+template <typename KeyT, typename Comparator> void IndexedRedBlackTree<KeyT, Comparator>::insert(const KeyT &key) {
+    Index node = allocate(key);
+    Index parent = Nil;
+    Side side = Side::Left;
+    for (Index curr = m_root; curr != Nil; curr = child(curr, side)) {
+        parent = curr;
+        side = Comparator()(key, m_keys[curr]) ? Side::Left : Side::Right;
+    }
+
+    m_parent[node] = parent;
+    if (parent == Nil) {
+        m_root = node;
+    } else {
+        child(parent, side) = node;
+    }
+    insert_fixup(m_root, node);
+    m_size += 1;
+}
+
+template <typename KeyT, typename Comparator> void IndexedRedBlackTree<KeyT, Comparator>::erase(const KeyT &key) {
+    Index node = find(key).m_index;
+    if (node == Nil) {
+        return;
+    }
+    unlink(m_root, node);
+    release(node);
+    m_size -= 1;
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::join(IndexedRedBlackTree &other) {
+    if (other.empty()) {
+        return;
+    }
+    check_capacity(other);
+    // Smaller arrays are moved, order of the keys is kept by the order of the arguments of join
+    if (capacity() < other.capacity()) {
+        std::swap(*this, other);
+        Index left_root = adopt(other);
+        m_root = make_root(join(left_root, m_root));
+    } else {
+        Index right_root = adopt(other);
+        m_root = make_root(join(m_root, right_root));
+    }
+}
+
+template <typename KeyT, typename Comparator>
+std::pair<IndexedRedBlackTree<KeyT, Comparator>, IndexedRedBlackTree<KeyT, Comparator>>
+IndexedRedBlackTree<KeyT, Comparator>::split(const KeyT &key) {
+    auto [left_root, right_root] = split(m_root, key);
+    left_root = make_root(left_root);
+    right_root = make_root(right_root);
+
+    // Smaller part is copied into the new arrays, the larger one keeps the arrays of this
+    // Keys of the left part are counted only up to the half of the tree
+    size_t left_size = 0;
+    for (Index node = extreme(left_root, Side::Left); node != Nil && left_size * 2 <= m_size; node = successor(node)) {
+        left_size += 1;
+    }
+    bool copy_left = left_size * 2 <= m_size;
+    IndexedRedBlackTree copied;
+    Index copied_root = copy_left ? left_root : right_root;
+    copied.m_root = copied.copy_subtree(*this, copied_root);
+    copied.m_size = release_subtree(copied_root);
+
+    IndexedRedBlackTree kept = std::move(*this);
+    kept.m_root = copy_left ? right_root : left_root;
+    kept.m_size -= copied.m_size;
+    clear();
+    if (copy_left) {
+        return {std::move(copied), std::move(kept)};
+    }
+    return {std::move(kept), std::move(copied)};
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::merge(IndexedRedBlackTree &other) {
+    if (other.empty()) {
+        return;
+    }
+    check_capacity(other);
+    if (capacity() < other.capacity()) {
+        std::swap(*this, other);
+    }
+    Index other_root = adopt(other);
+    m_root = make_root(unite(m_root, other_root));
+}
+
+template <typename KeyT, typename Comparator> bool IndexedRedBlackTree<KeyT, Comparator>::validate() const {
+    if (m_root == Nil) {
+        return m_size == 0;
+    }
+    if (is_red(m_root) || m_parent[m_root] != Nil || !validate_subtree(m_root, black_height(m_root))) {
+        return false;
+    }
+
+    // Shape is valid, so in-order walk visits every node once
+    size_t count = 1;
+    for (Index node = extreme(m_root, Side::Left), next = successor(node); next != Nil;
+         node = next, next = successor(next), ++count) {
+        if (Comparator()(m_keys[next], m_keys[node])) {
+            return false;
+        }
+    }
+    return count == m_size;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index IndexedRedBlackTree<KeyT, Comparator>::allocate(const KeyT &key) {
+    Index node = m_free;
+    if (node != Nil) {
+        m_free = m_left[node];
+        m_keys[node] = key;
+    } else {
+        if (capacity() >= MaxNodes) {
+            throw std::length_error("IndexedRedBlackTree holds MaxNodes nodes");
+        }
+        node = static_cast<Index>(m_keys.size());
+        m_keys.push_back(key);
+        m_left.push_back(Nil);
+        m_right.push_back(Nil);
+        m_parent.push_back(Nil);
+        m_colors.push_back(Red);
+    }
+    m_left[node] = Nil;
+    m_right[node] = Nil;
+    m_parent[node] = Nil;
+    m_colors[node] = Red;
+    return node;
+}
+
+template <typename KeyT, typename Comparator> void IndexedRedBlackTree<KeyT, Comparator>::release(Index node) {
+    // Resources of the key are freed right away
+    m_keys[node] = KeyT();
+    m_left[node] = m_free;
+    m_free = node;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index IndexedRedBlackTree<KeyT, Comparator>::make_root(Index subroot) {
+    if (subroot != Nil) {
+        m_parent[subroot] = Nil;
+        m_colors[subroot] = Black;
+    }
+    return subroot;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index IndexedRedBlackTree<KeyT, Comparator>::extreme(Index node,
+                                                                                                   Side side) const {
+    if (node == Nil) {
+        return Nil;
+    }
+    while (child(node, side) != Nil) {
+        node = child(node, side);
+    }
+    return node;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index IndexedRedBlackTree<KeyT, Comparator>::successor(Index node) const {
+    if (m_right[node] != Nil) {
+        return extreme(m_right[node], Side::Left);
+    }
+    Index parent = m_parent[node];
+    while (parent != Nil && node == m_right[parent]) {
+        node = parent;
+        parent = m_parent[parent];
+    }
+    return parent;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index
+IndexedRedBlackTree<KeyT, Comparator>::predecessor(Index node) const {
+    if (m_left[node] != Nil) {
+        return extreme(m_left[node], Side::Right);
+    }
+    Index parent = m_parent[node];
+    while (parent != Nil && node == m_left[parent]) {
+        node = parent;
+        parent = m_parent[parent];
+    }
+    return parent;
+}
+
+template <typename KeyT, typename Comparator>
+template <typename GoRight>
+typename IndexedRedBlackTree<KeyT, Comparator>::Iterator
+IndexedRedBlackTree<KeyT, Comparator>::descend(GoRight go_right) const {
+    Index answer = Nil;
+    Index node = m_root;
+    while (node != Nil) {
+        bool right = go_right(m_keys[node]);
+        answer = right ? answer : node;
+        node = right ? m_right[node] : m_left[node];
+    }
+    return Iterator(this, answer);
+}
+
+template <typename KeyT, typename Comparator>
+uint32_t IndexedRedBlackTree<KeyT, Comparator>::black_height(Index node) const {
+    uint32_t height = 0;
+    for (; node != Nil; node = m_left[node]) {
+        height += !is_red(node);
+    }
+    return height;
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::rotate(Index &root, Index node, Side side) {
+    Side opposite_side = opposite(side);
+    Index other = child(node, opposite_side);
+    Index inner = child(other, side);
+    child(node, opposite_side) = inner;
+    if (inner != Nil) {
+        m_parent[inner] = node;
+    }
+
+    Index parent = m_parent[node];
+    m_parent[other] = parent;
+    if (parent == Nil) {
+        root = other;
+    } else if (node == m_left[parent]) {
+        m_left[parent] = other;
+    } else {
+        m_right[parent] = other;
+    }
+    child(other, side) = node;
+    m_parent[node] = other;
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::transplant(Index &root, Index node, Index other) {
+    Index parent = m_parent[node];
+    if (parent == Nil) {
+        root = other;
+    } else if (node == m_left[parent]) {
+        m_left[parent] = other;
+    } else {
+        m_right[parent] = other;
+    }
+    m_parent[other] = parent;
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::insert_fixup(Index &root, Index node) {
+    while (is_red(m_parent[node])) {
+        Index parent = m_parent[node];
+        Index grandparent = m_parent[parent];
+        Side side = parent == m_left[grandparent] ? Side::Left : Side::Right;
+        Side opposite_side = opposite(side);
+        Index uncle = child(grandparent, opposite_side);
+
+        if (is_red(uncle)) {
+            m_colors[parent] = Black;
+            m_colors[uncle] = Black;
+            m_colors[grandparent] = Red;
+            node = grandparent;
+            continue;
+        }
+        if (node == child(parent, opposite_side)) {
+            node = parent;
+            rotate(root, node, side);
+            parent = m_parent[node];
+        }
+        m_colors[parent] = Black;
+        m_colors[grandparent] = Red;
+        rotate(root, grandparent, opposite_side);
+    }
+    m_colors[root] = Black;
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::erase_fixup(Index &root, Index node) {
+    while (node != root && !is_red(node)) {
+        Index parent = m_parent[node];
+        // Sentinel is the child on the side, where it is linked, the other child of the parent isn't the sentinel
+        Side side = node == m_left[parent] ? Side::Left : Side::Right;
+        Side opposite_side = opposite(side);
+        Index sibling = child(parent, opposite_side);
+
+        if (is_red(sibling)) {
+            m_colors[sibling] = Black;
+            m_colors[parent] = Red;
+            rotate(root, parent, side);
+            sibling = child(parent, opposite_side);
+        }
+        if (!is_red(m_left[sibling]) && !is_red(m_right[sibling])) {
+            m_colors[sibling] = Red;
+            node = parent;
+            continue;
+        }
+        if (!is_red(child(sibling, opposite_side))) {
+            m_colors[child(sibling, side)] = Black;
+            m_colors[sibling] = Red;
+            rotate(root, sibling, opposite_side);
+            sibling = child(parent, opposite_side);
+        }
+        m_colors[sibling] = m_colors[parent];
+        m_colors[parent] = Black;
+        m_colors[child(sibling, opposite_side)] = Black;
+        rotate(root, parent, side);
+        node = root;
+    }
+    m_colors[node] = Black;
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::unlink(Index &root, Index node) {
+    Index removed = node;
+    uint8_t removed_color = m_colors[removed];
+    Index replacement = Nil;
+    if (m_left[node] == Nil) {
+        replacement = m_right[node];
+        transplant(root, node, replacement);
+    } else if (m_right[node] == Nil) {
+        replacement = m_left[node];
+        transplant(root, node, replacement);
+    } else {
+        // Successor takes place of the node
+        removed = extreme(m_right[node], Side::Left);
+        removed_color = m_colors[removed];
+        replacement = m_right[removed];
+        if (m_parent[removed] == node) {
+            m_parent[replacement] = removed;
+        } else {
+            transplant(root, removed, replacement);
+            m_right[removed] = m_right[node];
+            m_parent[m_right[removed]] = removed;
+        }
+        transplant(root, node, removed);
+        m_left[removed] = m_left[node];
+        m_parent[m_left[removed]] = removed;
+        m_colors[removed] = m_colors[node];
+    }
+    if (removed_color == Black) {
+        erase_fixup(root, replacement);
+    }
+    m_parent[Nil] = Nil;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index
+IndexedRedBlackTree<KeyT, Comparator>::join(Index left_subroot, Index key_node, Index right_subroot) {
+    // Roots are black, so the red key node may be linked under any black node of the spine
+    left_subroot = make_root(left_subroot);
+    right_subroot = make_root(right_subroot);
+    uint32_t left_height = black_height(left_subroot);
+    uint32_t right_height = black_height(right_subroot);
+    m_parent[key_node] = Nil;
+    if (left_height == right_height) {
+        m_left[key_node] = left_subroot;
+        m_right[key_node] = right_subroot;
+        m_parent[left_subroot] = key_node;
+        m_parent[right_subroot] = key_node;
+        m_parent[Nil] = Nil;
+        m_colors[key_node] = Black;
+        return key_node;
+    }
+
+    // Key node is linked on the inner spine of the higher subtree instead of its node of the lower black height
+    Side side = left_height > right_height ? Side::Right : Side::Left;
+    Index root = side == Side::Right ? left_subroot : right_subroot;
+    Index lower = side == Side::Right ? right_subroot : left_subroot;
+    uint32_t height = std::max(left_height, right_height);
+    uint32_t lower_height = std::min(left_height, right_height);
+    Index parent = Nil;
+    Index node = root;
+    while (height != lower_height || is_red(node)) {
+        height -= !is_red(node);
+        parent = node;
+        node = child(node, side);
+    }
+
+    child(key_node, opposite(side)) = node;
+    child(key_node, side) = lower;
+    m_parent[node] = key_node;
+    m_parent[lower] = key_node;
+    m_parent[Nil] = Nil;
+    m_parent[key_node] = parent;
+    child(parent, side) = key_node;
+    m_colors[key_node] = Red;
+    insert_fixup(root, key_node);
+    return root;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index IndexedRedBlackTree<KeyT, Comparator>::join(Index left_subroot,
+                                                                                                Index right_subroot) {
+    if (left_subroot == Nil) {
+        return right_subroot;
+    } else if (right_subroot == Nil) {
+        return left_subroot;
+    }
+    left_subroot = make_root(left_subroot);
+    Index last = extreme(left_subroot, Side::Right);
+    unlink(left_subroot, last);
+    return join(left_subroot, last, right_subroot);
+}
+
+template <typename KeyT, typename Comparator>
+std::pair<typename IndexedRedBlackTree<KeyT, Comparator>::Index, typename IndexedRedBlackTree<KeyT, Comparator>::Index>
+IndexedRedBlackTree<KeyT, Comparator>::split(Index subroot, const KeyT &key) {
+    if (subroot == Nil) {
+        return {Nil, Nil};
+    }
+    // Equal keys may be on both sides of the node, so they are told apart only by the order
+    Index left = m_left[subroot];
+    Index right = m_right[subroot];
+    if (Comparator()(m_keys[subroot], key)) {
+        auto [left_tmp_root, right_tmp_root] = split(right, key);
+        return {join(left, subroot, left_tmp_root), right_tmp_root};
+    }
+    auto [left_tmp_root, right_tmp_root] = split(left, key);
+    return {left_tmp_root, join(right_tmp_root, subroot, right)};
+}
+
+template <typename KeyT, typename Comparator>
+std::tuple<typename IndexedRedBlackTree<KeyT, Comparator>::Index, typename IndexedRedBlackTree<KeyT, Comparator>::Index,
+           typename IndexedRedBlackTree<KeyT, Comparator>::Index>
+IndexedRedBlackTree<KeyT, Comparator>::split_equal(Index subroot, const KeyT &key) {
+    if (subroot == Nil) {
+        return {Nil, Nil, Nil};
+    }
+    Index left = m_left[subroot];
+    Index right = m_right[subroot];
+    if (Comparator()(key, m_keys[subroot])) {
+        auto [left_tmp_root, equal_node, right_tmp_root] = split_equal(left, key);
+        return {left_tmp_root, equal_node, join(right_tmp_root, subroot, right)};
+    }
+    if (Comparator()(m_keys[subroot], key)) {
+        auto [left_tmp_root, equal_node, right_tmp_root] = split_equal(right, key);
+        return {join(left, subroot, left_tmp_root), equal_node, right_tmp_root};
+    }
+    m_parent[left] = Nil;
+    m_parent[right] = Nil;
+    m_parent[Nil] = Nil;
+    return {left, subroot, right};
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index IndexedRedBlackTree<KeyT, Comparator>::unite(Index left_subroot,
+                                                                                                 Index right_subroot) {
+    if (left_subroot == Nil) {
+        return right_subroot;
+    } else if (right_subroot == Nil) {
+        return left_subroot;
+    }
+
+    Index right_left = m_left[right_subroot];
+    Index right_right = m_right[right_subroot];
+    auto [left_left, equal_node, left_right] = split_equal(left_subroot, m_keys[right_subroot]);
+    if (equal_node != Nil) {
+        release(equal_node);
+        m_size -= 1;
+    }
+    Index new_left = unite(left_left, right_left);
+    Index new_right = unite(left_right, right_right);
+    return join(new_left, right_subroot, new_right);
+}
+
+template <typename KeyT, typename Comparator>
+template <typename RandomIt>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index
+IndexedRedBlackTree<KeyT, Comparator>::build(RandomIt first, RandomIt last, uint32_t depth, uint32_t red_depth) {
+    if (first == last) {
+        return Nil;
+    }
+
+    RandomIt middle = first + (last - first) / 2;
+    Index node = allocate(*middle);
+    Index left = build(first, middle, depth + 1, red_depth);
+    Index right = build(middle + 1, last, depth + 1, red_depth);
+    m_left[node] = left;
+    m_right[node] = right;
+    m_parent[left] = node;
+    m_parent[right] = node;
+    m_parent[Nil] = Nil;
+    m_colors[node] = depth == red_depth ? Red : Black;
+    return node;
+}
+
+template <typename KeyT, typename Comparator>
+void IndexedRedBlackTree<KeyT, Comparator>::check_capacity(const IndexedRedBlackTree &other) const {
+    if (capacity() + other.capacity() > MaxNodes) {
+        throw std::length_error("IndexedRedBlackTree would hold more than MaxNodes nodes");
+    }
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index IndexedRedBlackTree<KeyT, Comparator>::adopt(IndexedRedBlackTree &other) {
+    // Slots of other follow the slots of this, so its links are shifted by the same offset, which doesn't
+    // overflow, as the callers have checked capacity
+    Index offset = static_cast<Index>(m_keys.size() - 1);
+    auto shift = [offset](Index index) { return index == Nil ? Nil : index + offset; };
+    for (size_t i = 1; i < other.m_keys.size(); ++i) {
+        m_keys.push_back(std::move(other.m_keys[i]));
+        m_left.push_back(shift(other.m_left[i]));
+        m_right.push_back(shift(other.m_right[i]));
+        m_parent.push_back(shift(other.m_parent[i]));
+        m_colors.push_back(other.m_colors[i]);
+    }
+    // Free slots of other are linked through the left children too
+    for (Index node = shift(other.m_free); node != Nil;) {
+        Index next = m_left[node];
+        m_left[node] = m_free;
+        m_free = node;
+        node = next;
+    }
+    Index root = shift(other.m_root);
+    m_size += other.m_size;
+    other.clear();
+    return root;
+}
+
+template <typename KeyT, typename Comparator>
+typename IndexedRedBlackTree<KeyT, Comparator>::Index
+IndexedRedBlackTree<KeyT, Comparator>::copy_subtree(const IndexedRedBlackTree &other, Index subroot) {
+    if (subroot == Nil) {
+        return Nil;
+    }
+    Index node = allocate(other.m_keys[subroot]);
+    m_colors[node] = other.m_colors[subroot];
+    Index left = copy_subtree(other, other.m_left[subroot]);
+    Index right = copy_subtree(other, other.m_right[subroot]);
+    m_left[node] = left;
+    m_right[node] = right;
+    m_parent[left] = node;
+    m_parent[right] = node;
+    m_parent[Nil] = Nil;
+    return node;
+}
+
+template <typename KeyT, typename Comparator>
+size_t IndexedRedBlackTree<KeyT, Comparator>::release_subtree(Index subroot) {
+    if (subroot == Nil) {
+        return 0;
+    }
+    size_t count = release_subtree(m_left[subroot]) + release_subtree(m_right[subroot]) + 1;
+    release(subroot);
+    return count;
+}
+
+template <typename KeyT, typename Comparator>
+bool IndexedRedBlackTree<KeyT, Comparator>::validate_subtree(Index node, uint32_t height) const {
+    if (node == Nil) {
+        return height == 0;
+    }
+    if (!is_red(node) && height == 0) {
+        return false;
+    }
+    uint32_t child_height = is_red(node) ? height : height - 1;
+    for (Side side : {Side::Left, Side::Right}) {
+        Index next = child(node, side);
+        if (next != Nil && (m_parent[next] != node || (is_red(node) && is_red(next)))) {
+            return false;
+        }
+        if (!validate_subtree(next, child_height)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace Task1
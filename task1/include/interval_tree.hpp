@@ -0,0 +1,146 @@
+#pragma once
+
+#include "tree.hpp"
+
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Task1 {
+
+// Closed interval [low, high], low must be not greater than high
+template <typename T> struct Interval final {
+    T low;
+    T high;
+
+    bool operator==(const Interval &other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Interval &other) const { return !(*this == other); }
+    // Does interval intersect [low, high]
+    bool overlaps(const T &other_low, const T &other_high) const { return !(other_high < low) && !(high < other_low); }
+};
+
+template <typename T> std::ostream &operator<<(std::ostream &out, const Interval<T> &interval) {
+    return out << '[' << interval.low << ", " << interval.high << ']';
+}
+
+// Orders intervals by starts, then by ends
+template <typename T> struct IntervalOrder {
+    bool operator()(const Interval<T> &lhs, const Interval<T> &rhs) const {
+        return lhs.low < rhs.low || (!(rhs.low < lhs.low) && lhs.high < rhs.high);
+    }
+};
+
+// Maximal end of the intervals
+template <typename T> struct MaxHighAugmentation {
+    using value_type = T;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    static T lift(const Interval<T> &interval) { return interval.high; }
+    static T combine(const T &lhs, const T &rhs) { return rhs < lhs ? lhs : rhs; }
+};
+
+// Set of intervals, ordered by their starts, with the overlap queries.
+// Every node keeps the maximal end in its subtree, so the subtrees, that end before the query, are skipped,
+// as are the right subtrees of the intervals, that start after it.
+template <typename T, template <typename> class Allocator = NewDeleteAllocator> class IntervalTree final {
+    using Tree = RedBlackTree<Interval<T>, IntervalOrder<T>, Allocator, TreeNode<Interval<T>, MaxHighAugmentation<T>>>;
+    using Node = TreeNode<Interval<T>, MaxHighAugmentation<T>>;
+
+public:
+    using Iterator = typename Tree::Iterator;
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    // Default constructor
+    IntervalTree() = default;
+    // Construct tree from the range of intervals, sorted range is built in linear time
+    template <typename InputIt> IntervalTree(InputIt first, InputIt last) : m_tree(first, last) {}
+
+    // Number of intervals in the tree
+    size_t size() const { return m_tree.size(); }
+    // Is tree empty
+    bool empty() const { return m_tree.empty(); }
+    // Iterator to the interval with the minimal start
+    Iterator begin() const { return m_tree.begin(); }
+    // Iterator past the interval with the maximal start
+    Iterator end() const { return m_tree.end(); }
+    // Erase all intervals
+    void clear() { m_tree.clear(); }
+
+    // Insert interval into the tree, equal intervals are kept
+    void insert(const Interval<T> &interval) { m_tree.insert(interval); }
+    void insert(const T &low, const T &high) { m_tree.insert(Interval<T>{low, high}); }
+    // Erase one interval, equal to the given one, if there is any
+    void erase(const Interval<T> &interval) { m_tree.erase(interval); }
+    // Check, if tree contains the interval
+    bool contains(const Interval<T> &interval) const { return m_tree.contains(interval); }
+
+    // Some interval, that contains the point, nullptr if there is none, O(log n)
+    const Interval<T> *find_containing(const T &point) const;
+    // Call visit for every interval, that overlaps [low, high], in the ascending order
+    // Visits O(log n + k log(n / k)) nodes for k reported intervals
+    template <typename Visit> void for_each_overlapping(const T &low, const T &high, Visit visit) const {
+        for_each_overlapping(m_tree.m_root, low, high, visit);
+    }
+    // All intervals, that overlap [low, high], in the ascending order
+    std::vector<Interval<T>> overlapping(const T &low, const T &high) const {
+        std::vector<Interval<T>> intervals;
+        for_each_overlapping(low, high, [&intervals](const Interval<T> &interval) { intervals.push_back(interval); });
+        return intervals;
+    }
+
+    // Split the tree into trees with intervals, starting before start and not before it
+    // Destroys tree, returning two trees instead
+    std::pair<IntervalTree, IntervalTree> split(const T &start) {
+        auto [left, right] = m_tree.split(Interval<T>{start, std::numeric_limits<T>::lowest()});
+        return {IntervalTree(std::move(left)), IntervalTree(std::move(right))};
+    }
+    // Join another tree into this, intervals of other must start not before intervals of this, other becomes empty
+    void join(IntervalTree &other) { m_tree.join(other.m_tree); }
+
+private:
+    // Intervals
+    Tree m_tree;
+
+    explicit IntervalTree(Tree &&tree) : m_tree(std::move(tree)) {}
+
+    // Visit overlapping intervals of the subtree
+    template <typename Visit>
+    static void for_each_overlapping(const Node *node, const T &low, const T &high, Visit &visit);
+}; // class IntervalTree
+
+template <typename T, template <typename> class Allocator>
+const Interval<T> *IntervalTree<T, Allocator>::find_containing(const T &point) const {
+    const Node *node = m_tree.m_root;
+    while (node) {
+        const Interval<T> &interval = node->get_key();
+        if (interval.overlaps(point, point)) {
+            return &interval;
+        }
+        // If some interval on the left ends after the point, but doesn't contain it, it starts after the point,
+        // and so do all intervals on the right
+        const Node *left = node->get_left();
+        node = left && !(left->get_aggregate() < point) ? left : node->get_right();
+    }
+    return nullptr;
+}
+
+template <typename T, template <typename> class Allocator>
+template <typename Visit>
+void IntervalTree<T, Allocator>::for_each_overlapping(const Node *node, const T &low, const T &high, Visit &visit) {
+    // Depth is O(log n), so the recursion is bounded
+    if (!node || node->get_aggregate() < low) {
+        return;
+    }
+    for_each_overlapping(node->get_left(), low, high, visit);
+    const Interval<T> &interval = node->get_key();
+    if (high < interval.low) {
+        return;
+    }
+    if (!(interval.high < low)) {
+        visit(interval);
+    }
+    for_each_overlapping(node->get_right(), low, high, visit);
+}
+
+} // namespace Task1
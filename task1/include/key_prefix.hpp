@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace Task1 {
+
+// Order of the strings of std::less, that also compares them three-way in one pass over their common part
+struct StringCompare {
+    using is_transparent = void;
+
+    bool operator()(std::string_view lhs, std::string_view rhs) const { return lhs < rhs; }
+    int compare(std::string_view lhs, std::string_view rhs) const { return lhs.compare(rhs); }
+};
+
+// Comparator is three-way for L and R, if it has compare(lhs, rhs), returning negative, zero or positive,
+// then equal keys are told apart from the ordered ones by one comparison instead of two
+template <typename Comparator, typename L, typename R, typename = void> struct IsThreeWay : std::false_type {};
+template <typename Comparator, typename L, typename R>
+struct IsThreeWay<Comparator, L, R,
+                  std::void_t<decltype(Comparator().compare(std::declval<const L &>(), std::declval<const R &>()))>>
+    : std::true_type {};
+
+// Fixed-width prefix of the key, cached in the node, so that comparisons with the node don't read the key itself.
+// Prefixes are ordered as their keys, where they differ, equal prefixes leave the order to the comparator
+template <typename KeyT> struct KeyPrefix {
+    static constexpr bool Enabled = false;
+    template <typename Comparator> static constexpr bool KeepsOrder = false;
+};
+
+template <> struct KeyPrefix<std::string> {
+    static constexpr bool Enabled = true;
+    // Comparators of the bytewise lexicographic order, which the prefixes keep
+    template <typename Comparator>
+    static constexpr bool KeepsOrder = std::is_same_v<Comparator, std::less<std::string>> ||
+                                       std::is_same_v<Comparator, std::less<>> ||
+                                       std::is_same_v<Comparator, StringCompare>;
+
+    // First 8 bytes of the key as the big-endian number, shorter keys are padded with zeros
+    static uint64_t make(std::string_view key) {
+        unsigned char bytes[sizeof(uint64_t)] = {};
+        std::memcpy(bytes, key.data(), std::min(key.size(), sizeof(bytes)));
+        uint64_t prefix = 0;
+        for (unsigned char byte : bytes) {
+            prefix = prefix << 8 | byte;
+        }
+        return prefix;
+    }
+};
+
+// Prefix, stored in the node, empty unless it is cached
+template <typename KeyT, bool Cached> class PrefixStorage {
+public:
+    static_assert(KeyPrefix<KeyT>::Enabled, "Prefix is defined only for the keys with KeyPrefix");
+
+    // Get prefix of the key of the node
+    uint64_t get_prefix() const { return m_prefix; }
+
+protected:
+    // Compute prefix of the new key of the node
+    void set_prefix(const KeyT &key) { m_prefix = KeyPrefix<KeyT>::make(key); }
+
+private:
+    uint64_t m_prefix = 0;
+};
+
+template <typename KeyT> class PrefixStorage<KeyT, false> {
+protected:
+    void set_prefix(const KeyT &) {}
+};
+
+// Does node cache prefix of its key
+template <typename NodeT, typename = void> struct CachesPrefix : std::false_type {};
+template <typename NodeT>
+struct CachesPrefix<NodeT, std::void_t<decltype(std::declval<const NodeT &>().get_prefix())>> : std::true_type {};
+
+} // namespace Task1
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "tree.hpp"
+
+#include <functional>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+namespace Task1 {
+
+// Key/value pair, stored in the RedBlackMap.
+// Value doesn't take part in the ordering, so it may be changed through the iterator of the tree
+template <typename K, typename V> struct MapEntry final {
+    K first;
+    mutable V second;
+
+    MapEntry() = default;
+    // Construct key from key_arg and value from args in place
+    template <typename KeyArg, typename... Args>
+    MapEntry(std::in_place_t, KeyArg &&key_arg, Args &&...args)
+        : first(std::forward<KeyArg>(key_arg)), second(std::forward<Args>(args)...) {}
+};
+
+// Entries are dumped to graphviz by their keys
+template <typename K, typename V> std::ostream &operator<<(std::ostream &out, const MapEntry<K, V> &entry) {
+    return out << entry.first;
+}
+
+// Augmentation of the entries by the values of the map
+template <typename Augmentation> struct ValueAugmentation : Augmentation {
+    template <typename K, typename V> static auto lift(const MapEntry<K, V> &entry) {
+        return Augmentation::lift(entry.second);
+    }
+};
+
+// Map from unique keys to values, built on top of the RedBlackTree of entries
+// Map with the Augmentation keeps aggregates of the values, that must be changed only by insert_or_assign then
+template <typename K, typename V, typename Comparator = std::less<K>,
+          template <typename> class Allocator = NewDeleteAllocator, typename Augmentation = NoAugmentation>
+class RedBlackMap final {
+    using Entry = MapEntry<K, V>;
+    using EntryAugmentation =
+        std::conditional_t<std::is_same_v<Augmentation, NoAugmentation>, NoAugmentation, ValueAugmentation<Augmentation>>;
+
+    // Orders entries by keys, entries are also compared with bare keys to look them up without an entry
+    struct EntryComparator {
+        using is_transparent = void;
+
+        bool operator()(const Entry &lhs, const Entry &rhs) const { return Comparator()(lhs.first, rhs.first); }
+        template <typename L> bool operator()(const L &lhs, const Entry &rhs) const {
+            return Comparator()(lhs, rhs.first);
+        }
+        template <typename R> bool operator()(const Entry &lhs, const R &rhs) const {
+            return Comparator()(lhs.first, rhs);
+        }
+    };
+
+    using Tree = RedBlackTree<Entry, EntryComparator, Allocator, TreeNode<Entry, EntryAugmentation>>;
+
+public:
+    using Iterator = typename Tree::Iterator;
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    // Number of entries in the map
+    size_t size() const { return m_tree.size(); }
+    // Is map empty
+    bool empty() const { return m_tree.empty(); }
+    // Iterator to the entry with the minimal key
+    Iterator begin() const { return m_tree.begin(); }
+    // Iterator past the entry with the maximal key
+    Iterator end() const { return m_tree.end(); }
+    // Erase all entries
+    void clear() { m_tree.clear(); }
+
+    // Iterator to the entry with the key, end() if there is none
+    Iterator find(const K &key) const { return find_entry(key); }
+    // Check, if map contains entry with the key
+    bool contains(const K &key) const { return m_tree.contains(key); }
+
+    // Insert entry with value, constructed from args, if there is no entry with the key yet
+    // returns iterator to the entry with the key and whether it was inserted
+    template <typename... Args> std::pair<Iterator, bool> try_emplace(const K &key, Args &&...args) {
+        return try_emplace_entry(key, std::forward<Args>(args)...);
+    }
+    template <typename... Args> std::pair<Iterator, bool> try_emplace(K &&key, Args &&...args) {
+        return try_emplace_entry(std::move(key), std::forward<Args>(args)...);
+    }
+    // Insert entry with the value or assign value to the existing entry with the key
+    // returns iterator to the entry with the key and whether it was inserted
+    template <typename M> std::pair<Iterator, bool> insert_or_assign(const K &key, M &&value) {
+        return insert_or_assign_entry(key, std::forward<M>(value));
+    }
+    template <typename M> std::pair<Iterator, bool> insert_or_assign(K &&key, M &&value) {
+        return insert_or_assign_entry(std::move(key), std::forward<M>(value));
+    }
+    // Value of the entry with the key, default-constructed entry is inserted if there is none
+    // Aggregates aren't updated on the changes through the reference, so augmented maps don't have it
+    V &operator[](const K &key) {
+        static_assert(std::is_same_v<Augmentation, NoAugmentation>, "Augmented map is changed by insert_or_assign");
+        return try_emplace(key).first->second;
+    }
+    V &operator[](K &&key) {
+        static_assert(std::is_same_v<Augmentation, NoAugmentation>, "Augmented map is changed by insert_or_assign");
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    // Aggregate of the values with keys in [low, high] in O(log n), map must be augmented
+    auto aggregate(const K &low, const K &high) const { return m_tree.aggregate(low, high); }
+
+    // Erase entry with the key, returns number of erased entries
+    size_t erase(const K &key) {
+        size_t old_size = m_tree.size();
+        m_tree.erase(key);
+        return old_size - m_tree.size();
+    }
+
+private:
+    // Entries of the map
+    Tree m_tree;
+
+    template <typename KeyArg> Iterator find_entry(const KeyArg &key) const {
+        Iterator it = m_tree.lower_bound(key);
+        return is_entry(it, key) ? it : m_tree.end();
+    }
+
+    // Is the entry at the lower bound of the key the entry of this key
+    template <typename KeyArg> bool is_entry(Iterator it, const KeyArg &key) const {
+        return it != m_tree.end() && !Comparator()(key, it->first);
+    }
+
+    // Lower bound of the missing key is the hint for its insertion, so the tree isn't searched twice
+    template <typename KeyArg, typename... Args> std::pair<Iterator, bool> try_emplace_entry(KeyArg &&key, Args &&...args) {
+        Iterator it = m_tree.lower_bound(key);
+        if (is_entry(it, key)) {
+            return {it, false};
+        }
+        // Key is moved only here, when it is not needed for the lookup anymore
+        return {m_tree.emplace_hint(it, std::in_place, std::forward<KeyArg>(key), std::forward<Args>(args)...), true};
+    }
+
+    template <typename KeyArg, typename M> std::pair<Iterator, bool> insert_or_assign_entry(KeyArg &&key, M &&value) {
+        Iterator it = m_tree.lower_bound(key);
+        if (is_entry(it, key)) {
+            it->second = std::forward<M>(value);
+            m_tree.refresh(it);
+            return {it, false};
+        }
+        return {m_tree.emplace_hint(it, std::in_place, std::forward<KeyArg>(key), std::forward<M>(value)), true};
+    }
+}; // class RedBlackMap
+
+} // namespace Task1
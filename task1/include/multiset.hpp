@@ -0,0 +1,240 @@
+#pragma once
+
+#include "tree.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace Task1 {
+
+// Distinct key with the number of its copies, stored in the RedBlackMultiset.
+// Count doesn't take part in the ordering, so the multiset changes it in place
+template <typename K> struct MultisetEntry final {
+    K key;
+    mutable size_t count = 0;
+
+    MultisetEntry() = default;
+    // Construct key from key_arg
+    template <typename KeyArg>
+    MultisetEntry(std::in_place_t, KeyArg &&key_arg, size_t key_count)
+        : key(std::forward<KeyArg>(key_arg)), count(key_count) {}
+};
+
+// Entries are dumped to graphviz by their keys and counts
+template <typename K> std::ostream &operator<<(std::ostream &out, const MultisetEntry<K> &entry) {
+    return out << entry.key << " x" << entry.count;
+}
+
+// Number of keys of the subtree with their copies
+struct MultiplicityAugmentation {
+    using value_type = uint64_t;
+    static uint64_t identity() { return 0; }
+    template <typename K> static uint64_t lift(const MultisetEntry<K> &entry) { return entry.count; }
+    static uint64_t combine(uint64_t lhs, uint64_t rhs) { return lhs + rhs; }
+};
+
+// Multiset, that keeps the run of equal keys in the single node with its count, built on top of the RedBlackTree
+// of entries. Depth and number of nodes depend only on the number of distinct keys, split and join move the run
+// as a whole, and the subtree counts give the number of keys in the range in O(log n)
+template <typename K, typename Comparator = std::less<K>, template <typename> class Allocator = NewDeleteAllocator>
+class RedBlackMultiset final {
+    using Entry = MultisetEntry<K>;
+
+    // Orders entries by keys, entries are also compared with bare keys to look them up without an entry
+    struct EntryComparator {
+        using is_transparent = void;
+
+        bool operator()(const Entry &lhs, const Entry &rhs) const { return Comparator()(lhs.key, rhs.key); }
+        template <typename L> bool operator()(const L &lhs, const Entry &rhs) const {
+            return Comparator()(lhs, rhs.key);
+        }
+        template <typename R> bool operator()(const Entry &lhs, const R &rhs) const {
+            return Comparator()(lhs.key, rhs);
+        }
+    };
+
+    using Tree = RedBlackTree<Entry, EntryComparator, Allocator, TreeNode<Entry, MultiplicityAugmentation>>;
+
+public:
+    // Iterates over the distinct keys, count of the entry must be changed only by the multiset
+    using Iterator = typename Tree::Iterator;
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    RedBlackMultiset() = default;
+    // Construct multiset from the range of keys in O(k log k)
+    // Keys are sorted, runs of equal keys are collapsed into entries and the tree is built from them in O(n)
+    template <typename InputIt> RedBlackMultiset(InputIt first, InputIt last);
+
+    // Number of keys with their copies
+    size_t size() const { return m_size; }
+    // Number of distinct keys, that is the number of nodes
+    size_t distinct_size() const { return m_tree.size(); }
+    // Is multiset empty
+    bool empty() const { return m_tree.empty(); }
+    // Iterator to the entry with the minimal key
+    Iterator begin() const { return m_tree.begin(); }
+    // Iterator past the entry with the maximal key
+    Iterator end() const { return m_tree.end(); }
+    // Erase all keys
+    void clear() {
+        m_tree.clear();
+        m_size = 0;
+    }
+
+    // Iterator to the entry of the key, end() if there is none
+    Iterator find(const K &key) const {
+        Iterator it = m_tree.lower_bound(key);
+        return is_entry(it, key) ? it : m_tree.end();
+    }
+    // Check, if multiset contains the key
+    bool contains(const K &key) const { return m_tree.contains(key); }
+    // Number of copies of the key
+    size_t count(const K &key) const {
+        Iterator it = find(key);
+        return it != end() ? it->count : 0;
+    }
+    // Number of keys in [low, high] with their copies in O(log n)
+    size_t count_in_range(const K &low, const K &high) const {
+        return Comparator()(high, low) ? 0 : m_tree.aggregate(low, high);
+    }
+
+    // Insert count copies of the key, returns iterator to its entry
+    Iterator insert(const K &key, size_t count = 1);
+    // Erase one copy of the key, returns whether there was any
+    bool erase_one(const K &key);
+    // Erase all copies of the key, returns their number
+    size_t erase_all(const K &key);
+
+    // Join another multiset into this, keys of other must be greater than keys of this, other becomes empty
+    void join(RedBlackMultiset &other);
+    // Split the multiset by the given key into multisets with keys less than key and not less than key
+    // Destroys multiset, returning two multisets instead, all copies of the key go to the right one
+    std::pair<RedBlackMultiset, RedBlackMultiset> split(const K &key);
+    // Add keys of other multiset into this, counts of the equal keys are summed, other becomes empty
+    // Trees are united with split and join in O(m log(n/m + 1))
+    void merge(RedBlackMultiset &other);
+
+    // Check invariants of the tree and the counts in O(n)
+    bool validate() const;
+
+private:
+    // Entries of the distinct keys
+    Tree m_tree;
+    // Number of keys with their copies
+    size_t m_size = 0;
+
+    // Is the entry at the lower bound of the key the entry of this key
+    bool is_entry(Iterator it, const K &key) const { return it != m_tree.end() && !Comparator()(key, it->key); }
+    // Number of keys of the tree with their copies in O(log n)
+    static size_t total(const Tree &tree) {
+        return tree.empty() ? 0 : tree.aggregate(*tree.begin(), *std::prev(tree.end()));
+    }
+}; // class RedBlackMultiset
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+template <typename InputIt>
+RedBlackMultiset<K, Comparator, Allocator>::RedBlackMultiset(InputIt first, InputIt last) {
+    std::vector<K> keys(first, last);
+    std::sort(keys.begin(), keys.end(), Comparator());
+
+    std::vector<Entry> entries;
+    for (auto run = keys.begin(); run != keys.end();) {
+        auto run_end = std::upper_bound(run, keys.end(), *run, Comparator());
+        entries.emplace_back(std::in_place, std::move(*run), static_cast<size_t>(run_end - run));
+        run = run_end;
+    }
+    m_tree.assign(entries.begin(), entries.end());
+    m_size = keys.size();
+}
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+typename RedBlackMultiset<K, Comparator, Allocator>::Iterator
+RedBlackMultiset<K, Comparator, Allocator>::insert(const K &key, size_t count) {
+    if (count == 0) {
+        return find(key);
+    }
+    m_size += count;
+    // Lower bound of the missing key is the hint for its insertion, so the tree isn't searched twice
+    Iterator it = m_tree.lower_bound(key);
+    if (is_entry(it, key)) {
+        it->count += count;
+        m_tree.refresh(it);
+        return it;
+    }
+    return m_tree.emplace_hint(it, std::in_place, key, count);
+}
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+bool RedBlackMultiset<K, Comparator, Allocator>::erase_one(const K &key) {
+    Iterator it = find(key);
+    if (it == end()) {
+        return false;
+    }
+    m_size -= 1;
+    if (it->count == 1) {
+        m_tree.erase(key);
+    } else {
+        it->count -= 1;
+        m_tree.refresh(it);
+    }
+    return true;
+}
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+size_t RedBlackMultiset<K, Comparator, Allocator>::erase_all(const K &key) {
+    size_t erased = count(key);
+    if (erased != 0) {
+        m_tree.erase(key);
+        m_size -= erased;
+    }
+    return erased;
+}
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+void RedBlackMultiset<K, Comparator, Allocator>::join(RedBlackMultiset &other) {
+    m_tree.join(other.m_tree);
+    m_size += other.m_size;
+    other.m_size = 0;
+}
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+std::pair<RedBlackMultiset<K, Comparator, Allocator>, RedBlackMultiset<K, Comparator, Allocator>>
+RedBlackMultiset<K, Comparator, Allocator>::split(const K &key) {
+    auto [left_tree, right_tree] = m_tree.split(Entry(std::in_place, key, 0));
+    std::pair<RedBlackMultiset, RedBlackMultiset> parts;
+    parts.first.m_size = total(left_tree);
+    parts.second.m_size = m_size - parts.first.m_size;
+    parts.first.m_tree = std::move(left_tree);
+    parts.second.m_tree = std::move(right_tree);
+    m_size = 0;
+    return parts;
+}
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+void RedBlackMultiset<K, Comparator, Allocator>::merge(RedBlackMultiset &other) {
+    m_tree.union_with(other.m_tree, [](const Entry &kept, const Entry &dropped) { kept.count += dropped.count; });
+    m_size += other.m_size;
+    other.m_size = 0;
+}
+
+template <typename K, typename Comparator, template <typename> class Allocator>
+bool RedBlackMultiset<K, Comparator, Allocator>::validate() const {
+    if (!m_tree.validate() || total(m_tree) != m_size) {
+        return false;
+    }
+    for (const Entry &entry : m_tree) {
+        if (entry.count == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace Task1
@@ -3,7 +3,10 @@
 #include <cassert>
 #include <inttypes.h>
 #include <iostream>
+#include <utility>
 
+#include "augmentation.hpp"
+#include "key_prefix.hpp"
 #include "side.hpp"
 
 namespace Task1 {
@@ -11,8 +14,53 @@ namespace Task1 {
 // Colour of the TreeNode
 enum class Color { Red, Black };
 
-// Node of the RedBlackTree
-template <typename KeyT> class TreeNode final {
+// Dump subtree of the node to graphviz
+// log - log ostream
+// counter - number visited nodes counter
+// returns number of the node in reverse post order
+template <typename NodeT>
+uint64_t dump_node_to_graphviz(const NodeT *node, uint64_t &counter, std::ostream &log) {
+  uint64_t num_left = 0;
+  uint64_t num_right = 0;
+  if (node->get_left()) {
+    num_left = dump_node_to_graphviz(node->get_left(), counter, log);
+  }
+  if (node->get_right()) {
+    num_right = dump_node_to_graphviz(node->get_right(), counter, log);
+  }
+
+  std::string color_str = node->get_color() == Color::Red ? "Red" : "Grey";
+  std::string side_str;
+  if (node->get_side() == Side::None) {
+    side_str = "None";
+  } else {
+    side_str = node->get_side() == Side::Left ? "Left" : "Right";
+  }
+
+  log << "\t\"node" << counter
+      << "\" [shape = \"circle\", style = \"filled\", fillcolor = \""
+      << color_str << "\", label = \""
+      << "key = " << node->get_key() << '\n'
+      << "height = " << node->get_height() << '\n'
+      << "size = " << node->get_size() << '\n'
+      << "side = " << side_str << "\"]\n";
+
+  if (node->get_left()) {
+    log << "\t\"node" << counter << "\" -- \"node" << num_left << "\"\n";
+  }
+  if (node->get_right()) {
+    log << "\t\"node" << counter << "\" -- \"node" << num_right << "\"\n";
+  }
+
+  counter += 1;
+  return counter - 1;
+}
+
+// Node of the RedBlackTree, that keeps aggregate of its subtree for the Augmentation
+// and, with CachePrefix, prefix of its key ahead of the key, so that most comparisons don't read the key
+template <typename KeyT, typename AugmentationT = NoAugmentation, bool CachePrefix = false>
+class TreeNode final : public AugmentationStorage<AugmentationT>,
+                       public PrefixStorage<KeyT, CachePrefix> {
 private:
   // Value hold in the node
   KeyT m_key;
@@ -30,8 +78,12 @@ private:
   Side m_side = Side::None;
   // Black height of the node
   uint64_t m_height = 0;
+  // Number of nodes in the subtree of the node
+  uint64_t m_size = 1;
 
 public:
+  using Augmentation = AugmentationT;
+
   // Get value hold in the node
   const KeyT &get_key() const { return m_key; }
   // Get color of the node
@@ -87,13 +139,18 @@ public:
   uint64_t get_height() const { return m_height; }
   // Set black height of the node
   void set_height(uint64_t height) { m_height = height; }
+  // Get number of nodes in the subtree of the node
+  uint64_t get_size() const { return m_size; }
+  // Set number of nodes in the subtree of the node
+  void set_size(uint64_t size) { m_size = size; }
 
   // TreeNode constructor
-  TreeNode(const KeyT &key, TreeNode<KeyT> *parent = nullptr,
-           TreeNode<KeyT> *left = nullptr, TreeNode<KeyT> *right = nullptr,
+  TreeNode(const KeyT &key, TreeNode *parent = nullptr,
+           TreeNode *left = nullptr, TreeNode *right = nullptr,
            Color color = Color::Red, Side side = Side::None)
       : m_key(key), m_right(right), m_left(left), m_parent(parent),
         m_color(color), m_side(side) {
+    this->set_prefix(m_key);
     if (m_right) {
       m_right->m_parent = this;
     }
@@ -102,9 +159,19 @@ public:
     }
   }
 
+  // TreeNode constructor, constructing the key in place
+  template <typename... Args>
+  TreeNode(std::in_place_t, Args &&...args)
+      : m_key(std::forward<Args>(args)...) {
+    this->set_prefix(m_key);
+  }
+
   // Constructor, with data from other node
   TreeNode(const TreeNode *other)
-      : m_color(other->m_color), m_key(other->m_key) {}
+      : AugmentationStorage<AugmentationT>(*other),
+        PrefixStorage<KeyT, CachePrefix>(*other), m_key(other->m_key),
+        m_color(other->m_color),
+        m_height(other->m_height), m_size(other->m_size) {}
 
   TreeNode(TreeNode *left, TreeNode *right, TreeNode *parent)
       : m_right(right), m_left(left), m_parent(parent), m_color(Color::Black) {}
@@ -113,50 +180,23 @@ public:
     set_left(left);
     set_right(right);
   }
-  // Copy data from other node
-  void copy_data(const TreeNode *other) {
-    m_key = other->m_key;
+  // Move data from other node, that is going to be destroyed
+  void move_data(TreeNode *other) {
+    m_key = std::move(other->m_key);
+    this->set_prefix(m_key);
   }
 
   // Dump Node to graphviz
   // log - log ostream
   // counter - number visited nodes counter
   // returns number of the node in reverse post order
-  uint64_t dump_to_graphviz(uint64_t &counter, std::ostream &log) {
-    uint64_t num_left = 0;
-    uint64_t num_right = 0;
-    if (m_left) {
-      num_left = m_left->dump_to_graphviz(counter, log);
-    }
-    if (m_right) {
-      num_right = m_right->dump_to_graphviz(counter, log);
-    }
-
-    std::string color_str = m_color == Color::Red ? "Red" : "Grey";
-    std::string side_str;
-    if (m_side == Side::None) {
-      side_str = "None";
-    } else {
-      side_str = m_side == Side::Left ? "Left" : "Right";
-    }
-
-    log << "\t\"node" << counter
-        << "\" [shape = \"circle\", style = \"filled\", fillcolor = \""
-        << color_str << "\", label = \""
-        << "key = " << m_key << '\n'
-        << "height = " << m_height  << '\n'
-        << "side = " << side_str << "\"]\n";
-
-    if (m_left) {
-      log << "\t\"node" << counter << "\" -- \"node" << num_left << "\"\n";
-    }
-    if (m_right) {
-      log << "\t\"node" << counter << "\" -- \"node" << num_right << "\"\n";
-    }
-
-    counter += 1;
-    return counter - 1;
+  uint64_t dump_to_graphviz(uint64_t &counter, std::ostream &log) const {
+    return dump_node_to_graphviz(this, counter, log);
   }
 }; // class TreeNode
 
+// Node of the RedBlackTree, that caches prefix of its key for the comparisons
+template <typename KeyT, typename AugmentationT = NoAugmentation>
+using PrefixTreeNode = TreeNode<KeyT, AugmentationT, true>;
+
 } // namespace Task1
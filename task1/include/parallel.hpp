@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Task1 {
+
+// How the bulk operation on the tree is executed
+enum class Execution { Sequential, Parallel };
+
+// Minimal number of keys, processed by the single task
+constexpr size_t MinParallelGrain = 4096;
+// Black height of the subtree, below which recursive algorithms stop forking tasks
+constexpr uint64_t MinParallelBlackHeight = 8;
+
+// Number of keys, below which the parallel algorithm continues sequentially
+inline size_t parallel_grain(size_t size) {
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    return std::max(MinParallelGrain, size / (4 * threads));
+}
+
+// Pool of worker threads with work stealing.
+// Every thread pushes forked tasks into its own deque and pops them from the back,
+// idle threads steal the oldest tasks from the front of other deques.
+class TaskPool final {
+public:
+    // Task, that may be executed by any thread of the pool
+    struct Task {
+        // Function to execute
+        std::function<void()> m_func;
+        // Exception, thrown by the function, it is rethrown by the thread, that has forked the task
+        std::exception_ptr m_exception;
+        // Is task finished, set even if the function has thrown
+        std::atomic<bool> m_done = false;
+    };
+
+private:
+    // Deque of the tasks, owned by the single thread
+    struct Deque {
+        std::mutex m_mutex;
+        std::deque<Task *> m_tasks;
+    };
+
+    // Deques of workers, the last one is shared by all threads outside the pool
+    std::vector<std::unique_ptr<Deque>> m_deques;
+    // Worker threads
+    std::vector<std::thread> m_threads;
+    // Number of tasks in all deques
+    std::atomic<size_t> m_pending = 0;
+    // Is pool shutting down
+    std::atomic<bool> m_stop = false;
+    // Idle workers sleep on it, until new tasks are pushed, waiters also sleep on it, until their task is finished
+    std::condition_variable m_wakeup;
+    std::mutex m_wakeup_mutex;
+    // Number of threads, sleeping in wait
+    std::atomic<size_t> m_waiting = 0;
+
+    // Number of failed attempts to find a task, after which the waiter goes to sleep
+    static constexpr size_t WaitSpins = 64;
+
+    // Deque of the calling thread
+    Deque &own_deque();
+    // Pop the newest task from the own deque
+    Task *pop(Deque &deque);
+    // Steal the oldest task from any deque, victims are scanned from the rotating start, so thieves don't contend
+    Task *steal();
+    // Execute the task, catching its exception
+    void run(Task *task);
+    // Main loop of the worker thread
+    void worker_loop(size_t index);
+
+    TaskPool(size_t threads);
+
+public:
+    ~TaskPool();
+
+    // Pool, shared by all trees
+    static TaskPool &instance();
+
+    // Push the task into the deque of the calling thread
+    void push(Task *task);
+    // Execute other tasks until the given one is finished, sleep, while there are none
+    void wait(Task *task);
+}; // class TaskPool
+
+// Run both functions and wait for them, first one may be stolen by the other thread.
+// If any function throws, the exception is rethrown after both are finished, that of the right one first
+template <typename LeftFunc, typename RightFunc> void fork_join(LeftFunc &&left, RightFunc &&right) {
+    TaskPool &pool = TaskPool::instance();
+    TaskPool::Task left_task;
+    left_task.m_func = std::forward<LeftFunc>(left);
+    pool.push(&left_task);
+    // Left task stays in the deque, until it is finished, so it must be waited for even if right throws
+    std::exception_ptr right_exception;
+    try {
+        right();
+    } catch (...) {
+        right_exception = std::current_exception();
+    }
+    pool.wait(&left_task);
+    if (right_exception) {
+        std::rethrow_exception(right_exception);
+    }
+    if (left_task.m_exception) {
+        std::rethrow_exception(left_task.m_exception);
+    }
+}
+
+// Run both functions, in parallel only if execution is parallel
+template <typename LeftFunc, typename RightFunc>
+void fork_join(Execution execution, LeftFunc &&left, RightFunc &&right) {
+    if (execution == Execution::Parallel) {
+        fork_join(std::forward<LeftFunc>(left), std::forward<RightFunc>(right));
+    } else {
+        left();
+        right();
+    }
+}
+
+} // namespace Task1
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "node.hpp"
+
+namespace Task1 {
+
+template <typename KeyT> class PersistentTreeNode;
+
+// Owning reference to the PersistentTreeNode, node is freed with its last reference
+template <typename KeyT> class PersistentNodePtr final {
+private:
+  using Node = PersistentTreeNode<KeyT>;
+
+  // Referenced node
+  Node *m_node = nullptr;
+
+public:
+  PersistentNodePtr() = default;
+  // Take ownership of the just created node
+  explicit PersistentNodePtr(Node *node) : m_node(node) {}
+  PersistentNodePtr(const PersistentNodePtr &other) : m_node(other.m_node) {
+    if (m_node) {
+      m_node->acquire();
+    }
+  }
+  PersistentNodePtr(PersistentNodePtr &&other) noexcept
+      : m_node(std::exchange(other.m_node, nullptr)) {}
+  PersistentNodePtr &operator=(PersistentNodePtr other) noexcept {
+    std::swap(m_node, other.m_node);
+    return *this;
+  }
+  ~PersistentNodePtr() {
+    if (m_node) {
+      m_node->release();
+    }
+  }
+
+  Node *get() const { return m_node; }
+  Node *operator->() const { return m_node; }
+  explicit operator bool() const { return m_node != nullptr; }
+}; // class PersistentNodePtr
+
+// Node of the PersistentRedBlackTree.
+// Node may be shared by several trees, so it is modified only while it has the single reference.
+template <typename KeyT> class PersistentTreeNode final {
+private:
+  // Value hold in the node
+  KeyT m_key;
+  // Left and right children of the node, indexed by the side
+  PersistentNodePtr<KeyT> m_links[2];
+  // Number of references to the node
+  std::atomic<uint32_t> m_refs = 1;
+  // Color of the node
+  Color m_color = Color::Red;
+  // Black height of the node
+  uint32_t m_height = 0;
+  // Number of nodes in the subtree of the node
+  uint64_t m_size = 1;
+
+public:
+  // PersistentTreeNode constructor
+  PersistentTreeNode(const KeyT &key) : m_key(key) {}
+  // Copy of other node, sharing its children
+  PersistentTreeNode(const PersistentTreeNode *other)
+      : m_key(other->m_key), m_links{other->m_links[0], other->m_links[1]},
+        m_color(other->m_color), m_height(other->m_height),
+        m_size(other->m_size) {}
+
+  // Get value hold in the node
+  const KeyT &get_key() const { return m_key; }
+  // Get color of the node
+  Color get_color() const { return m_color; }
+  // Set color of the node
+  void set_color(Color color) { m_color = color; }
+  // Get child of the given side, picked without a branch
+  const PersistentTreeNode *get_child(Side side) const {
+    return m_links[side == Side::Right].get();
+  }
+  // Get left child of the node
+  const PersistentTreeNode *get_left() const { return m_links[0].get(); }
+  // Get right child of the node
+  const PersistentTreeNode *get_right() const { return m_links[1].get(); }
+  // Link to the left child, to move subtrees in and out
+  PersistentNodePtr<KeyT> &left_link() { return m_links[0]; }
+  // Link to the right child, to move subtrees in and out
+  PersistentNodePtr<KeyT> &right_link() { return m_links[1]; }
+  // Get black height of the node
+  uint64_t get_height() const { return m_height; }
+  // Set black height of the node
+  void set_height(uint64_t height) { m_height = static_cast<uint32_t>(height); }
+  // Get number of nodes in the subtree of the node
+  uint64_t get_size() const { return m_size; }
+  // Set number of nodes in the subtree of the node
+  void set_size(uint64_t size) { m_size = size; }
+
+  // Is node referenced by more than one tree or node
+  bool is_shared() const { return m_refs.load(std::memory_order_acquire) > 1; }
+  // Add reference to the node
+  void acquire() { m_refs.fetch_add(1, std::memory_order_relaxed); }
+  // Drop reference to the node, freeing it with the last one
+  void release() {
+    if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+}; // class PersistentTreeNode
+
+} // namespace Task1
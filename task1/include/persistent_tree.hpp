@@ -0,0 +1,486 @@
+#pragma once
+
+#include "persistent_node.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Task1 {
+
+// Persistent RedBlackTree, built on split and join.
+// Modifications copy only the nodes on the path they touch, all other nodes are shared,
+// so copies and snapshots take O(1). Nodes, not shared with other trees, are modified in place.
+// Trees, sharing nodes, may be used from different threads,
+// but a single tree must not be modified concurrently with other accesses to it.
+template <typename KeyT, typename Comparator = std::less<KeyT>> class PersistentRedBlackTree final {
+    using Node = PersistentTreeNode<KeyT>;
+    using NodePtr = PersistentNodePtr<KeyT>;
+
+public:
+    // Forward iterator over the keys of the tree in the ascending order
+    // Tree must not be modified while it is iterated
+    class Iterator final {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = KeyT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const KeyT *;
+        using reference = const KeyT &;
+
+        Iterator() = default;
+
+        reference operator*() const { return m_path.back()->get_key(); }
+        pointer operator->() const { return &m_path.back()->get_key(); }
+
+        Iterator &operator++() {
+            const Node *node = m_path.back();
+            m_path.pop_back();
+            push_left_path(node->get_right());
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return m_path.empty() ? other.m_path.empty() : !other.m_path.empty() && m_path.back() == other.m_path.back();
+        }
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+    private:
+        friend class PersistentRedBlackTree;
+
+        explicit Iterator(const Node *root) { push_left_path(root); }
+
+        // Descend to the minimum of the subtree, remembering the path
+        void push_left_path(const Node *node) {
+            for (; node; node = node->get_left()) {
+                m_path.push_back(node);
+            }
+        }
+
+        // Nodes, whose keys are not visited yet, current node is the last one
+        std::vector<const Node *> m_path;
+    }; // class Iterator
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    // Default constructor
+    PersistentRedBlackTree() = default;
+    // Construct tree from the range of keys
+    template <typename InputIt> PersistentRedBlackTree(InputIt first, InputIt last);
+
+    // Point-in-time view of the tree, shares all nodes with it
+    PersistentRedBlackTree snapshot() const { return *this; }
+
+    // Insert key into the tree
+    void insert(const KeyT &key);
+    // Erase one key, equal to the given one, from the tree
+    void erase(const KeyT &key);
+    // Erase all keys from the tree
+    void clear() { m_root = NodePtr(); }
+
+    // Check, if tree contains given key
+    bool contains(const KeyT &key) const;
+    // Number of keys in the tree
+    size_t size() const { return get_size(m_root.get()); }
+    // Is tree empty
+    bool empty() const { return !m_root; }
+
+    // Iterator to the minimal key
+    Iterator begin() const { return Iterator(m_root.get()); }
+    // Iterator past the maximal key
+    Iterator end() const { return Iterator(); }
+
+    // k-th smallest key, counting from 0, k must be less than size
+    const KeyT &select(size_t k) const;
+    // Number of keys, less than key
+    size_t rank(const KeyT &key) const;
+
+    // Split the tree by the given key into trees with keys less than key and not less than key
+    // Tree itself is not changed, results share nodes with it
+    std::pair<PersistentRedBlackTree, PersistentRedBlackTree> split(const KeyT &key) const;
+    // Append keys of other tree, all of them must be not less than keys of this tree
+    void join(PersistentRedBlackTree other);
+
+private:
+    // Root of the tree
+    NodePtr m_root;
+
+    explicit PersistentRedBlackTree(NodePtr root) : m_root(std::move(root)) {}
+
+    // Get black height of the node, for nullptr - 0
+    static uint64_t get_height(const Node *node) { return node ? node->get_height() : 0; }
+    // Get number of nodes in the subtree, for nullptr - 0
+    static uint64_t get_size(const Node *node) { return node ? node->get_size() : 0; }
+    // Is node red, for nullptr - false
+    static bool is_red(const NodePtr &node) { return node && node->get_color() == Color::Red; }
+    // Recompute black height and size of the node from its children and color
+    static void update(Node *node);
+
+    // Make node owned only by the caller, copying it if it is shared
+    static Node *mutate(NodePtr &node);
+    // Make root of the subtree black
+    static void make_black(NodePtr &subroot);
+    // Rotate subtree to the left, returns new subroot
+    static NodePtr rotate_left(NodePtr subroot);
+    // Rotate subtree to the right, returns new subroot
+    static NodePtr rotate_right(NodePtr subroot);
+
+    // Detach children from the node
+    // returns left subtree, node without children and right subtree
+    static std::tuple<NodePtr, NodePtr, NodePtr> expose(NodePtr subroot);
+
+    // Join two subtrees, where height of the left subtree is greater than right subtree
+    static NodePtr join_right(NodePtr left_subroot, NodePtr key_node, NodePtr right_subroot);
+    // Join two subtrees, where height of the left subtree is less than right subtree
+    static NodePtr join_left(NodePtr left_subroot, NodePtr key_node, NodePtr right_subroot);
+    // Join two subtrees
+    static NodePtr join(NodePtr left_subroot, NodePtr key_node, NodePtr right_subroot);
+    // Join two subtrees without the key node
+    static NodePtr join(NodePtr left_subroot, NodePtr right_subroot);
+    // Split the node with the maximal key out of the subtree
+    // returns rest of the subtree and the maximal node
+    static std::pair<NodePtr, NodePtr> split_last(NodePtr subroot);
+    // Split subtree into subtrees with keys less than key and not less than key
+    static std::pair<NodePtr, NodePtr> split(NodePtr subroot, const KeyT &key);
+
+    // Fix red node with red child under the black root of the subtree, returns new subroot
+    // Only nodes on the insertion path may be red with red child, so only they are modified
+    static NodePtr balance(NodePtr subroot);
+    // Insert key into the subtree, copying only the path to it, returns new subroot
+    static NodePtr insert(NodePtr subroot, const KeyT &key);
+    // Erase key, contained in the subtree, returns new subroot
+    static NodePtr erase(NodePtr subroot, const KeyT &key);
+    // Build subtree from the sorted range of keys
+    template <typename RandomIt> static NodePtr build(RandomIt first, RandomIt last);
+}; // class PersistentRedBlackTree
+
+template <typename KeyT, typename Comparator>
+template <typename InputIt>
+PersistentRedBlackTree<KeyT, Comparator>::PersistentRedBlackTree(InputIt first, InputIt last) {
+    using Category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, Category>) {
+        if (std::is_sorted(first, last, Comparator())) {
+            m_root = build(first, last);
+            return;
+        }
+    }
+
+    std::vector<KeyT> keys(first, last);
+    std::sort(keys.begin(), keys.end(), Comparator());
+    m_root = build(keys.begin(), keys.end());
+}
+
+template <typename KeyT, typename Comparator> void PersistentRedBlackTree<KeyT, Comparator>::update(Node *node) {
+    uint64_t height = std::max(get_height(node->get_left()), get_height(node->get_right()));
+    node->set_height(height + (node->get_color() == Color::Black ? 1 : 0));
+    node->set_size(get_size(node->get_left()) + get_size(node->get_right()) + 1);
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::Node *PersistentRedBlackTree<KeyT, Comparator>::mutate(NodePtr &node) {
+    if (node->is_shared()) {
+        node = NodePtr(new Node(node.get()));
+    }
+    return node.get();
+}
+
+template <typename KeyT, typename Comparator> void PersistentRedBlackTree<KeyT, Comparator>::make_black(NodePtr &subroot) {
+    if (is_red(subroot)) {
+        Node *node = mutate(subroot);
+        node->set_color(Color::Black);
+        update(node);
+    }
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr PersistentRedBlackTree<KeyT, Comparator>::rotate_left(NodePtr subroot) {
+    NodePtr child = std::move(subroot->right_link());
+    mutate(child);
+    subroot->right_link() = std::move(child->left_link());
+    update(subroot.get());
+    child->left_link() = std::move(subroot);
+    update(child.get());
+    return child;
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr PersistentRedBlackTree<KeyT, Comparator>::rotate_right(NodePtr subroot) {
+    NodePtr child = std::move(subroot->left_link());
+    mutate(child);
+    subroot->left_link() = std::move(child->right_link());
+    update(subroot.get());
+    child->right_link() = std::move(subroot);
+    update(child.get());
+    return child;
+}
+
+template <typename KeyT, typename Comparator>
+std::tuple<typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr, typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr,
+           typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr>
+PersistentRedBlackTree<KeyT, Comparator>::expose(NodePtr subroot) {
+    if (subroot->is_shared()) {
+        NodePtr node(new Node(subroot->get_key()));
+        return {subroot->left_link(), std::move(node), subroot->right_link()};
+    }
+
+    NodePtr left = std::move(subroot->left_link());
+    NodePtr right = std::move(subroot->right_link());
+    return {std::move(left), std::move(subroot), std::move(right)};
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr
+PersistentRedBlackTree<KeyT, Comparator>::join_right(NodePtr left_subroot, NodePtr key_node, NodePtr right_subroot) {
+    if (!is_red(left_subroot) && get_height(left_subroot.get()) == get_height(right_subroot.get())) {
+        key_node->set_color(Color::Red);
+        key_node->left_link() = std::move(left_subroot);
+        key_node->right_link() = std::move(right_subroot);
+        update(key_node.get());
+        return key_node;
+    }
+
+    Node *node = mutate(left_subroot);
+    node->right_link() = join_right(std::move(node->right_link()), std::move(key_node), std::move(right_subroot));
+    update(node);
+
+    if (node->get_color() == Color::Black && is_red(node->right_link()) && is_red(node->right_link()->right_link())) {
+        make_black(node->right_link()->right_link());
+        return rotate_left(std::move(left_subroot));
+    }
+    return left_subroot;
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr
+PersistentRedBlackTree<KeyT, Comparator>::join_left(NodePtr left_subroot, NodePtr key_node, NodePtr right_subroot) {
+    if (!is_red(right_subroot) && get_height(left_subroot.get()) == get_height(right_subroot.get())) {
+        key_node->set_color(Color::Red);
+        key_node->left_link() = std::move(left_subroot);
+        key_node->right_link() = std::move(right_subroot);
+        update(key_node.get());
+        return key_node;
+    }
+
+    Node *node = mutate(right_subroot);
+    node->left_link() = join_left(std::move(left_subroot), std::move(key_node), std::move(node->left_link()));
+    update(node);
+
+    if (node->get_color() == Color::Black && is_red(node->left_link()) && is_red(node->left_link()->left_link())) {
+        make_black(node->left_link()->left_link());
+        return rotate_right(std::move(right_subroot));
+    }
+    return right_subroot;
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr
+PersistentRedBlackTree<KeyT, Comparator>::join(NodePtr left_subroot, NodePtr key_node, NodePtr right_subroot) {
+    make_black(left_subroot);
+    make_black(right_subroot);
+    uint64_t left_height = get_height(left_subroot.get());
+    uint64_t right_height = get_height(right_subroot.get());
+
+    NodePtr subroot;
+    if (left_height > right_height) {
+        subroot = join_right(std::move(left_subroot), std::move(key_node), std::move(right_subroot));
+        if (is_red(subroot) && is_red(subroot->right_link())) {
+            make_black(subroot);
+        }
+    } else if (left_height < right_height) {
+        subroot = join_left(std::move(left_subroot), std::move(key_node), std::move(right_subroot));
+        if (is_red(subroot) && is_red(subroot->left_link())) {
+            make_black(subroot);
+        }
+    } else {
+        subroot = join_right(std::move(left_subroot), std::move(key_node), std::move(right_subroot));
+    }
+    return subroot;
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr
+PersistentRedBlackTree<KeyT, Comparator>::join(NodePtr left_subroot, NodePtr right_subroot) {
+    if (!left_subroot) {
+        return right_subroot;
+    }
+
+    auto [rest, last] = split_last(std::move(left_subroot));
+    return join(std::move(rest), std::move(last), std::move(right_subroot));
+}
+
+template <typename KeyT, typename Comparator>
+std::pair<typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr, typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr>
+PersistentRedBlackTree<KeyT, Comparator>::split_last(NodePtr subroot) {
+    auto [left, node, right] = expose(std::move(subroot));
+    if (!right) {
+        return {std::move(left), std::move(node)};
+    }
+
+    auto [rest, last] = split_last(std::move(right));
+    return {join(std::move(left), std::move(node), std::move(rest)), std::move(last)};
+}
+
+template <typename KeyT, typename Comparator>
+std::pair<typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr, typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr>
+PersistentRedBlackTree<KeyT, Comparator>::split(NodePtr subroot, const KeyT &key) {
+    if (!subroot) {
+        return {};
+    }
+
+    auto [left, node, right] = expose(std::move(subroot));
+    if (Comparator()(node->get_key(), key)) {
+        auto [less, not_less] = split(std::move(right), key);
+        return {join(std::move(left), std::move(node), std::move(less)), std::move(not_less)};
+    }
+
+    auto [less, not_less] = split(std::move(left), key);
+    return {std::move(less), join(std::move(not_less), std::move(node), std::move(right))};
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr PersistentRedBlackTree<KeyT, Comparator>::balance(NodePtr subroot) {
+    Node *node = subroot.get();
+    if (node->get_color() == Color::Black) {
+        if (is_red(node->left_link()) && is_red(node->left_link()->right_link())) {
+            node->left_link() = rotate_left(std::move(node->left_link()));
+        }
+        if (is_red(node->left_link()) && is_red(node->left_link()->left_link())) {
+            make_black(node->left_link()->left_link());
+            return rotate_right(std::move(subroot));
+        }
+
+        if (is_red(node->right_link()) && is_red(node->right_link()->left_link())) {
+            node->right_link() = rotate_right(std::move(node->right_link()));
+        }
+        if (is_red(node->right_link()) && is_red(node->right_link()->right_link())) {
+            make_black(node->right_link()->right_link());
+            return rotate_left(std::move(subroot));
+        }
+    }
+
+    update(node);
+    return subroot;
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr PersistentRedBlackTree<KeyT, Comparator>::insert(NodePtr subroot,
+                                                                                                          const KeyT &key) {
+    if (!subroot) {
+        NodePtr new_node(new Node(key));
+        update(new_node.get());
+        return new_node;
+    }
+
+    Node *node = mutate(subroot);
+    if (Comparator()(key, node->get_key())) {
+        node->left_link() = insert(std::move(node->left_link()), key);
+    } else {
+        node->right_link() = insert(std::move(node->right_link()), key);
+    }
+    return balance(std::move(subroot));
+}
+
+template <typename KeyT, typename Comparator>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr PersistentRedBlackTree<KeyT, Comparator>::erase(NodePtr subroot,
+                                                                                                         const KeyT &key) {
+    auto [left, node, right] = expose(std::move(subroot));
+    if (Comparator()(key, node->get_key())) {
+        return join(erase(std::move(left), key), std::move(node), std::move(right));
+    } else if (Comparator()(node->get_key(), key)) {
+        return join(std::move(left), std::move(node), erase(std::move(right), key));
+    }
+    return join(std::move(left), std::move(right));
+}
+
+template <typename KeyT, typename Comparator>
+template <typename RandomIt>
+typename PersistentRedBlackTree<KeyT, Comparator>::NodePtr PersistentRedBlackTree<KeyT, Comparator>::build(RandomIt first,
+                                                                                                         RandomIt last) {
+    if (first == last) {
+        return NodePtr();
+    }
+
+    RandomIt middle = first + (last - first) / 2;
+    NodePtr key_node(new Node(*middle));
+    return join(build(first, middle), std::move(key_node), build(middle + 1, last));
+}
+
+template <typename KeyT, typename Comparator> void PersistentRedBlackTree<KeyT, Comparator>::insert(const KeyT &key) {
+    m_root = insert(std::move(m_root), key);
+    make_black(m_root);
+}
+
+template <typename KeyT, typename Comparator> void PersistentRedBlackTree<KeyT, Comparator>::erase(const KeyT &key) {
+    // Erase of the absent key would copy the path for nothing
+    if (contains(key)) {
+        m_root = erase(std::move(m_root), key);
+    }
+}
+
+template <typename KeyT, typename Comparator> bool PersistentRedBlackTree<KeyT, Comparator>::contains(const KeyT &key) const {
+    // Single comparison per level, the last node not greater than key is checked at the end,
+    // so descent compiles without unpredictable branches
+    const Node *candidate = nullptr;
+    const Node *node = m_root.get();
+    while (node) {
+        bool go_left = Comparator()(key, node->get_key());
+        candidate = go_left ? candidate : node;
+        node = node->get_child(go_left ? Side::Left : Side::Right);
+    }
+    return candidate && !Comparator()(candidate->get_key(), key);
+}
+
+template <typename KeyT, typename Comparator> const KeyT &PersistentRedBlackTree<KeyT, Comparator>::select(size_t k) const {
+    assert(k < size());
+    const Node *node = m_root.get();
+    while (true) {
+        size_t left_size = get_size(node->get_left());
+        if (k == left_size) {
+            return node->get_key();
+        } else if (k < left_size) {
+            node = node->get_left();
+        } else {
+            k -= left_size + 1;
+            node = node->get_right();
+        }
+    }
+}
+
+template <typename KeyT, typename Comparator> size_t PersistentRedBlackTree<KeyT, Comparator>::rank(const KeyT &key) const {
+    size_t rank = 0;
+    const Node *node = m_root.get();
+    while (node) {
+        if (Comparator()(node->get_key(), key)) {
+            rank += get_size(node->get_left()) + 1;
+            node = node->get_right();
+        } else {
+            node = node->get_left();
+        }
+    }
+    return rank;
+}
+
+template <typename KeyT, typename Comparator>
+std::pair<PersistentRedBlackTree<KeyT, Comparator>, PersistentRedBlackTree<KeyT, Comparator>>
+PersistentRedBlackTree<KeyT, Comparator>::split(const KeyT &key) const {
+    auto [less, not_less] = split(m_root, key);
+    return {PersistentRedBlackTree(std::move(less)), PersistentRedBlackTree(std::move(not_less))};
+}
+
+template <typename KeyT, typename Comparator> void PersistentRedBlackTree<KeyT, Comparator>::join(PersistentRedBlackTree other) {
+    m_root = join(std::move(m_root), std::move(other.m_root));
+}
+
+} // namespace Task1
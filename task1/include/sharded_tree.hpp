@@ -0,0 +1,300 @@
+#pragma once
+
+#include "tree.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace Task1 {
+
+// Shard is rebalanced, when it grows past this factor of the average size of the shards
+constexpr size_t ShardSkew = 2;
+// Shards smaller than this are never rebalanced automatically, moving keys between them costs more than it saves.
+// Insertion rebalances again only after this many inserts, so skew, that can't be reduced, doesn't rebalance every time
+constexpr size_t ShardSlack = 1024;
+
+// Multiset of keys, partitioned by ranges into independent RedBlackTrees, each guarded by its own lock,
+// so that writers of the disjoint ranges don't contend.
+// Shard i holds keys in [bound i - 1, bound i). Every operation holds the layout of the bounds shared,
+// rebalancing holds it exclusively and moves keys between the neighbouring shards by split and join in O(log n).
+template <typename KeyT, typename Comparator = std::less<KeyT>> class ShardedTree final {
+    using Tree = RedBlackTree<KeyT, Comparator>;
+
+    // Tree with its lock, on its own cache line
+    struct alignas(64) Shard {
+        mutable std::shared_mutex m_mutex;
+        Tree m_tree;
+    };
+
+public:
+    // Empty tree with the sorted bounds between bounds.size() + 1 shards
+    explicit ShardedTree(std::vector<KeyT> bounds);
+    // Tree of the range of keys, split into up to shard_count shards of the equal size
+    template <typename InputIt> ShardedTree(size_t shard_count, InputIt first, InputIt last);
+    ShardedTree(const ShardedTree &) = delete;
+    ShardedTree &operator=(const ShardedTree &) = delete;
+
+    // Number of keys in the tree
+    size_t size() const { return m_size.load(std::memory_order_relaxed); }
+    // Is tree empty
+    bool empty() const { return size() == 0; }
+    // Number of shards
+    size_t shard_count() const { return m_shards.size(); }
+    // Sizes of the shards in the order of their ranges
+    std::vector<size_t> shard_sizes() const;
+
+    // Insert key, rebalances the shards if its shard has grown too large
+    void insert(const KeyT &key);
+    // Erase one key, equal to the given one, if there is any
+    void erase(const KeyT &key);
+    // Check, if tree contains given key
+    bool contains(const KeyT &key) const;
+    // Count keys in [low, high]
+    size_t count_in_range(const KeyT &low, const KeyT &high) const;
+
+    // Call visit for all keys in the ascending order, shards are locked for the whole visit, so it sees a snapshot
+    template <typename Visit> void for_each(Visit visit) const;
+    // Call visit for the keys in [low, high] in the ascending order, shards of the range are locked for the visit
+    template <typename Visit> void for_each_in_range(const KeyT &low, const KeyT &high, Visit visit) const;
+
+    // Move bounds, so that shards get about equal sizes, keys are moved by split and join of the neighbours
+    void rebalance();
+
+private:
+    // Shards in the order of their ranges
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    // Bounds between the shards
+    std::vector<KeyT> m_bounds;
+    // Guards the bounds and the shard trees as a whole
+    mutable std::shared_mutex m_layout;
+    // Number of keys in all shards
+    std::atomic<size_t> m_size = 0;
+    // Inserts since the last rebalance
+    std::atomic<size_t> m_inserts = 0;
+
+    // Index of the shard of the key
+    size_t shard_index(const KeyT &key) const {
+        return std::upper_bound(m_bounds.begin(), m_bounds.end(), key, Comparator()) - m_bounds.begin();
+    }
+    // Is shard of the size too large
+    bool is_skewed(size_t shard_size) const {
+        return shard_size > ShardSkew * (size() / m_shards.size()) + ShardSlack;
+    }
+    // Key of the rank, or the next greater one, if no key of the tree is less than it, so that the tree split by it
+    // has keys on both sides. Returns nullptr, if all keys of the tree are equal
+    static const KeyT *inner_bound(const Tree &tree, size_t rank);
+    // Move about count maximal keys of the shard into the next one, shard keeps at least one key.
+    // Equal keys stay in one shard, so nothing is moved, if all keys of the shard are equal
+    void move_right(size_t index, size_t count);
+    // Move about count minimal keys of the next shard into the shard, next shard keeps at least one key, as above
+    void move_left(size_t index, size_t count);
+}; // class ShardedTree
+
+template <typename KeyT, typename Comparator>
+ShardedTree<KeyT, Comparator>::ShardedTree(std::vector<KeyT> bounds) : m_bounds(std::move(bounds)) {
+    std::sort(m_bounds.begin(), m_bounds.end(), Comparator());
+    for (size_t i = 0; i <= m_bounds.size(); ++i) {
+        m_shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+template <typename KeyT, typename Comparator>
+template <typename InputIt>
+ShardedTree<KeyT, Comparator>::ShardedTree(size_t shard_count, InputIt first, InputIt last) {
+    Tree rest(first, last);
+    m_size = rest.size();
+
+    // Every next shard is split off from the rest, shards are fewer if there are many equal keys
+    size_t total = rest.size();
+    for (size_t i = 1; i < shard_count && !rest.empty(); ++i) {
+        size_t rank = total * i / shard_count - (total - rest.size());
+        KeyT bound = rest.select(rank)->get_key();
+        if (!m_bounds.empty() && !Comparator()(m_bounds.back(), bound)) {
+            continue;
+        }
+        auto [left, right] = rest.split(bound);
+        m_shards.push_back(std::make_unique<Shard>());
+        m_shards.back()->m_tree = std::move(left);
+        m_bounds.push_back(bound);
+        rest = std::move(right);
+    }
+    m_shards.push_back(std::make_unique<Shard>());
+    m_shards.back()->m_tree = std::move(rest);
+}
+
+template <typename KeyT, typename Comparator> std::vector<size_t> ShardedTree<KeyT, Comparator>::shard_sizes() const {
+    std::shared_lock<std::shared_mutex> layout(m_layout);
+    std::vector<size_t> sizes;
+    for (auto &shard : m_shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->m_mutex);
+        sizes.push_back(shard->m_tree.size());
+    }
+    return sizes;
+}
+
+template <typename KeyT, typename Comparator> void ShardedTree<KeyT, Comparator>::insert(const KeyT &key) {
+    bool skewed = false;
+    {
+        std::shared_lock<std::shared_mutex> layout(m_layout);
+        Shard &shard = *m_shards[shard_index(key)];
+        std::unique_lock<std::shared_mutex> lock(shard.m_mutex);
+        shard.m_tree.insert(key);
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        size_t inserts = m_inserts.fetch_add(1, std::memory_order_relaxed) + 1;
+        skewed = inserts >= ShardSlack && is_skewed(shard.m_tree.size());
+    }
+    // Layout can't be locked exclusively, while it is held shared
+    if (skewed) {
+        rebalance();
+    }
+}
+
+template <typename KeyT, typename Comparator> void ShardedTree<KeyT, Comparator>::erase(const KeyT &key) {
+    std::shared_lock<std::shared_mutex> layout(m_layout);
+    Shard &shard = *m_shards[shard_index(key)];
+    std::unique_lock<std::shared_mutex> lock(shard.m_mutex);
+    size_t old_size = shard.m_tree.size();
+    shard.m_tree.erase(key);
+    m_size.fetch_sub(old_size - shard.m_tree.size(), std::memory_order_relaxed);
+}
+
+template <typename KeyT, typename Comparator> bool ShardedTree<KeyT, Comparator>::contains(const KeyT &key) const {
+    std::shared_lock<std::shared_mutex> layout(m_layout);
+    const Shard &shard = *m_shards[shard_index(key)];
+    std::shared_lock<std::shared_mutex> lock(shard.m_mutex);
+    return shard.m_tree.contains(key);
+}
+
+template <typename KeyT, typename Comparator>
+size_t ShardedTree<KeyT, Comparator>::count_in_range(const KeyT &low, const KeyT &high) const {
+    if (Comparator()(high, low)) {
+        return 0;
+    }
+    std::shared_lock<std::shared_mutex> layout(m_layout);
+    size_t count = 0;
+    for (size_t i = shard_index(low), last = shard_index(high); i <= last; ++i) {
+        std::shared_lock<std::shared_mutex> lock(m_shards[i]->m_mutex);
+        count += m_shards[i]->m_tree.count_in_range(low, high);
+    }
+    return count;
+}
+
+template <typename KeyT, typename Comparator>
+template <typename Visit>
+void ShardedTree<KeyT, Comparator>::for_each(Visit visit) const {
+    std::shared_lock<std::shared_mutex> layout(m_layout);
+    // Shards are always locked in the order of their ranges
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    for (auto &shard : m_shards) {
+        locks.emplace_back(shard->m_mutex);
+    }
+    for (auto &shard : m_shards) {
+        for (const KeyT &key : shard->m_tree) {
+            visit(key);
+        }
+    }
+}
+
+template <typename KeyT, typename Comparator>
+template <typename Visit>
+void ShardedTree<KeyT, Comparator>::for_each_in_range(const KeyT &low, const KeyT &high, Visit visit) const {
+    if (Comparator()(high, low)) {
+        return;
+    }
+    std::shared_lock<std::shared_mutex> layout(m_layout);
+    size_t first = shard_index(low);
+    size_t last = shard_index(high);
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    for (size_t i = first; i <= last; ++i) {
+        locks.emplace_back(m_shards[i]->m_mutex);
+    }
+    for (size_t i = first; i <= last; ++i) {
+        const Tree &tree = m_shards[i]->m_tree;
+        for (auto it = tree.lower_bound(low); it != tree.end() && !Comparator()(high, *it); ++it) {
+            visit(*it);
+        }
+    }
+}
+
+template <typename KeyT, typename Comparator> void ShardedTree<KeyT, Comparator>::rebalance() {
+    std::unique_lock<std::shared_mutex> layout(m_layout);
+    m_inserts.store(0, std::memory_order_relaxed);
+    size_t total = size();
+
+    // Shards before every bound should hold their share of the keys, so the bound moves by the difference.
+    // Surplus is carried to the right in the first pass and deficit is filled from the right in the second one,
+    // so keys of the far shards reach their place over the several bounds
+    size_t before = 0;
+    for (size_t i = 0; i + 1 < m_shards.size(); ++i) {
+        size_t prefix = before + m_shards[i]->m_tree.size();
+        size_t target = total * (i + 1) / m_shards.size();
+        if (prefix > target) {
+            move_right(i, prefix - target);
+        }
+        before += m_shards[i]->m_tree.size();
+    }
+    size_t after = 0;
+    for (size_t i = m_shards.size() - 1; i > 0; --i) {
+        size_t suffix = after + m_shards[i]->m_tree.size();
+        size_t target = total - total * i / m_shards.size();
+        if (suffix > target) {
+            move_left(i - 1, suffix - target);
+        }
+        after += m_shards[i]->m_tree.size();
+    }
+}
+
+template <typename KeyT, typename Comparator>
+const KeyT *ShardedTree<KeyT, Comparator>::inner_bound(const Tree &tree, size_t rank) {
+    const KeyT &key = tree.select(rank)->get_key();
+    if (Comparator()(*tree.begin(), key)) {
+        return &key;
+    }
+    // Key of the rank is in the run of the minimal keys, so the run stays on the left
+    auto it = tree.upper_bound(key);
+    return it != tree.end() ? &*it : nullptr;
+}
+
+template <typename KeyT, typename Comparator>
+void ShardedTree<KeyT, Comparator>::move_right(size_t index, size_t count) {
+    Tree &tree = m_shards[index]->m_tree;
+    if (tree.size() <= 1 || count == 0) {
+        return;
+    }
+    count = std::min(count, tree.size() - 1);
+    const KeyT *inner = inner_bound(tree, tree.size() - count);
+    if (!inner) {
+        return;
+    }
+    KeyT bound = *inner;
+    auto [left, right] = tree.split(bound);
+    right.join(m_shards[index + 1]->m_tree);
+    m_shards[index + 1]->m_tree = std::move(right);
+    tree = std::move(left);
+    m_bounds[index] = bound;
+}
+
+template <typename KeyT, typename Comparator>
+void ShardedTree<KeyT, Comparator>::move_left(size_t index, size_t count) {
+    Tree &next = m_shards[index + 1]->m_tree;
+    if (next.size() <= 1 || count == 0) {
+        return;
+    }
+    count = std::min(count, next.size() - 1);
+    const KeyT *inner = inner_bound(next, count);
+    if (!inner) {
+        return;
+    }
+    KeyT bound = *inner;
+    auto [left, right] = next.split(bound);
+    m_shards[index]->m_tree.join(left);
+    next = std::move(right);
+    m_bounds[index] = bound;
+}
+
+} // namespace Task1
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace Task1 {
+
+// Counters of the tree operations are compiled in only with TASK1_STATS,
+// otherwise all counting calls are empty
+#ifdef TASK1_STATS
+constexpr bool StatsEnabled = true;
+#else
+constexpr bool StatsEnabled = false;
+#endif
+
+// Counted events, summed over the threads
+enum class StatsCounter : size_t {
+    // Comparisons of the keys
+    Comparisons,
+    // Rotations of the nodes
+    Rotations,
+    // Color changes
+    Recolors,
+    // Iterations of the fixup loops
+    InsertFixups,
+    EraseFixups,
+    // Nodes, allocated and not freed yet
+    LiveNodes,
+    // Bytes, allocated for the nodes and not freed yet
+    AllocatedBytes,
+    Count,
+};
+
+// Recursions, whose maximal depth is tracked
+enum class StatsRecursion : size_t {
+    // join_right and join_left
+    Join,
+    // Split of the subtree
+    Split,
+    Count,
+};
+
+// Snapshot of the counters of all threads, zero without TASK1_STATS
+struct TreeStats {
+    uint64_t m_comparisons = 0;
+    uint64_t m_rotations = 0;
+    uint64_t m_recolors = 0;
+    uint64_t m_insert_fixups = 0;
+    uint64_t m_erase_fixups = 0;
+    // Maximal recursion depth of join and split, reached by any thread
+    uint64_t m_join_depth = 0;
+    uint64_t m_split_depth = 0;
+    // Node may be freed by other thread, than allocated it, so only the sums are meaningful
+    int64_t m_live_nodes = 0;
+    int64_t m_allocated_bytes = 0;
+
+    // Events, counted since the earlier snapshot, depths and allocations are the current ones
+    TreeStats operator-(const TreeStats &earlier) const;
+};
+
+std::ostream &operator<<(std::ostream &out, const TreeStats &stats);
+
+// Counters of the single thread. Only the owner thread writes them, so it increments them without atomic
+// read-modify-write, and others only read them for the snapshot.
+// Counters are never freed, when thread exits, they are handed over to the next new thread and keep counting
+class ThreadStats final {
+public:
+    ThreadStats() = default;
+    ThreadStats(const ThreadStats &) = delete;
+    ThreadStats &operator=(const ThreadStats &) = delete;
+
+    // Count events
+    void add(StatsCounter counter, int64_t count) {
+        std::atomic<int64_t> &value = m_counters[static_cast<size_t>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+    // Enter next level of the recursion
+    void enter(StatsRecursion recursion) {
+        size_t index = static_cast<size_t>(recursion);
+        uint64_t depth = ++m_depths[index];
+        if (depth > m_max_depths[index].load(std::memory_order_relaxed)) {
+            m_max_depths[index].store(depth, std::memory_order_relaxed);
+        }
+    }
+    // Leave level of the recursion
+    void leave(StatsRecursion recursion) { --m_depths[static_cast<size_t>(recursion)]; }
+
+    // Add counters to the snapshot
+    void collect(TreeStats &stats) const;
+
+private:
+    static constexpr size_t CounterCount = static_cast<size_t>(StatsCounter::Count);
+    static constexpr size_t RecursionCount = static_cast<size_t>(StatsRecursion::Count);
+
+    std::atomic<int64_t> m_counters[CounterCount] = {};
+    std::atomic<uint64_t> m_max_depths[RecursionCount] = {};
+    // Current depths of the recursions, seen only by the owner thread
+    uint64_t m_depths[RecursionCount] = {};
+}; // class ThreadStats
+
+// Counters of the calling thread, nullptr until it counts anything
+inline thread_local ThreadStats *thread_stats = nullptr;
+// Take counters for the calling thread
+ThreadStats &acquire_thread_stats();
+// Counters of the calling thread
+inline ThreadStats &current_thread_stats() { return thread_stats ? *thread_stats : acquire_thread_stats(); }
+
+// Count events of the calling thread, does nothing without TASK1_STATS
+inline void count_stat(StatsCounter counter, int64_t count = 1) {
+    if constexpr (StatsEnabled) {
+        current_thread_stats().add(counter, count);
+    }
+}
+
+// Tracks depth of the recursion in the calling thread for its lifetime, empty without TASK1_STATS
+template <StatsRecursion Recursion> class StatsDepth final {
+public:
+    StatsDepth() {
+        if constexpr (StatsEnabled) {
+            current_thread_stats().enter(Recursion);
+        }
+    }
+    ~StatsDepth() {
+        if constexpr (StatsEnabled) {
+            current_thread_stats().leave(Recursion);
+        }
+    }
+    StatsDepth(const StatsDepth &) = delete;
+    StatsDepth &operator=(const StatsDepth &) = delete;
+};
+
+// Snapshot of the counters of all threads, that ever counted anything
+TreeStats stats();
+
+} // namespace Task1
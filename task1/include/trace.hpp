@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace Task1 {
+
+// Tracing of the tree changes is compiled in only with TASK1_TRACE,
+// otherwise all tracing calls are empty and tree keeps neither the recorder nor the name of the trace
+#ifdef TASK1_TRACE
+constexpr bool TraceEnabled = true;
+#else
+constexpr bool TraceEnabled = false;
+#endif
+
+// Number of events in the ring buffer of the recorder, power of two
+constexpr size_t TraceBufferCapacity = 1 << 16;
+
+// Single change of the tree, nodes are identified by their addresses
+struct TraceEvent {
+    enum class Type : uint8_t {
+        // Node is created with the key, arg - whether the key is known
+        Create,
+        // Node is freed
+        Destroy,
+        // Child of the node on the side arg is set to other
+        Link,
+        // Node becomes root of the tree
+        Root,
+        // Node gets color arg
+        Recolor,
+        // Node gets key of other
+        MoveKey,
+        // Markers, that don't change the tree
+        // Node is rotated to the side arg
+        Rotate,
+        // Step of the fixup after insertion of the node
+        InsertFixup,
+        // Step of the fixup after erase, node is the doubly black one
+        EraseFixup,
+        // Subtrees are joined with the key node
+        Join,
+        // Subtree is split by the key
+        Split,
+        // State of the tree, that is rendered by the replay
+        Frame,
+    };
+
+    Type m_type;
+    uint8_t m_arg;
+    uint64_t m_node;
+    uint64_t m_other;
+    // Integral key itself, hash of the other keys
+    int64_t m_key;
+};
+
+static_assert(std::is_trivially_copyable_v<TraceEvent> && sizeof(TraceEvent) == 32);
+
+// Key, as it is stored in the trace
+template <typename KeyT> int64_t trace_key(const KeyT &key) {
+    if constexpr (std::is_integral_v<KeyT> || std::is_enum_v<KeyT>) {
+        return static_cast<int64_t>(key);
+    } else if constexpr (std::is_invocable_v<std::hash<KeyT>, const KeyT &>) {
+        return static_cast<int64_t>(std::hash<KeyT>()(key));
+    } else {
+        return 0;
+    }
+}
+
+// Writes events into the binary trace file.
+// Producers put events into the bounded lock-free ring buffer and only wait, when it is full,
+// background thread writes them to the file in batches.
+class TraceRecorder final {
+public:
+    // Start recording into the file at path
+    explicit TraceRecorder(const std::string &path, size_t capacity = TraceBufferCapacity);
+    // Write all recorded events and close the file
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder &) = delete;
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    // Is trace file opened
+    bool is_open() const { return m_file != nullptr; }
+    // Put event into the buffer, may be called from several threads
+    void record(const TraceEvent &event);
+    // Wait until all events, recorded before the call, are written
+    void flush();
+
+private:
+    // Slot of the ring buffer, sequence tells whether it is free or filled for the given position
+    struct Slot {
+        std::atomic<uint64_t> m_sequence;
+        TraceEvent m_event;
+    };
+
+    // Ring buffer of events
+    std::unique_ptr<Slot[]> m_slots;
+    // Capacity - 1, to get slot of the position
+    size_t m_mask;
+    // Position of the next recorded event
+    alignas(64) std::atomic<uint64_t> m_head = 0;
+    // Number of events, written to the file
+    alignas(64) std::atomic<uint64_t> m_written = 0;
+    // Signals writer to exit, once the buffer is drained
+    std::atomic<bool> m_stop = false;
+    // Trace file
+    std::FILE *m_file = nullptr;
+    // Background writer
+    std::thread m_writer;
+
+    // Writer thread body
+    void write_loop();
+}; // class TraceRecorder
+
+// Tree, reconstructed from the trace and rendered to graphviz frame by frame
+class TraceReplay final {
+public:
+    // Read trace from the file, returns false if file isn't a valid trace
+    bool load(const std::string &path);
+    // All events of the trace
+    const std::vector<TraceEvent> &events() const { return m_events; }
+    // Number of frames in the trace
+    size_t frames() const { return m_frames.size(); }
+    // Render the tree, as it was at the given frame, frames are rendered faster in the ascending order
+    void render(size_t frame, std::ostream &out);
+
+private:
+    // Node of the reconstructed tree
+    struct Node {
+        int64_t m_key = 0;
+        bool m_has_key = false;
+        bool m_black = false;
+        uint64_t m_links[2] = {0, 0};
+    };
+
+    // Events of the trace
+    std::vector<TraceEvent> m_events;
+    // Indices of the frame events
+    std::vector<size_t> m_frames;
+    // Reconstructed nodes
+    std::unordered_map<uint64_t, Node> m_nodes;
+    // Root of the reconstructed tree
+    uint64_t m_root = 0;
+    // Number of events, applied to the reconstructed tree
+    size_t m_applied = 0;
+
+    // Apply single event to the reconstructed tree
+    void apply(const TraceEvent &event);
+    // Dump nodes, reachable from the root, each of them once, so the cycles of the corrupt trace are cut
+    void render_nodes(uint64_t root, std::ostream &out);
+}; // class TraceReplay
+
+} // namespace Task1
@@ -1,22 +1,114 @@
 #pragma once
 
+#include "allocator.hpp"
+#include "compact_node.hpp"
+#include "frozen_tree.hpp"
+#include "image.hpp"
+#include "key_prefix.hpp"
 #include "node.hpp"
+#include "parallel.hpp"
 #include "side.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
+#include <algorithm>
 #include <cstddef>
-#include <fstream>
+#include <cstdint>
+#include <cstdio>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace Task1 {
 
+// Batch, smaller than the tree by this factor, is applied key by key:
+// split and join walk the path several times, which doesn't pay off for the sparse batch
+constexpr size_t SmallBatchRatio = 32;
+
+// Number of searches of the batched lookup, that advance in lockstep, enough to hide the latency of the memory
+constexpr size_t SearchGroupSize = 16;
+
+template <typename T, template <typename> class Allocator> class IntervalTree;
+
 // Class, representing RedBlackTree
-template <typename KeyT, typename Comparator = std::less<KeyT>>
+template <typename KeyT, typename Comparator = std::less<KeyT>,
+          template <typename> class Allocator = NewDeleteAllocator, typename NodeT = TreeNode<KeyT>>
 class RedBlackTree final {
-    using Node = TreeNode<KeyT>;
+    using Node = NodeT;
+    using Augmentation = typename NodeT::Augmentation;
+    // Are aggregates of the subtrees kept in the nodes
+    static constexpr bool Augmented = !std::is_same_v<Augmentation, NoAugmentation>;
+    // Are prefixes of the keys cached in the nodes, their order must agree with Comparator
+    static constexpr bool PrefixCached = CachesPrefix<NodeT>::value;
+    static_assert(!PrefixCached || KeyPrefix<KeyT>::template KeepsOrder<Comparator>,
+                  "Cached prefixes don't keep the order of the comparator");
 
 public:
+    // Bidirectional iterator over the keys of the tree in the ascending order
+    class Iterator final {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = KeyT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const KeyT *;
+        using reference = const KeyT &;
+
+        Iterator() = default;
+
+        reference operator*() const { return m_node->get_key(); }
+        pointer operator->() const { return &m_node->get_key(); }
+
+        Iterator &operator++() {
+            m_node = m_tree->successor(m_node);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+        // Decrementing end() gives the maximal key, end() of the empty tree stays end()
+        Iterator &operator--() {
+            if (m_node) {
+                m_node = m_tree->predecessor(m_node);
+            } else {
+                m_node = m_tree->m_root ? m_tree->maximum(m_tree->m_root) : nullptr;
+            }
+            return *this;
+        }
+        Iterator operator--(int) {
+            Iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const Iterator &other) const { return m_node == other.m_node; }
+        bool operator!=(const Iterator &other) const { return m_node != other.m_node; }
+
+    private:
+        friend class RedBlackTree;
+
+        Iterator(const RedBlackTree *tree, Node *node) : m_tree(tree), m_node(node) {}
+
+        // Tree, iterated over
+        const RedBlackTree *m_tree = nullptr;
+        // Current node, nullptr for end()
+        Node *m_node = nullptr;
+    }; // class Iterator
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
     // Default constructor
     RedBlackTree() = default;
+    // Construct tree from the range of keys
+    template <typename InputIt>
+    RedBlackTree(InputIt first, InputIt last, Execution execution = Execution::Sequential);
     // Copy constructor
     RedBlackTree(const RedBlackTree &rhs);
     // Move constructor
@@ -29,16 +121,27 @@ public:
     ~RedBlackTree();
 
 private:
+    // Interval tree searches the nodes by their aggregates
+    template <typename, template <typename> class> friend class IntervalTree;
+    // Frozen tree is thawed from its keys in the ascending order
+    template <typename, typename> friend class FrozenTree;
+
     // Root of the tree
     Node* m_root = nullptr;
     // Size of the tree
     size_t m_size = 0;
-    // File with log
-    bool m_log = false;
-    // Log file counter
-    uint64_t m_log_cnt;
-    // Log file name
-    std::string m_log_name = "";
+    // Last inserted node, insertion starts the search from it, nullptr if it is unknown
+    Node *m_finger = nullptr;
+    // Insertion climbs from the last inserted node past this number of bounds, so random keys lose little
+    static constexpr size_t FingerBounds = 1;
+    // Allocator of the nodes
+    Allocator<Node> m_alloc;
+#ifdef TASK1_TRACE
+    // Recorder of the trace, while logging is enabled
+    std::unique_ptr<TraceRecorder> m_recorder;
+    // Name of the trace file without the extension
+    std::string m_log_name = "tree";
+#endif
 
     // Rotate RedBlackTree to the given side around given node
     void rotate(Node *node, Side side);
@@ -47,11 +150,33 @@ private:
     // node - root of the tree
     Node *minimum(Node *node) const;
 
+    // Find maximum of the tree
+    // node - root of the tree
+    Node *maximum(Node *node) const;
+
     // Get successor of the given node
     Node *successor(Node *node) const;
-
-    // Finds Node with key in the tree
-    Node *find(Node *node, KeyT &key) const;
+    // Get predecessor of the given node
+    Node *predecessor(Node *node) const;
+
+    // Finds Node with key in the tree, key may be of any type, comparable with KeyT
+    template <typename K> Node *find_node(const K &key) const;
+    // Find node with the first key, not less than key
+    template <typename K> Node *lower_bound_node(const K &key) const;
+    // Find node with the first key, greater than key
+    template <typename K> Node *upper_bound_node(const K &key) const;
+    // Insert created node, searching for its position from the finger, nullptr - from the root, returns the node
+    // Search gives up after climbing past max_bounds ancestors, that bound the subtree, and starts from the root
+    Node *insert_node(Node *new_node, Node *finger = nullptr, size_t max_bounds = SIZE_MAX);
+    // Climb from the finger to the closest subtree, that contains position of the key after the equal keys,
+    // root if there are more than max_bounds bounds to climb past
+    // candidate - ancestor of the subtree with the greatest key, not greater than key, if there is one
+    template <typename K>
+    Node *finger_subtree(Node *finger, const K &key, Node *&candidate, size_t max_bounds = SIZE_MAX) const;
+    // Find node with key, searching from the finger, nullptr - from the root
+    template <typename K> Node *finger_find(Node *finger, const K &key) const;
+    // Erase one node with the key, if there is any
+    template <typename K> void erase_key(const K &key);
 
     // Fixup RedBlackTree after fixup
     // node - node, that was inserted
@@ -60,9 +185,9 @@ private:
     // node - child of the successor of the deleted node
     void erase_fixup(Node *node);
 
-    // Split subtree by the key, contained in key_node
-    std::pair<TreeNode<KeyT> *, TreeNode<KeyT> *>
-    split(Node *subroot, Node *key_node);
+    // Split subtree by the key
+    // returns subtree with lesser keys, node with the key (if found) and subtree with greater keys
+    std::tuple<Node *, Node *, Node *> split(Node *subroot, const KeyT &key);
 
     // Join two subtrees, where height of the left subtree is greater than right subtree
     Node *join_right(Node *left_subroot, Node *key_node, Node *right_subroot);
@@ -71,77 +196,475 @@ private:
     // Join two subtrees
     Node *join(Node *left_subroot, Node *key_node, Node *right_subroot);
 
-    // Merge
-    Node *merge(Node *left_subroot, Node *right_subroot);
+    // Join two subtrees without the key node
+    Node *join(Node *left_subroot, Node *right_subroot);
+    // Split subtree into subtrees with keys less than key (not greater than key, if inclusive) and the rest
+    std::pair<Node *, Node *> split_bound(Node *subroot, const KeyT &key, bool inclusive);
+    // Cut keys in [low, high] out of the tree, returns root of the subtree with them
+    Node *cut_range(const KeyT &low, const KeyT &high);
+    // Split the node with the maximal key out of the subtree
+    // returns rest of the subtree and the maximal node
+    std::pair<Node *, Node *> split_last(Node *subroot);
+
+    // Set operations, implemented with split and join
+    enum class SetOperation { Union, Intersection, Difference, SymmetricDifference };
+    // Combination of the equal keys, that keeps the key of other tree as is
+    struct KeepKey {
+        void operator()(const KeyT &, const KeyT &) const {}
+    };
+    // Apply set operation to the subtrees, combine(kept, dropped) is called for the equal keys of the union
+    // garbage - collects subtrees, excluded from the result, to free them after the operation
+    template <typename Combine>
+    Node *set_operation(SetOperation operation, Node *left_subroot, Node *right_subroot, Execution execution,
+                        Combine &combine, std::vector<Node *> &garbage);
+    // Apply set operation to this and other tree, other becomes empty
+    template <typename Combine = KeepKey>
+    void set_operation(SetOperation operation, RedBlackTree &other, Execution execution, Combine combine = {});
+    // Free all nodes of the subtree, returns number of freed nodes
+    size_t destroy_subtree(Node *subroot);
+    // Keep keys of the subtree, for which pred is true, collecting erased nodes into garbage
+    template <typename Predicate>
+    Node *filter_subtree(Node *subroot, Predicate &pred, Execution execution, std::vector<Node *> &garbage);
+    // Reduce the subtree, forking subtrees larger than the grain
+    template <typename T, typename Map, typename Reduce>
+    T reduce_subtree(const Node *subroot, size_t grain, const T &identity, Map &map, Reduce &reduce) const;
+    // Visit keys of the subtree, forking subtrees larger than the grain
+    template <typename Visit> void for_each_subtree(const Node *subroot, size_t grain, Visit &visit) const;
+    // Visit keys of the subtree in the ascending order
+    template <typename Visit> static void visit_subtree(const Node *subroot, Visit &visit);
+
+    // Build subtree from the sorted range of keys
+    // depth - depth of the subroot, red_depth - depth, on which all nodes are red
+    template <typename RandomIt>
+    Node *build(RandomIt first, RandomIt last, uint64_t depth, uint64_t red_depth, Allocator<Node> &alloc);
+    // Build balanced subtree from the sorted range of keys
+    template <typename RandomIt> Node *build(RandomIt first, RandomIt last, Allocator<Node> &alloc);
+    // Build subtree of size keys, taken from first in the ascending order, with the same shape as build
+    template <typename InputIt>
+    Node *build_sequence(InputIt &first, size_t size, uint64_t depth, uint64_t red_depth, Allocator<Node> &alloc);
+    // Depth, on which all nodes of the balanced subtree of size keys are red
+    static uint64_t build_red_depth(size_t size);
+    // Color the built node by its depth and set its black height
+    void color_built(Node *node, uint64_t depth, uint64_t red_depth);
+    // Replace content of the tree with size sorted keys, taken from first, the range needn't be random access
+    template <typename InputIt> void assign_sequence(InputIt first, size_t size);
+    // Build subtree from the sorted range of keys, building halves in parallel and joining them
+    template <typename RandomIt>
+    Node *parallel_build(RandomIt first, RandomIt last, size_t grain, Allocator<Node> &alloc);
+    // Replace content of the tree with the sorted range of keys
+    template <typename RandomIt> void assign_sorted(RandomIt first, RandomIt last, Execution execution);
+    // Sort and deduplicate the range of keys
+    template <typename InputIt> static std::vector<KeyT> sorted_batch(InputIt first, InputIt last);
+    // Search keys of the range, report(node) is called in the order of the keys with the node of the key or nullptr
+    template <typename ForwardIt, typename Report> void search_batch(ForwardIt first, ForwardIt last, Report report) const;
+    // Search sorted keys in the subtree, splitting them by the keys of the nodes on the way down
+    template <typename RandomIt, typename Report>
+    void search_sorted(Node *subroot, RandomIt first, RandomIt last, Report &report) const;
+
+    // Detach subtree from its parent and make it black
+    Node *make_root(Node *subroot);
+
+    // Compare keys with Comparator, counting the comparison
+    template <typename L, typename R> static bool less(const L &lhs, const R &rhs) {
+        count_stat(StatsCounter::Comparisons);
+        return Comparator()(lhs, rhs);
+    }
+    // Compare keys three-way: negative, zero or positive, in one call, if Comparator has compare()
+    template <typename L, typename R> static int compare(const L &lhs, const R &rhs) {
+        if constexpr (IsThreeWay<Comparator, L, R>::value) {
+            count_stat(StatsCounter::Comparisons);
+            return Comparator().compare(lhs, rhs);
+        } else {
+            return less(lhs, rhs) ? -1 : less(rhs, lhs) ? 1 : 0;
+        }
+    }
+    // Key of the search with its prefix, computed once for the whole descent, if the nodes cache the prefixes
+    template <typename K> struct SearchKey {
+        const K *m_key = nullptr;
+        uint64_t m_prefix = 0;
+
+        SearchKey() = default;
+        explicit SearchKey(const K &key) : m_key(&key) {
+            if constexpr (PrefixCached) {
+                m_prefix = KeyPrefix<KeyT>::make(key);
+            }
+        }
+    };
+    // Compare key with the key of the node three-way. Cached prefixes decide, unless they are equal,
+    // so the key of the node is read only on the ties
+    template <typename K> static int key_compare(const SearchKey<K> &key, const Node *node) {
+        if constexpr (PrefixCached) {
+            if (key.m_prefix != node->get_prefix()) {
+                count_stat(StatsCounter::Comparisons);
+                return key.m_prefix < node->get_prefix() ? -1 : 1;
+            }
+        }
+        return compare(*key.m_key, node->get_key());
+    }
+    template <typename K> static int key_compare(const K &key, const Node *node) {
+        return key_compare(SearchKey<K>(key), node);
+    }
+    // Is key less than the key of the node, decided by the cached prefixes, unless they are equal
+    template <typename K> static bool key_less(const SearchKey<K> &key, const Node *node) {
+        if constexpr (PrefixCached) {
+            if (key.m_prefix != node->get_prefix()) {
+                count_stat(StatsCounter::Comparisons);
+                return key.m_prefix < node->get_prefix();
+            }
+        }
+        return less(*key.m_key, node->get_key());
+    }
+    template <typename K> static bool key_less(const K &key, const Node *node) {
+        return key_less(SearchKey<K>(key), node);
+    }
+    // Is the key of the node less than key, decided by the cached prefixes, unless they are equal
+    template <typename K> static bool node_less(const Node *node, const SearchKey<K> &key) {
+        if constexpr (PrefixCached) {
+            if (key.m_prefix != node->get_prefix()) {
+                count_stat(StatsCounter::Comparisons);
+                return node->get_prefix() < key.m_prefix;
+            }
+        }
+        return less(node->get_key(), *key.m_key);
+    }
+    template <typename K> static bool node_less(const Node *node, const K &key) {
+        return node_less(node, SearchKey<K>(key));
+    }
 
-    // Dump subtree to graphviz, where its root is the subroot
-    void dump_to_graphviz(Node *sub_root);
+    // Is logging enabled, always false without TASK1_TRACE
+    bool tracing() const {
+#ifdef TASK1_TRACE
+        return m_recorder != nullptr;
+#else
+        return false;
+#endif
+    }
+    // Record change of the tree, if logging is enabled
+    void trace(TraceEvent::Type type, const Node *node, const Node *other = nullptr, uint8_t arg = 0,
+               int64_t key = 0) {
+#ifdef TASK1_TRACE
+        if (m_recorder) {
+            m_recorder->record({type, arg, reinterpret_cast<uint64_t>(node), reinterpret_cast<uint64_t>(other), key});
+        }
+#endif
+    }
+    // Record creation of the node
+    void trace_create(const Node *node) { trace(TraceEvent::Type::Create, node, nullptr, 1, trace_key(node->get_key())); }
+    // Record the whole subtree, that appears in the tree
+    void trace_subtree(Node *subroot);
+    // Set child of the parent on the side
+    void link(Node *parent, Node *child, Side side) {
+        parent->set_child(child, side);
+        trace(TraceEvent::Type::Link, parent, child, side == Side::Right);
+    }
+    // Set both children of the node
+    void link_childs(Node *node, Node *left, Node *right) {
+        node->set_childs(left, right);
+        trace(TraceEvent::Type::Link, node, left, 0);
+        trace(TraceEvent::Type::Link, node, right, 1);
+    }
+    // Set color of the node
+    void recolor(Node *node, Color color) {
+        count_stat(StatsCounter::Recolors);
+        node->set_color(color);
+        trace(TraceEvent::Type::Recolor, node, nullptr, color == Color::Black);
+    }
+    // Set root of the tree
+    void set_root(Node *root) {
+        m_root = root;
+        trace(TraceEvent::Type::Root, root);
+    }
     // Get black height of the node
     uint64_t get_black_height(Node *node);
+    // Recompute black height of the node from its children and color
+    void update_height(Node *node);
+    // Get number of nodes in the subtree, for nullptr - 0
+    static uint64_t get_size(const Node *node) { return node ? node->get_size() : 0; }
+    // Recompute number of nodes in the subtree of the node and its aggregate from its children
+    static void update_size(Node *node) {
+        node->set_size(get_size(node->get_left()) + get_size(node->get_right()) + 1);
+        if constexpr (Augmented) {
+            update_aggregate(node);
+        }
+    }
+    // Get aggregate of the subtree, for nullptr - identity
+    static auto get_aggregate(const Node *node) { return node ? node->get_aggregate() : Augmentation::identity(); }
+    // Recompute aggregate of the subtree of the node from its children
+    static void update_aggregate(Node *node) {
+        node->set_aggregate(Augmentation::combine(
+            Augmentation::combine(get_aggregate(node->get_left()), Augmentation::lift(node->get_key())),
+            get_aggregate(node->get_right())));
+    }
+    // Recompute aggregates of the node and its ancestors
+    static void update_path(Node *node) {
+        if constexpr (Augmented) {
+            for (; node; node = node->get_parent()) {
+                update_aggregate(node);
+            }
+        }
+    }
+    // Recompute aggregates of all nodes of the subtree
+    static void update_subtree(Node *subroot) {
+        if constexpr (Augmented) {
+            if (subroot) {
+                update_subtree(subroot->get_left());
+                update_subtree(subroot->get_right());
+                update_aggregate(subroot);
+            }
+        }
+    }
+    // Check the subtree, whose root must have the black height height, and its cached sizes and heights
+    // Descent stops at the first red child of the red node, so depth of the recursion is bounded by the heights
+    bool validate_subtree(Node *node, uint64_t height) const;
+    // Aggregate of the keys in [low, high]
+    template <typename K> auto aggregate_range(const K &low, const K &high) const;
+    // Count keys, less than key (or equal to it, if inclusive)
+    template <typename K> size_t count_less(const K &key, bool inclusive) const;
 
     // Is node red, for nullptr - false
-    bool is_red(Node *node);
+    static bool is_red(Node *node);
     // Is node black, for nullptr - true
-    bool is_black(Node *node);
+    static bool is_black(Node *node);
 
 
 public:
     // Insert value into the RedBlackTree
-    void insert(const KeyT &key);
+    // Search starts from the last inserted node, so ascending and clustered keys are inserted in O(1) amortized
+    void insert(const KeyT &key) { insert_node(m_alloc.create(key), m_finger, FingerBounds); }
+    // Insert value into the RedBlackTree, moving it into the node
+    void insert(KeyT &&key) { insert_node(m_alloc.create(std::in_place, std::move(key)), m_finger, FingerBounds); }
+    // Insert value, constructed in place from args, returns iterator to it
+    template <typename... Args> Iterator emplace(Args &&...args) {
+        return Iterator(this, insert_node(m_alloc.create(std::in_place, std::forward<Args>(args)...), m_finger, FingerBounds));
+    }
+    // Insert value, searching for its position from the hint, end() - from the root, which descends to the maximal key
+    // Search takes O(log d), where d is the distance between the hint and the position
+    Iterator insert(Iterator hint, const KeyT &key) { return Iterator(this, insert_node(m_alloc.create(key), hint.m_node)); }
+    Iterator insert(Iterator hint, KeyT &&key) {
+        return Iterator(this, insert_node(m_alloc.create(std::in_place, std::move(key)), hint.m_node));
+    }
+    template <typename... Args> Iterator emplace_hint(Iterator hint, Args &&...args) {
+        return Iterator(this, insert_node(m_alloc.create(std::in_place, std::forward<Args>(args)...), hint.m_node));
+    }
     // Erase node containing key from the RedBlackTree
-    void erase(KeyT &key);
+    void erase(const KeyT &key) { erase_key(key); }
     // Erase node from the tree
     void erase(Node *node);
 
-    Node *find(KeyT &key) const;
+    // Find node with the key, nullptr if there is none
+    Node *find(const KeyT &key) const { return find_node(key); }
+    // Find node with the key, searching from the hint, end() - from the root
+    Node *find(Iterator hint, const KeyT &key) const { return finger_find(hint.m_node, key); }
     // Check, if tree containts given key
-    bool contains(KeyT &key) const;
+    bool contains(const KeyT &key) const { return find_node(key) != nullptr; }
+    // Number of keys in the tree
+    size_t size() const { return m_size; }
+
+    // Iterator to the minimal key
+    Iterator begin() const { return Iterator(this, m_root ? minimum(m_root) : nullptr); }
+    // Iterator past the maximal key
+    Iterator end() const { return Iterator(this, nullptr); }
+    // Iterator to the first key, not less than key
+    Iterator lower_bound(const KeyT &key) const { return Iterator(this, lower_bound_node(key)); }
+    // Iterator to the first key, greater than key
+    Iterator upper_bound(const KeyT &key) const { return Iterator(this, upper_bound_node(key)); }
+    // Range of keys, equal to key
+    std::pair<Iterator, Iterator> equal_range(const KeyT &key) const { return {lower_bound(key), upper_bound(key)}; }
+
+    // Lookups by keys of other types, comparable with KeyT, if Comparator is transparent
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    Node *find(const K &key) const {
+        return find_node(key);
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    bool contains(const K &key) const {
+        return find_node(key) != nullptr;
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    void erase(const K &key) {
+        erase_key(key);
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    Iterator lower_bound(const K &key) const {
+        return Iterator(this, lower_bound_node(key));
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    Iterator upper_bound(const K &key) const {
+        return Iterator(this, upper_bound_node(key));
+    }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    std::pair<Iterator, Iterator> equal_range(const K &key) const {
+        return {lower_bound(key), upper_bound(key)};
+    }
 
-    // Join another tree into this
+    // Find node with the k-th smallest key, counting from 0, nullptr if k >= size
+    Node *select(size_t k) const;
+    // Number of keys, less than key
+    size_t rank(const KeyT &key) const { return count_less(key, false); }
+    // Number of keys in [low, high]
+    size_t count_in_range(const KeyT &low, const KeyT &high) const;
+
+    // Type of the aggregate of the augmented tree, void if the tree isn't augmented
+    using Aggregate = typename Augmentation::value_type;
+    // Aggregate of the keys in [low, high] in O(log n), tree must be augmented
+    Aggregate aggregate(const KeyT &low, const KeyT &high) const { return aggregate_range(low, high); }
+    template <typename K, typename C = Comparator, typename = typename C::is_transparent>
+    Aggregate aggregate(const K &low, const K &high) const {
+        return aggregate_range(low, high);
+    }
+    // Recompute aggregates on the path from the key to the root, after the part of the key,
+    // that doesn't affect the order, has been changed through the iterator
+    void refresh(Iterator it) { update_path(it.m_node); }
+    // Is tree empty
+    bool empty() const { return m_size == 0; }
+    // Erase all keys from the tree
+    void clear();
+    // Replace content of the tree with the range of keys
+    // Sorted range is built in linear time, unsorted one is sorted first
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last, Execution execution = Execution::Sequential);
+
+    // Insert keys of the range, that are not in the tree yet
+    // Batch is sorted, deduplicated and united with the tree in O(m log(n/m + 1)),
+    // batches much smaller than the tree are inserted key by key
+    template <typename InputIt>
+    void insert_batch(InputIt first, InputIt last, Execution execution = Execution::Sequential);
+    // Erase keys of the range from the tree
+    // Batch is sorted, deduplicated and subtracted from the tree in O(m log(n/m + 1)),
+    // batches much smaller than the tree are erased key by key
+    template <typename InputIt>
+    void erase_batch(InputIt first, InputIt last, Execution execution = Execution::Sequential);
+    // Write node of every key of the range, nullptr if there is none, into out, returns the end of the output
+    // Searches of the group of keys advance level by level together, prefetching their next nodes,
+    // so that their cache misses overlap. Sorted batch, not much smaller than the tree,
+    // is searched by the single traversal of the tree instead
+    template <typename ForwardIt, typename OutputIt> OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        search_batch(first, last, [&out](Node *node) { *out++ = node; });
+        return out;
+    }
+    // Write, whether the tree contains every key of the range, into out, returns the end of the output
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt contains_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        search_batch(first, last, [&out](Node *node) { *out++ = node != nullptr; });
+        return out;
+    }
+
+    // Read-only copy of the tree in the cache-friendly layout for the faster lookups
+    FrozenTree<KeyT, Comparator> freeze() const { return FrozenTree<KeyT, Comparator>(begin(), m_size); }
+
+    // Write binary image of the tree of trivially copyable keys into the file at path, returns false on error
+    // Image keeps the shape of the tree, so it is loaded without comparisons and fixups
+    bool save(const std::string &path) const {
+        return write_image<KeyT>(path, m_root, [this](Node *node) { return successor(node); });
+    }
+    // Replace keys of the tree with the image at path in one pass over the mapped file, MappedTree uses it in place
+    // Returns false and keeps the tree, if the file isn't a valid image of KeyT
+    bool load(const std::string &path);
+
+    // Check red-black invariants, cached black heights, sizes, parent links and order of the keys in O(n)
+    bool validate() const;
+
+    // Join another tree into this, keys of other must be not less than keys of this, other becomes empty
     void join(RedBlackTree &other);
-    // Split the tree by the given key
+    // Split the tree by the given key into trees with keys less than key and not less than key
     // Destroyts tree, returning two trees instead
     std::pair<RedBlackTree, RedBlackTree> split(const KeyT &key);
+    // Erase keys in [low, high], returns number of erased keys
+    // Range is cut out by two splits and one join in O(log n), its k nodes are freed in O(k)
+    size_t erase_range(const KeyT &low, const KeyT &high) {
+        size_t erased = destroy_subtree(cut_range(low, high));
+        dump_to_graphviz();
+        return erased;
+    }
+    // Move keys in [low, high] into the returned tree in O(log n)
+    // Nodes are freed with the returned tree, so the large range may be freed away from the write path
+    RedBlackTree extract_range(const KeyT &low, const KeyT &high);
     // Merge one tree into another
-    void merge(RedBlackTree &other);
-
-    // Enable logging
-    void enable_log() { m_log = true; }
-    // Dump current state of the tree to graphviz and generate png
-    void dump_to_graphviz();
-    // Set log files to start with log_name
-    void set_log_name(std::string &log_name) { m_log_name = log_name; }
+    void merge(RedBlackTree &other) { union_with(other); }
+
+    // Add keys of other tree into this, other becomes empty
+    void union_with(RedBlackTree &other, Execution execution = Execution::Sequential) {
+        set_operation(SetOperation::Union, other, execution);
+    }
+    // Add keys of other tree into this, other becomes empty
+    // For the keys in both trees the key of other is kept, combine(kept, dropped) is called before the key of this
+    // is freed, and may change the parts of the key, that don't take part in the ordering
+    template <typename Combine>
+    void union_with(RedBlackTree &other, Combine combine, Execution execution = Execution::Sequential) {
+        set_operation(SetOperation::Union, other, execution, combine);
+    }
+    // Keep only keys, contained in other tree, other becomes empty
+    void intersect_with(RedBlackTree &other, Execution execution = Execution::Sequential) {
+        set_operation(SetOperation::Intersection, other, execution);
+    }
+    // Erase keys, contained in other tree, other becomes empty
+    void difference_with(RedBlackTree &other, Execution execution = Execution::Sequential) {
+        set_operation(SetOperation::Difference, other, execution);
+    }
+    // Keep keys, contained in exactly one of the trees, other becomes empty
+    void symmetric_difference(RedBlackTree &other, Execution execution = Execution::Sequential) {
+        set_operation(SetOperation::SymmetricDifference, other, execution);
+    }
+
+    // Erase keys, for which pred is false, returns number of erased keys
+    // Subtrees are filtered independently and the survivors are joined back in O(n), so pred must be thread safe
+    // for the parallel execution
+    template <typename Predicate> size_t filter(Predicate pred, Execution execution = Execution::Sequential);
+    // Reduce map(key) of all keys in the order of the keys with the associative reduce, starting from identity
+    // Subtrees are reduced in parallel, so map and reduce must be thread safe
+    template <typename T, typename Map, typename Reduce> T parallel_reduce(T identity, Map map, Reduce reduce) const {
+        return reduce_subtree(m_root, parallel_grain(m_size), identity, map, reduce);
+    }
+    // Call visit for all keys, subtrees are visited in parallel, so visit must be thread safe
+    // and the order of the calls is unspecified
+    template <typename Visit> void parallel_for_each(Visit visit) const {
+        for_each_subtree(m_root, parallel_grain(m_size), visit);
+    }
+
+    // Start recording changes of the tree into the binary trace file <log name>.trace,
+    // trace is rendered to graphviz offline by trace_replay. Does nothing without TASK1_TRACE
+    void enable_log();
+    // Stop recording, trace file is complete after it
+    void disable_log();
+    // Record current state of the tree as the frame of the trace
+    void dump_to_graphviz() { trace(TraceEvent::Type::Frame, m_root); }
+    // Set name of the trace file, active recording is restarted into the file of the new name
+    void set_log_name(const std::string &log_name);
 }; // class RedBlackTree
 
-template <typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::rotate(Node *node, Side side) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::rotate(Node *node, Side side) {
     Side opposite_side = opposite(side);
     if (!node || !node->get_child(opposite_side)) {
         return;
     }
 
+    trace(TraceEvent::Type::Rotate, node, nullptr, side == Side::Right);
+    count_stat(StatsCounter::Rotations);
     Node *child = node->get_child(opposite_side);
-    node->set_child(child->get_child(side), opposite_side);
+    link(node, child->get_child(side), opposite_side);
 
     Node *parent = node->get_parent();
     child->set_parent(parent);
 
     Side node_side = node->get_side();
-    if (node_side == Side::None) {
-        m_root = child;
+    if (node == m_root) {
+        set_root(child);
         m_root->set_side(Side::None);
     }
 
     if (parent) {
-        parent->set_child(child, node_side);
+        link(parent, child, node_side);
     }
-    child->set_child(node, side);
+    link(child, node, side);
+    update_size(node);
+    update_size(child);
 
     dump_to_graphviz();
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::minimum(Node *node) const {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::minimum(Node *node) const {
     while (node->get_left()) {
         node = node->get_left();
     }
@@ -149,8 +672,8 @@ TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::minimum(Node *node) const {
     return node;
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::successor(Node *node) const {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::successor(Node *node) const {
     if (node->get_right()) {
         return minimum(node->get_right());
     }
@@ -164,25 +687,96 @@ TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::successor(Node *node) const {
     return parent;
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::find(Node *node, KeyT &key) const {
-    if (node == nullptr || key == node->get_key()) {
-        return node;
-    } else if (Comparator()(key, node->get_key())) {
-        return find(node->get_left(), key);
-    } else {
-        return find(node->get_right(), key);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::maximum(Node *node) const {
+    while (node->get_right()) {
+        node = node->get_right();
+    }
+
+    return node;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::predecessor(Node *node) const {
+    if (node->get_left()) {
+        return maximum(node->get_left());
+    }
+
+    Node *parent = node->get_parent();
+    while (parent != nullptr && node == parent->get_left()) {
+        node = parent;
+        parent = parent->get_parent();
+    }
+
+    return parent;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::lower_bound_node(const K &key) const {
+    SearchKey<K> search_key(key);
+    Node *bound = nullptr;
+    Node *curr_node = m_root;
+    while (curr_node) {
+        if (node_less(curr_node, search_key)) {
+            curr_node = curr_node->get_right();
+        } else {
+            bound = curr_node;
+            curr_node = curr_node->get_left();
+        }
     }
+
+    return bound;
 }
 
-template <typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::insert_fixup(Node *node) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::upper_bound_node(const K &key) const {
+    SearchKey<K> search_key(key);
+    Node *bound = nullptr;
+    Node *curr_node = m_root;
+    while (curr_node) {
+        if (key_less(search_key, curr_node)) {
+            bound = curr_node;
+            curr_node = curr_node->get_left();
+        } else {
+            curr_node = curr_node->get_right();
+        }
+    }
+
+    return bound;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::find_node(const K &key) const {
+    // Single comparison per level, the last node not greater than key is checked at the end.
+    // Side is picked as a value, so descent compiles without unpredictable branches
+    SearchKey<K> search_key(key);
+    Node *candidate = nullptr;
+    Node *curr_node = m_root;
+    while (curr_node) {
+        bool go_left = key_less(search_key, curr_node);
+        candidate = go_left ? candidate : curr_node;
+        curr_node = curr_node->get_child(go_left ? Side::Left : Side::Right);
+    }
+
+    if (candidate && !node_less(candidate, search_key)) {
+        return candidate;
+    }
+    return nullptr;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::insert_fixup(Node *node) {
     if (node == m_root) {
-        node->set_color(Color::Black);
+        recolor(node, Color::Black);
         return;
     }
 
     while (is_red(node->get_parent())) {
+        trace(TraceEvent::Type::InsertFixup, node);
+        count_stat(StatsCounter::InsertFixups);
         Node *parent = node->get_parent();
         Node *parent_parent = parent->get_parent();
 
@@ -191,9 +785,9 @@ void RedBlackTree<KeyT, Comparator>::insert_fixup(Node *node) {
         Node *parent_parent_child = parent_parent->get_child(opposite_side);
 
         if (is_red(parent_parent_child)) {
-            parent->set_color(Color::Black);
-            parent_parent_child->set_color(Color::Black);
-            parent_parent->set_color(Color::Red);
+            recolor(parent, Color::Black);
+            recolor(parent_parent_child, Color::Black);
+            recolor(parent_parent, Color::Red);
             uint64_t height = parent->get_height();
             parent->set_height(height + 1);
             parent_parent_child->set_height(height + 1);
@@ -206,14 +800,14 @@ void RedBlackTree<KeyT, Comparator>::insert_fixup(Node *node) {
 
         parent = node->get_parent();
         if (parent) {
-            parent->set_color(Color::Black);
+            recolor(parent, Color::Black);
             parent->set_height(parent->get_height() + 1);
             parent_parent = parent->get_parent();
             if (parent_parent) {
                 if (parent_parent->get_child(opposite_side)) {
                     node = parent_parent->get_child(opposite_side);
                 }
-                parent_parent->set_color(Color::Red);
+                recolor(parent_parent, Color::Red);
                 parent_parent->set_height(parent_parent->get_height() - 1);
                 rotate(parent_parent, opposite_side);
             } else {
@@ -224,14 +818,16 @@ void RedBlackTree<KeyT, Comparator>::insert_fixup(Node *node) {
 
     if (is_red(m_root)) {
         m_root->set_height(m_root->get_height() + 1);
-        m_root->set_color(Color::Black);
+        recolor(m_root, Color::Black);
     }
     m_root->set_side(Side::None);
 }
 
-template <typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::erase_fixup(Node *node) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::erase_fixup(Node *node) {
     while (node && node != m_root && is_black(node)) {
+        trace(TraceEvent::Type::EraseFixup, node);
+        count_stat(StatsCounter::EraseFixups);
         Node *parent = node->get_parent();
 
         Side side = node->get_side();
@@ -239,94 +835,137 @@ void RedBlackTree<KeyT, Comparator>::erase_fixup(Node *node) {
 
         Node *parent_child = parent->get_child(opposite_side);
         if (is_red(parent_child)) {
-            parent_child->set_color(Color::Black);
-            uint64_t parent_child_height = parent->get_height();
+            recolor(parent_child, Color::Black);
+            recolor(parent, Color::Red);
             rotate(parent, side);
-            parent->set_color(Color::Red);
-            parent->set_height(parent_child_height);
-            parent_child->set_height(parent_child_height + 1);
 
-            parent = node->get_parent();
             parent_child = parent->get_child(opposite_side);
         }
 
         if (is_black(parent_child->get_left()) && is_black(parent_child->get_right())) {
-            if (parent_child->get_color() == Color::Black) {
-                parent_child->set_height(parent_child->get_height() - 1);
-                parent->set_height(parent->get_height() - 1);
-            }
-            parent_child->set_color(Color::Red);
-            node = node->get_parent();
+            recolor(parent_child, Color::Red);
+            update_height(parent_child);
+            node = parent;
             continue;
         } else if (is_black(parent_child->get_child(opposite_side))) {
-            if (parent_child->get_child(side)) {
-                parent_child->get_child(side)->set_color(Color::Black);
-            }
-
-            parent_child->set_color(Color::Red);
-            parent_child->set_height(parent_child->get_height() - 1);
+            recolor(parent_child->get_child(side), Color::Black);
+            recolor(parent_child, Color::Red);
             rotate(parent_child, opposite_side);
+            update_height(parent_child);
             parent_child = parent->get_child(opposite_side);
         }
 
-        parent_child->set_color(parent->get_color());
-        parent->set_color(Color::Black);
-        if (parent_child->get_child(opposite_side)) {
-            if (is_red(parent_child->get_child(opposite_side))) {
-                parent_child->get_child(opposite_side)->set_height(parent_child->get_child(opposite_side)->get_height() + 1);
-            }
-            parent_child->get_child(opposite_side)->set_color(Color::Black);
-        }
+        recolor(parent_child, parent->get_color());
+        recolor(parent, Color::Black);
+        recolor(parent_child->get_child(opposite_side), Color::Black);
+        update_height(parent_child->get_child(opposite_side));
 
         rotate(parent, side);
-        parent->set_height(parent->get_height() - 1);
-        parent_child->set_height(parent_child->get_height() + 1);
         node = m_root;
     }
 
-    if (is_red(node)) {
-        node->set_height(node->get_height() + 1);
+    if (node) {
+        recolor(node, Color::Black);
     }
-    node->set_color(Color::Black);
 }
 
-template <typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::insert(const KeyT &key) {
-    Node *new_node = new Node(key);
-    Node *parent = nullptr;
-    Node *curr_node = m_root;
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::update_height(Node *node) {
+    uint64_t height = std::max(get_black_height(node->get_left()), get_black_height(node->get_right()));
+    node->set_height(is_black(node) ? height + 1 : height);
+}
 
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::insert_node(Node *new_node, Node *finger, size_t max_bounds) {
+    trace_create(new_node);
+    Node *candidate = nullptr;
+    Node *subtree = finger ? finger_subtree(finger, new_node->get_key(), candidate, max_bounds) : m_root;
+    // Ancestors of the subtree get the node too, the climb has just brought them into the cache
+    for (Node *ancestor = subtree ? subtree->get_parent() : nullptr; ancestor; ancestor = ancestor->get_parent()) {
+        ancestor->set_size(ancestor->get_size() + 1);
+    }
+
+    Node *curr_node = subtree;
+    Node *parent = nullptr;
+    Side side = Side::Left;
+    SearchKey<KeyT> new_key(new_node->get_key());
     while (curr_node) {
         parent = curr_node;
-        if (Comparator()(new_node->get_key(), curr_node->get_key())) {
-            curr_node = curr_node->get_left();
-        } else {
-            curr_node = curr_node->get_right();
-        }
+        curr_node->set_size(curr_node->get_size() + 1);
+        side = key_less(new_key, curr_node) ? Side::Left : Side::Right;
+        curr_node = curr_node->get_child(side);
     }
 
     if (!parent) {
-        m_root = new_node;
+        set_root(new_node);
         m_root->set_side(Side::None);
         m_root->set_height(1);
-    } else if (Comparator()(new_node->get_key(), parent->get_key())) {
-        parent->set_left(new_node);
     } else {
-        parent->set_right(new_node);
+        link(parent, new_node, side);
     }
+    update_path(new_node);
 
     m_size += 1;
 
     dump_to_graphviz();
 
     insert_fixup(new_node);
+    m_finger = new_node;
 
     dump_to_graphviz();
+    return new_node;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::finger_subtree(Node *finger, const K &key, Node *&candidate,
+                                                                        size_t max_bounds) const {
+    // Subtree of the node lies between its closest ancestors, whose right and left subtrees contain it.
+    // Key is on one side of the finger, so climbing checks only the bound on that side,
+    // which is the first ancestor, entered from the other side
+    Side side = key_less(key, finger) ? Side::Left : Side::Right;
+    Node *subtree = finger;
+    for (Node *node = finger; node->get_parent(); node = node->get_parent()) {
+        if (node->get_side() == side) {
+            continue;
+        }
+        Node *bound = node->get_parent();
+        bool inside = side == Side::Left ? !key_less(key, bound) : key_less(key, bound);
+        if (inside) {
+            candidate = side == Side::Left ? bound : nullptr;
+            return subtree;
+        }
+        if (max_bounds-- == 0) {
+            return m_root;
+        }
+        subtree = bound;
+    }
+    // There is no bound on this side
+    return subtree;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::finger_find(Node *finger, const K &key) const {
+    SearchKey<K> search_key(key);
+    Node *candidate = nullptr;
+    Node *curr_node = finger ? finger_subtree(finger, key, candidate) : m_root;
+    while (curr_node) {
+        bool go_left = key_less(search_key, curr_node);
+        candidate = go_left ? candidate : curr_node;
+        curr_node = curr_node->get_child(go_left ? Side::Left : Side::Right);
+    }
+
+    if (candidate && !node_less(candidate, search_key)) {
+        return candidate;
+    }
+    return nullptr;
 }
 
-template <typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::erase(KeyT &key) {
-    Node *node = find(key);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::erase_key(const K &key) {
+    Node *node = find_node(key);
 
     if (!node) {
         return;
@@ -334,12 +973,14 @@ void RedBlackTree<KeyT, Comparator>::erase(KeyT &key) {
     erase(node);
 }
 
-template <typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::erase(Node *node) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::erase(Node *node) {
     Node *succ = nullptr;
     Node *succ_child = nullptr;
     Node nil {nullptr, nullptr, nullptr};
     bool nil_child = false;
+    trace(TraceEvent::Type::Create, &nil);
+    trace(TraceEvent::Type::Recolor, &nil, nullptr, nil.get_color() == Color::Black);
 
     if (!node->get_left() || !node->get_right()) {
         succ = node;
@@ -360,15 +1001,16 @@ void RedBlackTree<KeyT, Comparator>::erase(Node *node) {
     succ_child->set_parent(succ_parent);
 
     if (!succ_parent) {
-        m_root = succ_child;
+        set_root(succ_child);
         succ_child->set_side(Side::None);
     } else {
         Side side = succ->get_side();
-        succ_parent->set_child(succ_child, side);
+        link(succ_parent, succ_child, side);
     }
 
     if (succ != node) {
-        node->copy_data(succ);
+        node->move_data(succ);
+        trace(TraceEvent::Type::MoveKey, node, succ, 0, trace_key(node->get_key()));
     }
 
     dump_to_graphviz();
@@ -377,54 +1019,182 @@ void RedBlackTree<KeyT, Comparator>::erase(Node *node) {
         erase_fixup(succ_child);
     }
 
+    Node *height_node = succ_child;
     if (nil_child) {
         succ_parent = succ_child->get_parent();
+        height_node = succ_parent;
         if (!succ_parent) {
-            m_root = nullptr;
+            set_root(nullptr);
         } else {
             Side side =  succ_child->get_side();
-            succ_parent->set_child(nullptr, side);
+            link(succ_parent, nullptr, side);
         }
     }
 
+    // Fixup may have changed colors and shape anywhere on the path to the root
+    for (; height_node; height_node = height_node->get_parent()) {
+        update_height(height_node);
+        update_size(height_node);
+    }
+
     m_size -= 1;
-    delete succ;
+    if (succ == m_finger) {
+        m_finger = nullptr;
+    }
+    trace(TraceEvent::Type::Destroy, succ);
+    trace(TraceEvent::Type::Destroy, &nil);
+    m_alloc.destroy(succ);
 
     dump_to_graphviz();
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::find(KeyT &key) const {
-    return find(m_root, key);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::select(size_t k) const {
+    Node *curr_node = m_root;
+    while (curr_node) {
+        size_t left_size = get_size(curr_node->get_left());
+        if (k == left_size) {
+            return curr_node;
+        } else if (k < left_size) {
+            curr_node = curr_node->get_left();
+        } else {
+            k -= left_size + 1;
+            curr_node = curr_node->get_right();
+        }
+    }
+
+    return nullptr;
 }
 
-template <typename KeyT, typename Comparator>
-bool RedBlackTree<KeyT, Comparator>::contains(KeyT &key) const {
-    if (find(m_root, key)) {
-        return true;
-    } else {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+size_t RedBlackTree<KeyT, Comparator, Allocator, NodeT>::count_less(const K &key, bool inclusive) const {
+    SearchKey<K> search_key(key);
+    size_t count = 0;
+    Node *curr_node = m_root;
+    while (curr_node) {
+        bool go_right = inclusive ? !key_less(search_key, curr_node)
+                                  : node_less(curr_node, search_key);
+        if (go_right) {
+            count += get_size(curr_node->get_left()) + 1;
+            curr_node = curr_node->get_right();
+        } else {
+            curr_node = curr_node->get_left();
+        }
+    }
+
+    return count;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+size_t RedBlackTree<KeyT, Comparator, Allocator, NodeT>::count_in_range(const KeyT &low, const KeyT &high) const {
+    if (less(high, low)) {
+        return 0;
+    }
+    return count_less(high, true) - count_less(low, false);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename K>
+auto RedBlackTree<KeyT, Comparator, Allocator, NodeT>::aggregate_range(const K &low, const K &high) const {
+    static_assert(Augmented, "Aggregates are kept only by the trees of the augmented nodes");
+    // Descend to the highest node in the range, ranges of both its subtrees are bounded on one side only
+    Node *split_node = m_root;
+    while (split_node && (node_less(split_node, low) || key_less(high, split_node))) {
+        split_node = split_node->get_child(node_less(split_node, low) ? Side::Right : Side::Left);
+    }
+    if (!split_node) {
+        return Augmentation::identity();
+    }
+
+    // Keys, not less than low, in the left subtree: every node in the range comes with its right subtree
+    // before all keys, collected so far
+    auto left = Augmentation::identity();
+    for (Node *node = split_node->get_left(); node;) {
+        if (node_less(node, low)) {
+            node = node->get_right();
+        } else {
+            left = Augmentation::combine(
+                Augmentation::combine(Augmentation::lift(node->get_key()), get_aggregate(node->get_right())), left);
+            node = node->get_left();
+        }
+    }
+    // Symmetrically, keys, not greater than high, in the right subtree
+    auto right = Augmentation::identity();
+    for (Node *node = split_node->get_right(); node;) {
+        if (key_less(high, node)) {
+            node = node->get_left();
+        } else {
+            right = Augmentation::combine(
+                right, Augmentation::combine(get_aggregate(node->get_left()), Augmentation::lift(node->get_key())));
+            node = node->get_right();
+        }
+    }
+    return Augmentation::combine(Augmentation::combine(left, Augmentation::lift(split_node->get_key())), right);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+bool RedBlackTree<KeyT, Comparator, Allocator, NodeT>::validate() const {
+    if (!m_root) {
+        return m_size == 0;
+    }
+    if (is_red(m_root) || m_root->get_parent() || m_root->get_size() != m_size ||
+        !validate_subtree(m_root, m_root->get_height())) {
         return false;
     }
+
+    // Shape is valid, so in-order walk visits every node once
+    for (Node *node = minimum(m_root), *next = successor(node); next; node = next, next = successor(next)) {
+        if (Comparator()(next->get_key(), node->get_key())) {
+            return false;
+        }
+    }
+    return true;
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::join_right(Node *left_subroot, Node *key_node, Node *right_subroot) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+bool RedBlackTree<KeyT, Comparator, Allocator, NodeT>::validate_subtree(Node *node, uint64_t height) const {
+    if (node->get_height() != height || (is_black(node) && height == 0)) {
+        return false;
+    }
+    uint64_t child_height = is_black(node) ? height - 1 : height;
+    for (Side side : {Side::Left, Side::Right}) {
+        Node *child = node->get_child(side);
+        if (!child) {
+            if (child_height != 0) {
+                return false;
+            }
+            continue;
+        }
+        if (child->get_parent() != node || child->get_side() != side || (is_red(node) && is_red(child)) ||
+            !validate_subtree(child, child_height)) {
+            return false;
+        }
+    }
+    return node->get_size() == get_size(node->get_left()) + get_size(node->get_right()) + 1;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::join_right(Node *left_subroot, Node *key_node, Node *right_subroot) {
+    StatsDepth<StatsRecursion::Join> depth;
     if (is_black(left_subroot) && get_black_height(left_subroot) == get_black_height(right_subroot)) {
-        key_node->set_childs(left_subroot, right_subroot);
+        link_childs(key_node, left_subroot, right_subroot);
+        update_size(key_node);
         key_node->set_parent(nullptr);
         key_node->set_height(get_black_height(left_subroot));
-        key_node->set_color(Color::Red);
+        recolor(key_node, Color::Red);
         return key_node;
     }
 
     Node *right_join = join_right(left_subroot->get_right(), key_node, right_subroot);
     right_join->set_parent(left_subroot);
-    left_subroot->set_right(right_join);
+    link(left_subroot, right_join, Side::Right);
+    update_size(left_subroot);
     left_subroot->set_parent(nullptr);
     left_subroot->set_height(right_join->get_height());
     if (is_black(left_subroot) && is_red(left_subroot->get_right()) && is_red(left_subroot->get_right()->get_right())) {
         Node *left_subroot_right_right = left_subroot->get_right()->get_right();
-        left_subroot_right_right->set_color(Color::Black);
+        recolor(left_subroot_right_right, Color::Black);
         left_subroot_right_right->set_height(left_subroot_right_right->get_height() + 1);
         left_subroot->set_height(left_subroot_right_right->get_height());
         left_subroot->get_right()->set_height(left_subroot->get_height());
@@ -440,23 +1210,26 @@ TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::join_right(Node *left_subroot, N
     return left_subroot;
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::join_left(Node *left_subroot, Node *key_node, Node *right_subroot) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::join_left(Node *left_subroot, Node *key_node, Node *right_subroot) {
+    StatsDepth<StatsRecursion::Join> depth;
     if (is_black(right_subroot) && get_black_height(left_subroot) == get_black_height(right_subroot)) {
-        key_node->set_childs(left_subroot, right_subroot);
+        link_childs(key_node, left_subroot, right_subroot);
+        update_size(key_node);
         key_node->set_parent(nullptr);
         key_node->set_height(get_black_height(left_subroot));
-        key_node->set_color(Color::Red);
+        recolor(key_node, Color::Red);
         return key_node;
     }
 
     Node *left_subroot_join = join_left(left_subroot, key_node, right_subroot->get_left());
     left_subroot_join->set_parent(right_subroot);
-    right_subroot->set_left(left_subroot_join);
+    link(right_subroot, left_subroot_join, Side::Left);
+    update_size(right_subroot);
     right_subroot->set_parent(nullptr);
     if (is_black(right_subroot) && is_red(right_subroot->get_left()) && is_red(right_subroot->get_left()->get_left())) {
         Node *right_subroot_left_left = right_subroot->get_left()->get_left();
-        right_subroot_left_left->set_color(Color::Black);
+        recolor(right_subroot_left_left, Color::Black);
         right_subroot_left_left->set_height(right_subroot_left_left->get_height() + 1);
         right_subroot->set_height(right_subroot_left_left->get_height());
         right_subroot->get_left()->set_height(right_subroot->get_height());
@@ -472,14 +1245,15 @@ TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::join_left(Node *left_subroot, No
     return right_subroot;
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::join(Node *left_subroot, Node *key_node, Node *right_subroot) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::join(Node *left_subroot, Node *key_node, Node *right_subroot) {
+    trace(TraceEvent::Type::Join, key_node);
     if (get_black_height(left_subroot) > get_black_height(right_subroot)) {
         Node *new_sub_root = join_right(left_subroot, key_node, right_subroot);
 
         if (is_red(new_sub_root) && is_red(new_sub_root->get_right())) {
             new_sub_root->set_height(new_sub_root->get_right()->get_height() + 1);
-            new_sub_root->set_color(Color::Black);
+            recolor(new_sub_root, Color::Black);
         }
         return new_sub_root;
     } else if (get_black_height(left_subroot) < get_black_height(right_subroot)) {
@@ -487,88 +1261,693 @@ TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::join(Node *left_subroot, Node *k
 
         if (is_red(new_sub_root) && is_red(new_sub_root->get_left())) {
             new_sub_root->set_height(new_sub_root->get_left()->get_height() + 1);
-            new_sub_root->set_color(Color::Black);
+            recolor(new_sub_root, Color::Black);
         }
         return new_sub_root;
     } else if (left_subroot && right_subroot && is_black(left_subroot) && is_black(right_subroot)) {
-        key_node->set_childs(left_subroot, right_subroot);
-        key_node->set_color(Color::Red);
+        link_childs(key_node, left_subroot, right_subroot);
+        update_size(key_node);
+        recolor(key_node, Color::Red);
         key_node->set_height(left_subroot->get_height());
         key_node->set_parent(nullptr);
         return key_node;
     }
 
-    key_node->set_childs(left_subroot, right_subroot);
-    key_node->set_color(Color::Black);
+    link_childs(key_node, left_subroot, right_subroot);
+    update_size(key_node);
+    recolor(key_node, Color::Black);
     key_node->set_height(get_black_height(left_subroot) + 1);
     key_node->set_parent(nullptr);
     return key_node;
 }
 
-template <typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::merge(RedBlackTree &other) {
-    m_root = merge(m_root, other.m_root);
-    m_root->set_color(Color::Black);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::join(Node *left_subroot, Node *right_subroot) {
+    if (!left_subroot) {
+        return right_subroot;
+    } else if (!right_subroot) {
+        return left_subroot;
+    }
+
+    auto [left_rest, last_node] = split_last(left_subroot);
+    return join(left_rest, last_node, right_subroot);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+std::pair<NodeT *, NodeT *> RedBlackTree<KeyT, Comparator, Allocator, NodeT>::split_last(Node *subroot) {
+    if (!subroot->get_right()) {
+        return {subroot->get_left(), subroot};
+    }
+
+    auto [right_rest, last_node] = split_last(subroot->get_right());
+    return {join(subroot->get_left(), subroot, right_rest), last_node};
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename Combine>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::set_operation(SetOperation operation, RedBlackTree &other,
+                                                              Execution execution, Combine combine) {
+    // Trace is replayed in the order of events, so traced operations don't run concurrently
+    if (tracing()) {
+        execution = Execution::Sequential;
+        trace_subtree(other.m_root);
+    }
+
+    m_alloc.adopt(other.m_alloc);
+    Node *left_root = m_root;
+    Node *right_root = other.m_root;
+    set_root(nullptr);
     other.m_root = nullptr;
+    // Finger may be among the freed nodes
+    m_finger = nullptr;
+    other.m_finger = nullptr;
+
+    std::vector<Node *> garbage;
+    Node *new_root = set_operation(operation, left_root, right_root, execution, combine, garbage);
+
+    size_t freed = 0;
+    for (auto subroot : garbage) {
+        freed += destroy_subtree(subroot);
+    }
+
+    set_root(make_root(new_root));
+    m_size = m_size + other.m_size - freed;
+    other.m_size = 0;
 
     dump_to_graphviz();
 }
 
-template <typename KeyT, typename Comparator>
-TreeNode<KeyT> *RedBlackTree<KeyT, Comparator>::merge(Node *left_subroot, Node *right_subroot) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename Combine>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::set_operation(SetOperation operation, Node *left_subroot,
+                                                                         Node *right_subroot, Execution execution,
+                                                                         Combine &combine,
+                                                                         std::vector<Node *> &garbage) {
     if (!left_subroot) {
-        return right_subroot;
+        if (operation == SetOperation::Union || operation == SetOperation::SymmetricDifference) {
+            return right_subroot;
+        }
+        garbage.push_back(right_subroot);
+        return nullptr;
     } else if (!right_subroot) {
+        if (operation == SetOperation::Intersection) {
+            garbage.push_back(left_subroot);
+            return nullptr;
+        }
         return left_subroot;
     }
 
-    auto [left_tmp_root, right_tmp_root] = split(left_subroot, right_subroot);
-    Node *new_left = merge(left_tmp_root, right_subroot->get_left());
-    Node *new_right = merge(right_tmp_root, right_subroot->get_right());
+    Node *key_node = right_subroot;
+    Node *right_left = key_node->get_left();
+    Node *right_right = key_node->get_right();
+    auto [left_left, equal_node, left_right] = split(left_subroot, key_node->get_key());
+
+    // Small subtrees are not worth the task overhead
+    bool fork = std::min(get_black_height(left_subroot), get_black_height(right_subroot)) >= MinParallelBlackHeight;
+    Node *new_left = nullptr;
+    Node *new_right = nullptr;
+    std::vector<Node *> left_garbage;
+    fork_join(
+        fork ? execution : Execution::Sequential,
+        [&] { new_left = set_operation(operation, left_left, right_left, execution, combine, left_garbage); },
+        [&] { new_right = set_operation(operation, left_right, right_right, execution, combine, garbage); });
+    garbage.insert(garbage.end(), left_garbage.begin(), left_garbage.end());
+
+    bool keep_key = false;
+    switch (operation) {
+    case SetOperation::Union:
+        keep_key = true;
+        break;
+    case SetOperation::Intersection:
+        keep_key = equal_node != nullptr;
+        break;
+    case SetOperation::Difference:
+        keep_key = false;
+        break;
+    case SetOperation::SymmetricDifference:
+        keep_key = equal_node == nullptr;
+        break;
+    }
+
+    if (equal_node) {
+        // Aggregate of the kept key is recomputed, when it is joined back
+        if (operation == SetOperation::Union) {
+            combine(key_node->get_key(), equal_node->get_key());
+        }
+        link_childs(equal_node, nullptr, nullptr);
+        garbage.push_back(equal_node);
+    }
+    if (keep_key) {
+        return join(new_left, key_node, new_right);
+    }
+
+    link_childs(key_node, nullptr, nullptr);
+    garbage.push_back(key_node);
+    return join(new_left, new_right);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename Predicate>
+size_t RedBlackTree<KeyT, Comparator, Allocator, NodeT>::filter(Predicate pred, Execution execution) {
+    // Trace is replayed in the order of events, so traced operations don't run concurrently
+    if (tracing()) {
+        execution = Execution::Sequential;
+    }
+    // Finger may be among the freed nodes
+    m_finger = nullptr;
+
+    std::vector<Node *> garbage;
+    set_root(make_root(filter_subtree(m_root, pred, execution, garbage)));
+
+    size_t erased = 0;
+    for (auto node : garbage) {
+        erased += destroy_subtree(node);
+    }
+    m_size -= erased;
+
+    dump_to_graphviz();
+    return erased;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename Predicate>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::filter_subtree(Node *subroot, Predicate &pred,
+                                                                          Execution execution,
+                                                                          std::vector<Node *> &garbage) {
+    if (!subroot) {
+        return nullptr;
+    }
+
+    Node *left = subroot->get_left();
+    Node *right = subroot->get_right();
+    // Small subtrees are not worth the task overhead
+    bool fork = get_black_height(subroot) >= MinParallelBlackHeight;
+    std::vector<Node *> left_garbage;
+    fork_join(
+        fork ? execution : Execution::Sequential,
+        [&] { left = filter_subtree(left, pred, execution, left_garbage); },
+        [&] { right = filter_subtree(right, pred, execution, garbage); });
+    garbage.insert(garbage.end(), left_garbage.begin(), left_garbage.end());
+
+    if (pred(subroot->get_key())) {
+        return join(left, subroot, right);
+    }
+    link_childs(subroot, nullptr, nullptr);
+    garbage.push_back(subroot);
+    return join(left, right);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename T, typename Map, typename Reduce>
+T RedBlackTree<KeyT, Comparator, Allocator, NodeT>::reduce_subtree(const Node *subroot, size_t grain, const T &identity,
+                                                                   Map &map, Reduce &reduce) const {
+    if (get_size(subroot) <= grain) {
+        T result = identity;
+        auto accumulate = [&](const KeyT &key) { result = reduce(std::move(result), map(key)); };
+        visit_subtree(subroot, accumulate);
+        return result;
+    }
+
+    T left_result = identity;
+    T right_result = identity;
+    fork_join([&] { left_result = reduce_subtree(subroot->get_left(), grain, identity, map, reduce); },
+              [&] { right_result = reduce_subtree(subroot->get_right(), grain, identity, map, reduce); });
+    return reduce(reduce(std::move(left_result), map(subroot->get_key())), std::move(right_result));
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename Visit>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::for_each_subtree(const Node *subroot, size_t grain,
+                                                                        Visit &visit) const {
+    if (get_size(subroot) <= grain) {
+        visit_subtree(subroot, visit);
+        return;
+    }
+
+    fork_join([&] { for_each_subtree(subroot->get_left(), grain, visit); },
+              [&] {
+                  visit(subroot->get_key());
+                  for_each_subtree(subroot->get_right(), grain, visit);
+              });
+}
 
-    return join(new_left, right_subroot, new_right);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename Visit>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::visit_subtree(const Node *subroot, Visit &visit) {
+    if (!subroot) {
+        return;
+    }
+    visit_subtree(subroot->get_left(), visit);
+    visit(subroot->get_key());
+    visit_subtree(subroot->get_right(), visit);
 }
 
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+size_t RedBlackTree<KeyT, Comparator, Allocator, NodeT>::destroy_subtree(Node *subroot) {
+    if (!subroot) {
+        return 0;
+    }
 
-template <typename KeyT, typename Comparator>
-std::pair<RedBlackTree<KeyT, Comparator>, RedBlackTree<KeyT, Comparator>>
-RedBlackTree<KeyT, Comparator>::split(const KeyT &key) {
-    Node key_node{key};
-    auto [left_root, right_root] = split(m_root, &key_node);
+    size_t count = destroy_subtree(subroot->get_left()) + destroy_subtree(subroot->get_right()) + 1;
+    m_alloc.destroy(subroot);
+    return count;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+std::pair<RedBlackTree<KeyT, Comparator, Allocator, NodeT>, RedBlackTree<KeyT, Comparator, Allocator, NodeT>>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::split(const KeyT &key) {
+    // Copies of the key may be on both sides of any of them, so the tree is split by the order only
+    auto [left_root, right_root] = split_bound(m_root, key, false);
 
     RedBlackTree left_tree;
     RedBlackTree right_tree;
 
-    left_tree.m_root = left_root;
-    left_tree.m_root->set_side(Side::None);
-    right_tree.m_root = right_root;
-    right_tree.m_root->set_side(Side::None);
+    left_tree.m_alloc = m_alloc;
+    left_tree.m_root = make_root(left_root);
+    left_tree.m_size = get_size(left_tree.m_root);
+    right_tree.m_alloc = m_alloc;
+    right_tree.m_root = make_root(right_root);
+    right_tree.m_size = m_size - left_tree.m_size;
+
+    set_root(nullptr);
+    m_size = 0;
+    m_finger = nullptr;
 
-    return std::pair<RedBlackTree, RedBlackTree> (left_tree, right_tree);
+    return std::pair<RedBlackTree, RedBlackTree>(std::move(left_tree), std::move(right_tree));
 }
 
-template <typename KeyT, typename Comparator>
-std::pair<TreeNode<KeyT> *, TreeNode<KeyT> *>
-RedBlackTree<KeyT, Comparator>::split(Node *subroot, Node *key_node) {
-    const KeyT &key = key_node->get_key();
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::extract_range(const KeyT &low, const KeyT &high) {
+    RedBlackTree range;
+    range.m_alloc = m_alloc;
+    range.m_root = make_root(cut_range(low, high));
+    range.m_size = get_size(range.m_root);
+    dump_to_graphviz();
+    return range;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::cut_range(const KeyT &low, const KeyT &high) {
+    if (!m_root || less(high, low)) {
+        return nullptr;
+    }
+    // Finger may be among the cut nodes
+    m_finger = nullptr;
+
+    auto [left_root, rest_root] = split_bound(m_root, low, false);
+    auto [range_root, right_root] = split_bound(rest_root, high, true);
+    set_root(make_root(join(left_root, right_root)));
+    m_size -= get_size(range_root);
+    return range_root;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+std::pair<NodeT *, NodeT *>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::split_bound(Node *subroot, const KeyT &key, bool inclusive) {
     if (!subroot) {
         return {nullptr, nullptr};
     }
-    if (key_node->get_key() == subroot->get_key()) {
-        return {subroot->get_left(), subroot->get_right()};
+    trace(TraceEvent::Type::Split, subroot, nullptr, 0, trace_key(key));
+    StatsDepth<StatsRecursion::Split> depth;
+
+    // Equal keys may be on both sides of the node, so they are told apart only by the order
+    bool go_right = inclusive ? !key_less(key, subroot) : node_less(subroot, key);
+    if (go_right) {
+        auto [left_tmp_root, right_tmp_root] = split_bound(subroot->get_right(), key, inclusive);
+        return {join(subroot->get_left(), subroot, left_tmp_root), right_tmp_root};
+    }
+    auto [left_tmp_root, right_tmp_root] = split_bound(subroot->get_left(), key, inclusive);
+    return {left_tmp_root, join(right_tmp_root, subroot, subroot->get_right())};
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+bool RedBlackTree<KeyT, Comparator, Allocator, NodeT>::load(const std::string &path) {
+    MappedFile file;
+    const ImageHeader *header = map_image(file, path, sizeof(KeyT), sizeof(ImageNode<KeyT>));
+    if (!header || !check_image<KeyT>(header)) {
+        return false;
+    }
+
+    clear();
+    const ImageNode<KeyT> *image = image_nodes<KeyT>(header);
+    // Nodes are created in the ascending order, except right children, that are created by their parents,
+    // so that every node is linked as soon as it is created
+    std::vector<Node *> nodes(header->m_size, nullptr);
+    auto node_at = [&](uint32_t index) -> Node * {
+        if (index == NoImageNode) {
+            return nullptr;
+        }
+        if (!nodes[index]) {
+            const ImageNode<KeyT> &image_node = image[index];
+            Node *node = m_alloc.create(image_node.m_key);
+            node->set_color(image_node.m_black ? Color::Black : Color::Red);
+            node->set_height(image_node.m_height);
+            node->set_size(image_node.m_size);
+            nodes[index] = node;
+        }
+        return nodes[index];
+    };
+    for (uint32_t index = 0; index < header->m_size; ++index) {
+        node_at(index)->set_childs(node_at(image[index].m_left), node_at(image[index].m_right));
+    }
+
+    if (header->m_size) {
+        // Aggregates aren't stored in the image
+        update_subtree(nodes[header->m_root]);
+        trace_subtree(nodes[header->m_root]);
+        set_root(nodes[header->m_root]);
+        m_root->set_side(Side::None);
     }
+    m_size = header->m_size;
 
-    if (Comparator()(key, subroot->get_key())) {
-        auto [left_tmp_root, right_tmp_root] = split(subroot->get_left(), key_node);
-        return {left_tmp_root, join(right_tmp_root, subroot, subroot->get_right())};
+    dump_to_graphviz();
+    return true;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::join(RedBlackTree &other) {
+    if (tracing()) {
+        trace_subtree(other.m_root);
     }
 
-    auto [left_tmp_root, right_tmp_root] = split(subroot->get_right(), key_node);
-    return {join(subroot->get_left(), subroot, left_tmp_root), right_tmp_root};
+    m_alloc.adopt(other.m_alloc);
+    Node *left_root = m_root;
+    Node *right_root = other.m_root;
+    other.m_root = nullptr;
+    other.m_finger = nullptr;
+    set_root(make_root(join(left_root, right_root)));
+    m_size += other.m_size;
+    other.m_size = 0;
+
+    dump_to_graphviz();
 }
 
-template <typename KeyT, typename Comparator>
-uint64_t RedBlackTree<KeyT, Comparator>::get_black_height(Node *node) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+std::tuple<NodeT *, NodeT *, NodeT *>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::split(Node *subroot, const KeyT &key) {
+    if (!subroot) {
+        return {nullptr, nullptr, nullptr};
+    }
+    trace(TraceEvent::Type::Split, subroot, nullptr, 0, trace_key(key));
+    StatsDepth<StatsRecursion::Split> depth;
+    int order = key_compare(key, subroot);
+    if (order < 0) {
+        auto [left_tmp_root, equal_node, right_tmp_root] = split(subroot->get_left(), key);
+        return {left_tmp_root, equal_node, join(right_tmp_root, subroot, subroot->get_right())};
+    }
+    if (order > 0) {
+        auto [left_tmp_root, equal_node, right_tmp_root] = split(subroot->get_right(), key);
+        return {join(subroot->get_left(), subroot, left_tmp_root), equal_node, right_tmp_root};
+    }
+
+    // Equivalent keys are equal for the tree, as for the lookups
+    return {subroot->get_left(), subroot, subroot->get_right()};
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename InputIt>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::RedBlackTree(InputIt first, InputIt last, Execution execution) {
+    assign(first, last, execution);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename InputIt>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::assign(InputIt first, InputIt last, Execution execution) {
+    clear();
+
+    using Category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, Category>) {
+        if (std::is_sorted(first, last, Comparator())) {
+            assign_sorted(first, last, execution);
+            return;
+        }
+    }
+
+    std::vector<KeyT> keys(first, last);
+    std::sort(keys.begin(), keys.end(), Comparator());
+    assign_sorted(keys.begin(), keys.end(), execution);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename InputIt>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::insert_batch(InputIt first, InputIt last, Execution execution) {
+    std::vector<KeyT> keys = sorted_batch(first, last);
+    if (keys.size() * SmallBatchRatio < m_size) {
+        for (auto &key : keys) {
+            if (!contains(key)) {
+                insert(key);
+            }
+        }
+        return;
+    }
+
+    RedBlackTree batch;
+    batch.assign_sorted(keys.begin(), keys.end(), execution);
+    union_with(batch, execution);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename InputIt>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::erase_batch(InputIt first, InputIt last, Execution execution) {
+    std::vector<KeyT> keys = sorted_batch(first, last);
+    if (keys.size() * SmallBatchRatio < m_size) {
+        for (auto &key : keys) {
+            erase(key);
+        }
+        return;
+    }
+
+    RedBlackTree batch;
+    batch.assign_sorted(keys.begin(), keys.end(), execution);
+    difference_with(batch, execution);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename ForwardIt, typename Report>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::search_batch(ForwardIt first, ForwardIt last, Report report) const {
+    using Category = typename std::iterator_traits<ForwardIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, Category>) {
+        // Sparse batch shares little of the paths, and interleaved searches hide more misses
+        bool dense = static_cast<size_t>(last - first) * SmallBatchRatio >= m_size;
+        if (dense && std::is_sorted(first, last, Comparator())) {
+            search_sorted(m_root, first, last, report);
+            return;
+        }
+    }
+
+    // Search state of the key of the group, as in find_node, the prefix of the key is computed once per key
+    struct Search {
+        SearchKey<KeyT> m_key;
+        Node *m_node;
+        Node *m_candidate;
+    };
+    Search searches[SearchGroupSize];
+    while (first != last) {
+        size_t group_size = 0;
+        for (; group_size < SearchGroupSize && first != last; ++group_size, ++first) {
+            searches[group_size] = {SearchKey<KeyT>(*first), m_root, nullptr};
+        }
+
+        // Every search takes one step per round, by the time it returns to the search, its next node is fetched
+        for (bool active = m_root != nullptr; active;) {
+            active = false;
+            for (size_t i = 0; i < group_size; ++i) {
+                Search &search = searches[i];
+                if (!search.m_node) {
+                    continue;
+                }
+                bool go_left = key_less(search.m_key, search.m_node);
+                search.m_candidate = go_left ? search.m_candidate : search.m_node;
+                search.m_node = search.m_node->get_child(go_left ? Side::Left : Side::Right);
+                if (search.m_node) {
+                    __builtin_prefetch(search.m_node);
+                    active = true;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < group_size; ++i) {
+            Node *candidate = searches[i].m_candidate;
+            report(candidate && !node_less(candidate, searches[i].m_key) ? candidate : nullptr);
+        }
+    }
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename RandomIt, typename Report>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::search_sorted(Node *subroot, RandomIt first, RandomIt last,
+                                                                   Report &report) const {
+    if (first == last) {
+        return;
+    }
+    if (!subroot) {
+        for (; first != last; ++first) {
+            report(nullptr);
+        }
+        return;
+    }
+
+    // Keys less than the key of the node are in the left subtree, greater ones in the right subtree.
+    // Every node is visited once for the whole batch, and keys are split by binary search over the batch,
+    // while both children are fetched
+    __builtin_prefetch(subroot->get_left());
+    __builtin_prefetch(subroot->get_right());
+    RandomIt equal_first = std::lower_bound(first, last, subroot->get_key(), Comparator());
+    RandomIt equal_last = std::upper_bound(equal_first, last, subroot->get_key(), Comparator());
+    search_sorted(subroot->get_left(), first, equal_first, report);
+    for (; equal_first != equal_last; ++equal_first) {
+        report(subroot);
+    }
+    search_sorted(subroot->get_right(), equal_last, last, report);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename InputIt>
+std::vector<KeyT> RedBlackTree<KeyT, Comparator, Allocator, NodeT>::sorted_batch(InputIt first, InputIt last) {
+    std::vector<KeyT> keys(first, last);
+    std::sort(keys.begin(), keys.end(), Comparator());
+    auto equal = [](const KeyT &lhs, const KeyT &rhs) { return !less(lhs, rhs); };
+    keys.erase(std::unique(keys.begin(), keys.end(), equal), keys.end());
+    return keys;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename RandomIt>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::assign_sorted(RandomIt first, RandomIt last, Execution execution) {
+    size_t size = last - first;
+
+    // Trace is replayed in the order of events, so traced operations don't run concurrently
+    if (execution == Execution::Parallel && !tracing()) {
+        set_root(make_root(parallel_build(first, last, parallel_grain(size), m_alloc)));
+    } else {
+        set_root(make_root(build(first, last, m_alloc)));
+    }
+    m_size = size;
+
+    dump_to_graphviz();
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename RandomIt>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::build(RandomIt first, RandomIt last,
+                                                                 Allocator<Node> &alloc) {
+    size_t size = last - first;
+    if (size == 0) {
+        return nullptr;
+    }
+    return build(first, last, 0, build_red_depth(size), alloc);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+uint64_t RedBlackTree<KeyT, Comparator, Allocator, NodeT>::build_red_depth(size_t size) {
+    // Tree, built from the middle keys, has all levels except the last one full.
+    // Nodes of the last level are red, unless it is full too.
+    uint64_t last_depth = 0;
+    while ((size_t{2} << last_depth) <= size) {
+        last_depth += 1;
+    }
+    bool full = ((size + 1) & size) == 0;
+    return full ? last_depth + 1 : last_depth;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::color_built(Node *node, uint64_t depth, uint64_t red_depth) {
+    if (depth == red_depth) {
+        recolor(node, Color::Red);
+        node->set_height(0);
+    } else {
+        recolor(node, Color::Black);
+        node->set_height(red_depth - depth);
+    }
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename RandomIt>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::build(RandomIt first, RandomIt last, uint64_t depth,
+                                                                 uint64_t red_depth, Allocator<Node> &alloc) {
+    if (first == last) {
+        return nullptr;
+    }
+
+    RandomIt middle = first + (last - first) / 2;
+    Node *node = alloc.create(*middle);
+    trace_create(node);
+    link_childs(node, build(first, middle, depth + 1, red_depth, alloc),
+                build(middle + 1, last, depth + 1, red_depth, alloc));
+    update_size(node);
+    color_built(node, depth, red_depth);
+    return node;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename InputIt>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::build_sequence(InputIt &first, size_t size, uint64_t depth,
+                                                                          uint64_t red_depth, Allocator<Node> &alloc) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    // Left subtree takes the keys before the middle one, as in build
+    size_t left_size = size / 2;
+    Node *left = build_sequence(first, left_size, depth + 1, red_depth, alloc);
+    Node *node = alloc.create(*first);
+    ++first;
+    trace_create(node);
+    Node *right = build_sequence(first, size - left_size - 1, depth + 1, red_depth, alloc);
+    link_childs(node, left, right);
+    update_size(node);
+    color_built(node, depth, red_depth);
+    return node;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename InputIt>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::assign_sequence(InputIt first, size_t size) {
+    clear();
+    set_root(make_root(build_sequence(first, size, 0, build_red_depth(size), m_alloc)));
+    m_size = size;
+
+    dump_to_graphviz();
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+template <typename RandomIt>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::parallel_build(RandomIt first, RandomIt last,
+                                                                          size_t grain, Allocator<Node> &alloc) {
+    if (static_cast<size_t>(last - first) <= grain) {
+        return build(first, last, alloc);
+    }
+
+    RandomIt middle = first + (last - first) / 2;
+    Node *left_subroot = nullptr;
+    Node *right_subroot = nullptr;
+    // Allocators are not thread safe, so the forked half uses its own one
+    Allocator<Node> left_alloc;
+    fork_join([&] { left_subroot = parallel_build(first, middle, grain, left_alloc); },
+              [&] { right_subroot = parallel_build(middle + 1, last, grain, alloc); });
+    alloc.adopt(left_alloc);
+
+    return join(left_subroot, alloc.create(*middle), right_subroot);
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+NodeT *RedBlackTree<KeyT, Comparator, Allocator, NodeT>::make_root(Node *subroot) {
+    if (!subroot) {
+        return nullptr;
+    }
+
+    subroot->set_parent(nullptr);
+    subroot->set_side(Side::None);
+    if (is_red(subroot)) {
+        recolor(subroot, Color::Black);
+        subroot->set_height(subroot->get_height() + 1);
+    }
+    return subroot;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+uint64_t RedBlackTree<KeyT, Comparator, Allocator, NodeT>::get_black_height(Node *node) {
     if (!node) {
         return 0;
     } else {
@@ -576,8 +1955,8 @@ uint64_t RedBlackTree<KeyT, Comparator>::get_black_height(Node *node) {
     }
 }
 
-template <typename KeyT, typename Comparator>
-bool RedBlackTree<KeyT, Comparator>::is_red(Node *node) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+bool RedBlackTree<KeyT, Comparator, Allocator, NodeT>::is_red(Node *node) {
     if (!node) {
         return false;
     } else {
@@ -585,8 +1964,8 @@ bool RedBlackTree<KeyT, Comparator>::is_red(Node *node) {
     }
 }
 
-template <typename KeyT, typename Comparator>
-bool RedBlackTree<KeyT, Comparator>::is_black(Node *node) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+bool RedBlackTree<KeyT, Comparator, Allocator, NodeT>::is_black(Node *node) {
     if (!node) {
         return true;
     } else {
@@ -594,9 +1973,13 @@ bool RedBlackTree<KeyT, Comparator>::is_black(Node *node) {
     }
 }
 
-template <typename KeyT, typename Comparator>
-RedBlackTree<KeyT, Comparator>::RedBlackTree(const RedBlackTree &rhs) {
-    m_root = new Node(rhs.m_root);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::RedBlackTree(const RedBlackTree &rhs) {
+    if (!rhs.m_root) {
+        return;
+    }
+
+    m_root = m_alloc.create(rhs.m_root);
     m_root->set_side(Side::None);
     m_size = rhs.m_size;
 
@@ -607,7 +1990,7 @@ RedBlackTree<KeyT, Comparator>::RedBlackTree(const RedBlackTree &rhs) {
         if (curr->get_left() == nullptr && rhs_curr->get_left()) {
             Node *parent = curr;
             Node *rhs_left = rhs_curr->get_left();
-            Node *curr_left = new Node(rhs_left);
+            Node *curr_left = m_alloc.create(rhs_left);
 
             rhs_curr = rhs_left;
             curr->set_left(curr_left);
@@ -617,7 +2000,7 @@ RedBlackTree<KeyT, Comparator>::RedBlackTree(const RedBlackTree &rhs) {
         } else if (curr->get_right() == nullptr && rhs_curr->get_right()) {
             Node *parent = curr;
             Node *rhs_right = rhs_curr->get_right();
-            Node *curr_right = new Node(rhs_right);
+            Node *curr_right = m_alloc.create(rhs_right);
 
             rhs_curr = rhs_right;
             curr->set_right(curr_right);
@@ -637,30 +2020,50 @@ RedBlackTree<KeyT, Comparator>::RedBlackTree(const RedBlackTree &rhs) {
     dump_to_graphviz();
 }
 
-template <typename KeyT, typename Comparator>
-RedBlackTree<KeyT, Comparator>::RedBlackTree(RedBlackTree &&rhs) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::RedBlackTree(RedBlackTree &&rhs) {
     std::swap(m_root, rhs.m_root);
-    std::swap(m_root, rhs.m_size);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_finger, rhs.m_finger);
+    std::swap(m_alloc, rhs.m_alloc);
 }
 
-template <typename KeyT, typename Comparator>
-RedBlackTree<KeyT, Comparator> &RedBlackTree<KeyT, Comparator>::operator=(const RedBlackTree &rhs) {
-    RedBlackTree<KeyT, Comparator> temp(rhs);
-    *this = std::move(rhs);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT> &RedBlackTree<KeyT, Comparator, Allocator, NodeT>::operator=(const RedBlackTree &rhs) {
+    RedBlackTree<KeyT, Comparator, Allocator, NodeT> temp(rhs);
+    *this = std::move(temp);
 
     return *this;
 }
 
-template <typename KeyT, typename Comparator>
-RedBlackTree<KeyT, Comparator> &RedBlackTree<KeyT, Comparator>::operator=(RedBlackTree &&rhs) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT> &RedBlackTree<KeyT, Comparator, Allocator, NodeT>::operator=(RedBlackTree &&rhs) {
     std::swap(m_root, rhs.m_root);
-    std::swap(m_root, rhs.m_size);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_finger, rhs.m_finger);
+    std::swap(m_alloc, rhs.m_alloc);
 
     return *this;
 }
 
-template <typename KeyT, typename Comparator>
-RedBlackTree<KeyT, Comparator>::~RedBlackTree() {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+RedBlackTree<KeyT, Comparator, Allocator, NodeT>::~RedBlackTree() {
+    clear();
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::clear() {
+    // Nodes of the trivially destructible keys are freed together with the arena, unless other trees share it
+    if constexpr (Allocator<Node>::bulk_release && std::is_trivially_destructible_v<KeyT>) {
+        if (m_alloc.owns_arena()) {
+            set_root(nullptr);
+            m_size = 0;
+            m_finger = nullptr;
+            m_alloc = Allocator<Node>();
+            return;
+        }
+    }
+
     Node *curr_node = m_root;
 
     while (curr_node) {
@@ -670,54 +2073,70 @@ RedBlackTree<KeyT, Comparator>::~RedBlackTree() {
             curr_node = curr_node->get_right();
         } else {
             if (curr_node == m_root) {
-                delete curr_node;
+                m_alloc.destroy(curr_node);
                 break;
             } else {
                 Node *parent = curr_node->get_parent();
                 if (parent->get_right() == curr_node) {
-                    parent->set_right(nullptr);
+                    link(parent, nullptr, Side::Right);
                 } else if (parent->get_left() == curr_node) {
-                    parent->set_left(nullptr);
+                    link(parent, nullptr, Side::Left);
                 }
 
-                delete curr_node;
+                m_alloc.destroy(curr_node);
                 curr_node = parent;
             }
         }
     }
+
+    set_root(nullptr);
+    m_size = 0;
+    m_finger = nullptr;
+}
+
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::enable_log() {
+#ifdef TASK1_TRACE
+    m_recorder = std::make_unique<TraceRecorder>(m_log_name + ".trace");
+    trace_subtree(m_root);
+    trace(TraceEvent::Type::Root, m_root);
+    dump_to_graphviz();
+#endif
 }
 
-template<typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::dump_to_graphviz() {
-    dump_to_graphviz(m_root);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::disable_log() {
+#ifdef TASK1_TRACE
+    m_recorder.reset();
+#endif
 }
 
-template<typename KeyT, typename Comparator>
-void RedBlackTree<KeyT, Comparator>::dump_to_graphviz(Node *sub_root) {
-    if (!m_log) {
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::set_log_name([[maybe_unused]] const std::string &log_name) {
+#ifdef TASK1_TRACE
+    if (!m_recorder || log_name == m_log_name) {
+        m_log_name = log_name;
         return;
     }
+    // Trace under the old name holds only the state, that the new trace starts with, so it is dropped
+    m_recorder.reset();
+    std::remove((m_log_name + ".trace").c_str());
+    m_log_name = log_name;
+    enable_log();
+#endif
+}
 
-    std::string log_num = m_log_name + std::to_string(m_log_cnt);
-    std::string graphviz_name(log_num + ".dot");
-    std::string picture_name(log_num + ".png");
-    std::ofstream log(graphviz_name);
-
-    log << "strict graph {\n"
-        << "\trankdir = TB\n"
-        << "\t\"info\" [shape = \"record\", style = \"filled\", fillcolor = \"grey\", label = \"{size = "
-        << m_size << "|anchor = "
-        << m_root << "}\"]\n";
-
-    uint64_t counter = 1;
-    if (sub_root) {
-        sub_root->dump_to_graphviz(counter, log);
+template <typename KeyT, typename Comparator, template <typename> class Allocator, typename NodeT>
+void RedBlackTree<KeyT, Comparator, Allocator, NodeT>::trace_subtree(Node *subroot) {
+    if (!tracing() || !subroot) {
+        return;
     }
 
-    log << '}';
-    std::string src("dot -Tpng " + graphviz_name + " -o " + picture_name);
-    log.close();
-    m_log_cnt += 1;
-    std::system(src.c_str());
+    trace_create(subroot);
+    trace(TraceEvent::Type::Recolor, subroot, nullptr, subroot->get_color() == Color::Black);
+    for (Side side : {Side::Left, Side::Right}) {
+        trace_subtree(subroot->get_child(side));
+        trace(TraceEvent::Type::Link, subroot, subroot->get_child(side), side == Side::Right);
+    }
 }
 } //namespace Task1
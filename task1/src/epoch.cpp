@@ -0,0 +1,91 @@
+#include "epoch.hpp"
+
+#include <algorithm>
+
+namespace Task1 {
+
+EpochDomain::~EpochDomain() {
+    for (auto &retired : m_retired) {
+        retired.m_deleter(retired.m_object);
+    }
+}
+
+EpochDomain &EpochDomain::instance() {
+    static EpochDomain domain;
+    return domain;
+}
+
+EpochDomain::Record &EpochDomain::own_record() {
+    // Releases record of the thread, when thread exits
+    struct RecordOwner {
+        Record *m_record = nullptr;
+
+        ~RecordOwner() {
+            if (m_record) {
+                std::lock_guard<std::mutex> lock(instance().m_mutex);
+                m_record->m_used = false;
+            }
+        }
+    };
+
+    thread_local Record *record = nullptr;
+    thread_local RecordOwner owner;
+    if (record) {
+        return *record;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto free_record = std::find_if(m_records.begin(), m_records.end(), [](Record &rec) { return !rec.m_used; });
+    record = free_record != m_records.end() ? &*free_record : &m_records.emplace_back();
+    record->m_used = true;
+    owner.m_record = record;
+    return *record;
+}
+
+EpochDomain::Guard::Guard() : m_record(&EpochDomain::instance().own_record()) {
+    if (m_record->m_depth++ == 0) {
+        // Sequentially consistent store orders it before the loads of the shared objects,
+        // so writer either sees the pinned epoch or the reader sees already unlinked objects
+        m_record->m_epoch.store(EpochDomain::instance().m_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+    }
+}
+
+EpochDomain::Guard::~Guard() {
+    if (--m_record->m_depth == 0) {
+        m_record->m_epoch.store(0, std::memory_order_release);
+    }
+}
+
+void EpochDomain::retire(void *object, void (*deleter)(void *)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Readers, pinned after this point, get a later epoch and can't reach the object
+    uint64_t epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    m_retired.push_back({epoch, object, deleter});
+    if (m_retired.size() >= EpochReclaimThreshold) {
+        reclaim_locked();
+    }
+}
+
+void EpochDomain::reclaim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    reclaim_locked();
+}
+
+void EpochDomain::reclaim_locked() {
+    uint64_t min_epoch = UINT64_MAX;
+    for (auto &record : m_records) {
+        uint64_t epoch = record.m_epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0) {
+            min_epoch = std::min(min_epoch, epoch);
+        }
+    }
+
+    auto alive = std::partition(m_retired.begin(), m_retired.end(),
+                                [min_epoch](const Retired &retired) { return retired.m_epoch >= min_epoch; });
+    for (auto it = alive; it != m_retired.end(); ++it) {
+        it->m_deleter(it->m_object);
+    }
+    m_retired.erase(alive, m_retired.end());
+}
+
+} // namespace Task1
@@ -0,0 +1,68 @@
+#include "image.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace Task1 {
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    bool mapped = false;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // Image is read through once right after the mapping, so it is read ahead in large chunks
+            ::madvise(data, info.st_size, MADV_WILLNEED);
+            m_data = static_cast<const std::byte *>(data);
+            m_size = info.st_size;
+            mapped = true;
+        }
+    }
+    // Mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return mapped;
+}
+
+void MappedFile::close() {
+    if (m_data) {
+        ::munmap(const_cast<std::byte *>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const ImageHeader *map_image(MappedFile &file, const std::string &path, size_t key_size, size_t node_size) {
+    if (!file.open(path) || file.size() < sizeof(ImageHeader)) {
+        return nullptr;
+    }
+
+    const ImageHeader *header = reinterpret_cast<const ImageHeader *>(file.data());
+    bool valid = std::memcmp(header->m_magic, ImageMagic, sizeof(ImageMagic)) == 0 &&
+                 header->m_key_size == key_size && header->m_node_size == node_size &&
+                 header->m_size < NoImageNode && file.size() == sizeof(ImageHeader) + header->m_size * node_size;
+    return valid ? header : nullptr;
+}
+
+} // namespace Task1
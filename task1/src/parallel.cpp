@@ -0,0 +1,143 @@
+#include "parallel.hpp"
+
+namespace Task1 {
+
+namespace {
+// Index of the deque of the current thread, threads outside the pool share the last one
+thread_local size_t thread_deque = SIZE_MAX;
+// Deque, from which the current thread starts the next steal
+thread_local size_t thread_victim = 0;
+} // namespace
+
+TaskPool::TaskPool(size_t threads) {
+    for (size_t i = 0; i <= threads; ++i) {
+        m_deques.push_back(std::make_unique<Deque>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_all();
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+TaskPool &TaskPool::instance() {
+    static TaskPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+TaskPool::Deque &TaskPool::own_deque() {
+    if (thread_deque == SIZE_MAX) {
+        return *m_deques.back();
+    }
+    return *m_deques[thread_deque];
+}
+
+TaskPool::Task *TaskPool::pop(Deque &deque) {
+    std::lock_guard<std::mutex> lock(deque.m_mutex);
+    if (deque.m_tasks.empty()) {
+        return nullptr;
+    }
+
+    Task *task = deque.m_tasks.back();
+    deque.m_tasks.pop_back();
+    m_pending -= 1;
+    return task;
+}
+
+TaskPool::Task *TaskPool::steal() {
+    if (m_pending == 0) {
+        return nullptr;
+    }
+
+    size_t start = thread_victim++;
+    for (size_t i = 0; i < m_deques.size(); ++i) {
+        Deque &deque = *m_deques[(start + i) % m_deques.size()];
+        std::lock_guard<std::mutex> lock(deque.m_mutex);
+        if (!deque.m_tasks.empty()) {
+            Task *task = deque.m_tasks.front();
+            deque.m_tasks.pop_front();
+            m_pending -= 1;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void TaskPool::run(Task *task) {
+    // Exception can't leave the worker thread, and waiter sleeps until the task is done
+    try {
+        task->m_func();
+    } catch (...) {
+        task->m_exception = std::current_exception();
+    }
+    // Waiter counts itself before it checks the task, so either it sees the task done or it is woken up
+    task->m_done = true;
+    if (m_waiting > 0) {
+        std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+        m_wakeup.notify_all();
+    }
+}
+
+void TaskPool::push(Task *task) {
+    Deque &deque = own_deque();
+    {
+        std::lock_guard<std::mutex> lock(deque.m_mutex);
+        deque.m_tasks.push_back(task);
+        m_pending += 1;
+    }
+
+    if (!m_threads.empty() || m_waiting > 0) {
+        std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+        m_wakeup.notify_one();
+    }
+}
+
+void TaskPool::wait(Task *task) {
+    Deque &deque = own_deque();
+    size_t spins = 0;
+    while (!task->m_done) {
+        Task *other = pop(deque);
+        if (!other) {
+            other = steal();
+        }
+
+        if (other) {
+            run(other);
+            spins = 0;
+        } else if (spins < WaitSpins) {
+            spins += 1;
+            std::this_thread::yield();
+        } else {
+            // Task is run by the other thread, and there is nothing to help with
+            std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+            m_waiting += 1;
+            m_wakeup.wait(lock, [this, task] { return task->m_done || m_pending > 0; });
+            m_waiting -= 1;
+            spins = 0;
+        }
+    }
+}
+
+void TaskPool::worker_loop(size_t index) {
+    thread_deque = index;
+    while (!m_stop) {
+        Task *task = steal();
+        if (task) {
+            run(task);
+        } else {
+            std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+            m_wakeup.wait(lock, [this] { return m_stop || m_pending > 0; });
+        }
+    }
+}
+
+} // namespace Task1
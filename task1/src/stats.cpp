@@ -0,0 +1,104 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Task1 {
+
+namespace {
+// Counters of all threads, that ever counted anything
+struct StatsRegistry {
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadStats>> m_threads;
+    // Counters of the exited threads
+    std::vector<ThreadStats *> m_free;
+};
+
+// Registry is never destroyed, so that trees, destroyed at exit, still count
+StatsRegistry &registry() {
+    static StatsRegistry *registry = new StatsRegistry();
+    return *registry;
+}
+
+// Thread, that has released its counters, takes new ones, if it counts anything while its thread locals are destroyed
+thread_local bool thread_exited = false;
+
+// Hands counters of the exiting thread over to the next new thread
+struct ThreadStatsRelease {
+    ~ThreadStatsRelease() {
+        StatsRegistry &stats_registry = registry();
+        std::lock_guard<std::mutex> lock(stats_registry.m_mutex);
+        stats_registry.m_free.push_back(thread_stats);
+        thread_stats = nullptr;
+        thread_exited = true;
+    }
+};
+} // namespace
+
+ThreadStats &acquire_thread_stats() {
+    {
+        StatsRegistry &stats_registry = registry();
+        std::lock_guard<std::mutex> lock(stats_registry.m_mutex);
+        if (!stats_registry.m_free.empty() && !thread_exited) {
+            thread_stats = stats_registry.m_free.back();
+            stats_registry.m_free.pop_back();
+        } else {
+            stats_registry.m_threads.push_back(std::make_unique<ThreadStats>());
+            thread_stats = stats_registry.m_threads.back().get();
+        }
+    }
+    if (!thread_exited) {
+        thread_local ThreadStatsRelease release;
+    }
+    return *thread_stats;
+}
+
+TreeStats TreeStats::operator-(const TreeStats &earlier) const {
+    TreeStats delta = *this;
+    delta.m_comparisons -= earlier.m_comparisons;
+    delta.m_rotations -= earlier.m_rotations;
+    delta.m_recolors -= earlier.m_recolors;
+    delta.m_insert_fixups -= earlier.m_insert_fixups;
+    delta.m_erase_fixups -= earlier.m_erase_fixups;
+    return delta;
+}
+
+std::ostream &operator<<(std::ostream &out, const TreeStats &stats) {
+    return out << "comparisons " << stats.m_comparisons << ", rotations " << stats.m_rotations << ", recolors "
+               << stats.m_recolors << ", insert fixups " << stats.m_insert_fixups << ", erase fixups "
+               << stats.m_erase_fixups << ", join depth " << stats.m_join_depth << ", split depth "
+               << stats.m_split_depth << ", live nodes " << stats.m_live_nodes << ", allocated bytes "
+               << stats.m_allocated_bytes;
+}
+
+void ThreadStats::collect(TreeStats &stats) const {
+    auto counter = [this](StatsCounter counter) {
+        return m_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    };
+    auto max_depth = [this](StatsRecursion recursion) {
+        return m_max_depths[static_cast<size_t>(recursion)].load(std::memory_order_relaxed);
+    };
+    stats.m_comparisons += counter(StatsCounter::Comparisons);
+    stats.m_rotations += counter(StatsCounter::Rotations);
+    stats.m_recolors += counter(StatsCounter::Recolors);
+    stats.m_insert_fixups += counter(StatsCounter::InsertFixups);
+    stats.m_erase_fixups += counter(StatsCounter::EraseFixups);
+    stats.m_join_depth = std::max(stats.m_join_depth, max_depth(StatsRecursion::Join));
+    stats.m_split_depth = std::max(stats.m_split_depth, max_depth(StatsRecursion::Split));
+    stats.m_live_nodes += counter(StatsCounter::LiveNodes);
+    stats.m_allocated_bytes += counter(StatsCounter::AllocatedBytes);
+}
+
+TreeStats stats() {
+    StatsRegistry &stats_registry = registry();
+    std::lock_guard<std::mutex> lock(stats_registry.m_mutex);
+    TreeStats snapshot;
+    for (const auto &thread : stats_registry.m_threads) {
+        thread->collect(snapshot);
+    }
+    return snapshot;
+}
+
+} // namespace Task1
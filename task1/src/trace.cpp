@@ -0,0 +1,218 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+namespace Task1 {
+
+namespace {
+// Magic bytes in the beginning of the trace file, followed by the events
+constexpr char TraceMagic[8] = {'R', 'B', 'T', 'R', 'A', 'C', 'E', '1'};
+// Maximal number of events, written by the single write call
+constexpr size_t TraceWriteBatch = 4096;
+// Writer sleeps for this time, when buffer is empty
+constexpr std::chrono::microseconds TraceIdleSleep{100};
+} // namespace
+
+TraceRecorder::TraceRecorder(const std::string &path, size_t capacity)
+    : m_slots(new Slot[capacity]), m_mask(capacity - 1), m_file(std::fopen(path.c_str(), "wb")) {
+    for (size_t i = 0; i < capacity; ++i) {
+        m_slots[i].m_sequence.store(i, std::memory_order_relaxed);
+    }
+    if (!m_file) {
+        return;
+    }
+    std::fwrite(TraceMagic, 1, sizeof(TraceMagic), m_file);
+    m_writer = std::thread([this] { write_loop(); });
+}
+
+TraceRecorder::~TraceRecorder() {
+    if (!m_file) {
+        return;
+    }
+    m_stop.store(true, std::memory_order_release);
+    m_writer.join();
+    std::fclose(m_file);
+}
+
+void TraceRecorder::record(const TraceEvent &event) {
+    if (!m_file) {
+        return;
+    }
+
+    uint64_t position = m_head.load(std::memory_order_relaxed);
+    Slot *slot = nullptr;
+    while (true) {
+        slot = &m_slots[position & m_mask];
+        uint64_t sequence = slot->m_sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            // Slot is free for this position, claim it
+            if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (sequence < position) {
+            // Buffer is full, wait for the writer
+            std::this_thread::yield();
+            position = m_head.load(std::memory_order_relaxed);
+        } else {
+            // Other producer has claimed the position
+            position = m_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->m_event = event;
+    slot->m_sequence.store(position + 1, std::memory_order_release);
+}
+
+void TraceRecorder::flush() {
+    uint64_t recorded = m_head.load(std::memory_order_acquire);
+    while (m_file && m_written.load(std::memory_order_acquire) < recorded) {
+        std::this_thread::yield();
+    }
+    if (m_file) {
+        std::fflush(m_file);
+    }
+}
+
+void TraceRecorder::write_loop() {
+    std::vector<TraceEvent> batch;
+    batch.reserve(TraceWriteBatch);
+    uint64_t tail = 0;
+
+    while (true) {
+        // Stop is checked before draining, so events, recorded before the stop, are still written
+        bool stop = m_stop.load(std::memory_order_acquire);
+        while (batch.size() < TraceWriteBatch) {
+            Slot &slot = m_slots[tail & m_mask];
+            if (slot.m_sequence.load(std::memory_order_acquire) != tail + 1) {
+                break;
+            }
+            batch.push_back(slot.m_event);
+            // Slot becomes free for the position one lap later
+            slot.m_sequence.store(tail + m_mask + 1, std::memory_order_release);
+            tail += 1;
+        }
+
+        if (!batch.empty()) {
+            std::fwrite(batch.data(), sizeof(TraceEvent), batch.size(), m_file);
+            m_written.store(tail, std::memory_order_release);
+            batch.clear();
+        } else if (stop) {
+            return;
+        } else {
+            std::this_thread::sleep_for(TraceIdleSleep);
+        }
+    }
+}
+
+bool TraceReplay::load(const std::string &path) {
+    m_events.clear();
+    m_frames.clear();
+    m_nodes.clear();
+    m_root = 0;
+    m_applied = 0;
+
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    char magic[sizeof(TraceMagic)];
+    bool valid = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                 std::memcmp(magic, TraceMagic, sizeof(magic)) == 0;
+    TraceEvent event;
+    while (valid && std::fread(&event, sizeof(event), 1, file) == 1) {
+        if (event.m_type == TraceEvent::Type::Frame) {
+            m_frames.push_back(m_events.size());
+        }
+        m_events.push_back(event);
+    }
+    std::fclose(file);
+    return valid;
+}
+
+void TraceReplay::apply(const TraceEvent &event) {
+    switch (event.m_type) {
+    case TraceEvent::Type::Create:
+        m_nodes[event.m_node] = Node{event.m_key, event.m_arg != 0};
+        break;
+    case TraceEvent::Type::Destroy:
+        m_nodes.erase(event.m_node);
+        break;
+    case TraceEvent::Type::Link:
+        // Side is read from the file, links to other sides are dropped
+        if (event.m_arg < 2) {
+            m_nodes[event.m_node].m_links[event.m_arg] = event.m_other;
+        }
+        break;
+    case TraceEvent::Type::Root:
+        m_root = event.m_node;
+        break;
+    case TraceEvent::Type::Recolor:
+        m_nodes[event.m_node].m_black = event.m_arg != 0;
+        break;
+    case TraceEvent::Type::MoveKey: {
+        Node &node = m_nodes[event.m_node];
+        node.m_key = event.m_key;
+        node.m_has_key = true;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void TraceReplay::render(size_t frame, std::ostream &out) {
+    if (frame >= m_frames.size()) {
+        return;
+    }
+    if (m_applied > m_frames[frame]) {
+        m_nodes.clear();
+        m_root = 0;
+        m_applied = 0;
+    }
+    for (; m_applied <= m_frames[frame]; ++m_applied) {
+        apply(m_events[m_applied]);
+    }
+
+    out << "strict graph {\n"
+        << "\trankdir = TB\n"
+        << "\t\"info\" [shape = \"record\", style = \"filled\", fillcolor = \"grey\", label = \"{frame = " << frame
+        << "|event = " << m_frames[frame] << "}\"]\n";
+    if (m_root) {
+        render_nodes(m_root, out);
+    }
+    out << "}\n";
+}
+
+void TraceReplay::render_nodes(uint64_t root, std::ostream &out) {
+    // Links are read from the file, so the walk is iterative and visits every node once
+    std::unordered_set<uint64_t> visited{root};
+    std::vector<uint64_t> stack{root};
+    while (!stack.empty()) {
+        uint64_t id = stack.back();
+        stack.pop_back();
+        const Node &node = m_nodes[id];
+        out << "\t\"node" << id << "\" [shape = \"circle\", style = \"filled\", fillcolor = \""
+            << (node.m_black ? "Grey" : "Red") << "\", label = \"";
+        if (node.m_has_key) {
+            out << node.m_key;
+        } else {
+            out << "nil";
+        }
+        out << "\"]\n";
+
+        for (uint64_t child : node.m_links) {
+            if (child) {
+                out << "\t\"node" << id << "\" -- \"node" << child << "\"\n";
+                if (visited.insert(child).second) {
+                    stack.push_back(child);
+                }
+            }
+        }
+    }
+}
+
+} // namespace Task1
@@ -0,0 +1,43 @@
+#include "trace.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Render frames of the binary trace to graphviz files <prefix><frame>.dot
+// Usage: trace_replay <trace file> <output prefix> [frame ...], all frames are rendered by default
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <trace file> <output prefix> [frame ...]\n";
+        return 1;
+    }
+
+    Task1::TraceReplay replay;
+    if (!replay.load(argv[1])) {
+        std::cerr << argv[1] << " is not a valid trace\n";
+        return 1;
+    }
+    std::cout << replay.events().size() << " events, " << replay.frames() << " frames\n";
+
+    std::vector<size_t> frames;
+    for (int i = 3; i < argc; ++i) {
+        frames.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (frames.empty()) {
+        for (size_t frame = 0; frame < replay.frames(); ++frame) {
+            frames.push_back(frame);
+        }
+    }
+
+    std::string prefix = argv[2];
+    for (size_t frame : frames) {
+        if (frame >= replay.frames()) {
+            std::cerr << "No frame " << frame << '\n';
+            continue;
+        }
+        std::ofstream out(prefix + std::to_string(frame) + ".dot");
+        replay.render(frame, out);
+    }
+}
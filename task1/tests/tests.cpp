@@ -0,0 +1,1952 @@
+#include "concurrent_tree.hpp"
+#include "indexed_tree.hpp"
+#include "interval_tree.hpp"
+#include "map.hpp"
+#include "multiset.hpp"
+#include "persistent_tree.hpp"
+#include "sharded_tree.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <list>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+using namespace Task1;
+
+namespace Tests {
+
+// Does the tree check its invariants with validate()
+template <typename TreeT, typename = void> struct HasValidate : std::false_type {};
+template <typename TreeT>
+struct HasValidate<TreeT, std::void_t<decltype(std::declval<const TreeT &>().validate())>> : std::true_type {};
+
+template <typename TreeT>
+void expect_same_keys(const TreeT &tree, const std::multiset<int> &expected, int max_key) {
+    EXPECT_EQ(tree.size(), expected.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+    for (int key = 0; key < max_key; ++key) {
+        EXPECT_EQ(tree.contains(key), expected.count(key) != 0) << "key = " << key;
+    }
+}
+
+template <typename TreeT> void random_insert_erase_test(int max_key) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, max_key - 1);
+
+    TreeT tree;
+    std::multiset<int> expected;
+
+    for (int i = 0; i < 2000; ++i) {
+        int key = key_dist(rng);
+        if (rng() % 3 == 0) {
+            tree.erase(key);
+            auto it = expected.find(key);
+            if (it != expected.end()) {
+                expected.erase(it);
+            }
+        } else {
+            tree.insert(key);
+            expected.insert(key);
+        }
+        if constexpr (HasValidate<TreeT>::value) {
+            ASSERT_TRUE(tree.validate()) << "i = " << i;
+        }
+    }
+
+    expect_same_keys(tree, expected, max_key);
+}
+
+TEST(RedBlackTree_tests, basic_test) {
+    RedBlackTree<int> tree;
+    std::vector vec{-14, 0, 3, 5, 11, 20, 21, 28, 42, 60};
+
+    for (auto &elem : vec) {
+        tree.insert(elem);
+    }
+    int num0 = 0;
+    tree.erase(num0);
+
+    EXPECT_EQ(tree.size(), vec.size() - 1);
+    EXPECT_FALSE(tree.contains(num0));
+    int num42 = 42;
+    EXPECT_TRUE(tree.contains(num42));
+}
+
+TEST(RedBlackTree_tests, random_test) { random_insert_erase_test<RedBlackTree<int>>(500); }
+
+TEST(RedBlackTree_tests, split_merge_test) {
+    RedBlackTree<int> tree;
+    RedBlackTree<int> other;
+    std::multiset<int> expected;
+    for (int key = 0; key < 300; ++key) {
+        key % 2 ? tree.insert(key) : other.insert(key);
+        expected.insert(key);
+    }
+
+    tree.merge(other);
+    ASSERT_TRUE(tree.validate());
+    expect_same_keys(tree, expected, 300);
+    EXPECT_TRUE(other.empty());
+
+    auto [left, right] = tree.split(100);
+    EXPECT_TRUE(tree.empty());
+    ASSERT_TRUE(left.validate());
+    ASSERT_TRUE(right.validate());
+    expect_same_keys(left, std::multiset<int>(expected.begin(), expected.find(100)), 300);
+    expect_same_keys(right, std::multiset<int>(expected.find(100), expected.end()), 300);
+}
+
+TEST(RedBlackTree_tests, split_duplicates_test) {
+    // Copies of the key are spread over the tree, so some of them are in the subtrees of the others
+    std::mt19937 rng(42);
+    std::vector<int> keys(3000);
+    std::generate(keys.begin(), keys.end(), [&rng] { return rng() % 30; });
+    for (int bound : {-1, 0, 7, 15, 29, 30}) {
+        RedBlackTree<int> tree;
+        for (int key : keys) {
+            tree.insert(key);
+        }
+        std::multiset<int> expected(keys.begin(), keys.end());
+        auto [left, right] = tree.split(bound);
+        EXPECT_TRUE(left.validate());
+        EXPECT_TRUE(right.validate());
+        expect_same_keys(left, std::multiset<int>(expected.begin(), expected.lower_bound(bound)), 30);
+        expect_same_keys(right, std::multiset<int>(expected.lower_bound(bound), expected.end()), 30);
+    }
+}
+
+TEST(RedBlackTree_tests, join_test) {
+    for (int size : {0, 1, 10, 1000}) {
+        for (int left_size : {0, size / 3, size}) {
+            std::vector<int> keys(size);
+            std::iota(keys.begin(), keys.end(), 0);
+            RedBlackTree<int> left(keys.begin(), keys.begin() + left_size);
+            RedBlackTree<int> right(keys.begin() + left_size, keys.end());
+            left.join(right);
+
+            EXPECT_TRUE(right.empty());
+            expect_same_keys(left, std::multiset<int>(keys.begin(), keys.end()), size);
+            left.insert(size / 2);
+            EXPECT_EQ(left.rank(size / 2), size / 2);
+        }
+    }
+}
+
+template <typename TreeT> void range_erase_test() {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, 300);
+    std::vector<int> keys(3000);
+    std::generate(keys.begin(), keys.end(), [&] { return key_dist(rng); });
+    TreeT tree(keys.begin(), keys.end());
+    std::multiset<int> expected(keys.begin(), keys.end());
+
+    for (int round = 0; round < 40; ++round) {
+        int low = key_dist(rng);
+        int high = low + key_dist(rng) / 10 - 5;
+        auto first = expected.lower_bound(low);
+        auto last = low <= high ? expected.upper_bound(high) : first;
+        std::multiset<int> range(first, last);
+        expected.erase(first, last);
+        if (round % 2) {
+            EXPECT_EQ(tree.erase_range(low, high), range.size());
+        } else {
+            TreeT extracted = tree.extract_range(low, high);
+            EXPECT_TRUE(extracted.validate());
+            expect_same_keys(extracted, range, 0);
+        }
+        ASSERT_TRUE(tree.validate()) << low << ' ' << high;
+        expect_same_keys(tree, expected, 301);
+
+        // Tree stays usable after the cut, finger is reset
+        int key = key_dist(rng);
+        tree.insert(key);
+        expected.insert(key);
+    }
+    EXPECT_EQ(tree.erase_range(0, 300), expected.size());
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.erase_range(0, 300), 0);
+}
+
+TEST(RedBlackTree_tests, range_erase_test) {
+    range_erase_test<RedBlackTree<int>>();
+    range_erase_test<RedBlackTree<int, std::less<int>, PoolAllocator>>();
+}
+
+TEST(RedBlackTree_tests, copy_test) {
+    RedBlackTree<int> tree;
+    std::multiset<int> expected;
+    for (int key = 0; key < 100; key += 3) {
+        tree.insert(key);
+        expected.insert(key);
+    }
+
+    RedBlackTree<int> copy(tree);
+    RedBlackTree<int> assigned;
+    assigned = copy;
+    tree.clear();
+
+    EXPECT_TRUE(tree.empty());
+    expect_same_keys(copy, expected, 100);
+    expect_same_keys(assigned, expected, 100);
+}
+
+TEST(RedBlackTree_tests, range_constructor_test) {
+    std::mt19937 rng(42);
+    std::vector<int> keys(1000);
+    for (auto &key : keys) {
+        key = rng() % 2000;
+    }
+    std::multiset<int> expected(keys.begin(), keys.end());
+
+    RedBlackTree<int> unsorted(keys.begin(), keys.end());
+    expect_same_keys(unsorted, expected, 2000);
+
+    RedBlackTree<int> sorted(expected.begin(), expected.end());
+    expect_same_keys(sorted, expected, 2000);
+
+    for (int key = 0; key < 2000; key += 2) {
+        sorted.insert(key);
+        expected.insert(key);
+        int odd_key = key + 1;
+        sorted.erase(odd_key);
+        if (expected.count(odd_key)) {
+            expected.erase(expected.find(odd_key));
+        }
+    }
+    expect_same_keys(sorted, expected, 2000);
+}
+
+TEST(RedBlackTree_tests, parallel_assign_test) {
+    std::vector<int> keys(100000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = 2 * i;
+    }
+
+    RedBlackTree<int, std::less<int>, PoolAllocator> tree;
+    tree.assign(keys.begin(), keys.end(), Execution::Parallel);
+    EXPECT_EQ(tree.size(), keys.size());
+    for (int key = 0; key < 1000; ++key) {
+        EXPECT_EQ(tree.contains(key), key % 2 == 0);
+    }
+
+    auto [left, right] = tree.split(100000);
+    EXPECT_EQ(left.size(), 50000);
+    EXPECT_EQ(right.size(), 50000);
+}
+
+TEST(OrderStatistics_tests, random_test) {
+    std::mt19937 rng(42);
+    RedBlackTree<int> tree;
+    std::multiset<int> expected;
+    for (int i = 0; i < 3000; ++i) {
+        int key = rng() % 1000;
+        if (rng() % 3 == 0) {
+            tree.erase(key);
+            if (expected.count(key)) {
+                expected.erase(expected.find(key));
+            }
+        } else {
+            tree.insert(key);
+            expected.insert(key);
+        }
+        ASSERT_TRUE(tree.validate()) << "i = " << i;
+    }
+
+    std::vector<int> sorted(expected.begin(), expected.end());
+    for (size_t k = 0; k < sorted.size(); ++k) {
+        ASSERT_NE(tree.select(k), nullptr);
+        EXPECT_EQ(tree.select(k)->get_key(), sorted[k]);
+    }
+    EXPECT_EQ(tree.select(sorted.size()), nullptr);
+
+    for (int key = -1; key <= 1000; ++key) {
+        size_t less = std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+        EXPECT_EQ(tree.rank(key), less);
+        size_t in_range = std::upper_bound(sorted.begin(), sorted.end(), key + 10) - sorted.begin() - less;
+        EXPECT_EQ(tree.count_in_range(key, key + 10), in_range);
+    }
+    EXPECT_EQ(tree.count_in_range(10, 5), 0);
+}
+
+TEST(OrderStatistics_tests, split_join_test) {
+    std::vector<int> keys(10000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = i;
+    }
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+    RedBlackTree<int> other;
+    for (int key = 10000; key < 12000; key += 2) {
+        other.insert(key);
+    }
+
+    tree.union_with(other);
+    EXPECT_EQ(tree.size(), 11000);
+    EXPECT_EQ(tree.select(10500)->get_key(), 11000);
+    EXPECT_EQ(tree.rank(11000), 10500);
+
+    auto [left, right] = tree.split(5000);
+    EXPECT_EQ(left.size(), 5000);
+    EXPECT_EQ(right.size(), 6000);
+    EXPECT_EQ(right.select(0)->get_key(), 5000);
+    EXPECT_EQ(right.count_in_range(0, 9999), 5000);
+}
+
+TEST(Iterator_tests, iteration_test) {
+    std::vector<int> keys{5, 1, 9, 3, 7, 3, 11};
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<int> forward;
+    for (const auto &key : tree) {
+        forward.push_back(key);
+    }
+    EXPECT_EQ(forward, keys);
+
+    std::vector<int> backward;
+    for (auto it = tree.end(); it != tree.begin();) {
+        backward.push_back(*--it);
+    }
+    EXPECT_TRUE(std::equal(backward.rbegin(), backward.rend(), keys.begin(), keys.end()));
+
+    RedBlackTree<int> empty;
+    EXPECT_EQ(empty.begin(), empty.end());
+    EXPECT_EQ(--empty.end(), empty.end());
+    tree.clear();
+    EXPECT_EQ(std::prev(tree.end()), tree.end());
+}
+
+TEST(Iterator_tests, bounds_test) {
+    std::mt19937 rng(42);
+    std::multiset<int> expected;
+    for (int i = 0; i < 1000; ++i) {
+        expected.insert(rng() % 500);
+    }
+    RedBlackTree<int> tree(expected.begin(), expected.end());
+
+    for (int key = -1; key <= 500; ++key) {
+        EXPECT_EQ(std::distance(tree.begin(), tree.lower_bound(key)),
+                  std::distance(expected.begin(), expected.lower_bound(key)));
+        EXPECT_EQ(std::distance(tree.begin(), tree.upper_bound(key)),
+                  std::distance(expected.begin(), expected.upper_bound(key)));
+
+        auto [first, last] = tree.equal_range(key);
+        EXPECT_EQ(std::distance(first, last), expected.count(key));
+        for (; first != last; ++first) {
+            EXPECT_EQ(*first, key);
+        }
+    }
+}
+
+template <typename TreeOperation, typename SetOperation>
+void set_operation_test(TreeOperation tree_operation, SetOperation set_operation, Execution execution, int size) {
+    std::mt19937 rng(42);
+    std::set<int> first_keys;
+    std::set<int> second_keys;
+    for (int i = 0; i < size; ++i) {
+        first_keys.insert(rng() % (2 * size));
+        second_keys.insert(rng() % (2 * size));
+    }
+
+    RedBlackTree<int> first(first_keys.begin(), first_keys.end());
+    RedBlackTree<int> second(second_keys.begin(), second_keys.end());
+    tree_operation(first, second, execution);
+
+    std::multiset<int> expected;
+    set_operation(first_keys.begin(), first_keys.end(), second_keys.begin(), second_keys.end(),
+                  std::inserter(expected, expected.end()));
+    expect_same_keys(first, expected, 2 * size);
+    EXPECT_TRUE(second.empty());
+}
+
+TEST(SetOperations_tests, union_test) {
+    auto tree_union = [](auto &first, auto &second, Execution execution) { first.union_with(second, execution); };
+    auto set_union = [](auto... args) { return std::set_union(args...); };
+    set_operation_test(tree_union, set_union, Execution::Sequential, 1000);
+    set_operation_test(tree_union, set_union, Execution::Parallel, 100000);
+}
+
+TEST(SetOperations_tests, intersection_test) {
+    auto tree_intersection = [](auto &first, auto &second, Execution execution) {
+        first.intersect_with(second, execution);
+    };
+    auto set_intersection = [](auto... args) { return std::set_intersection(args...); };
+    set_operation_test(tree_intersection, set_intersection, Execution::Sequential, 1000);
+    set_operation_test(tree_intersection, set_intersection, Execution::Parallel, 100000);
+}
+
+TEST(SetOperations_tests, difference_test) {
+    auto tree_difference = [](auto &first, auto &second, Execution execution) {
+        first.difference_with(second, execution);
+    };
+    auto set_difference = [](auto... args) { return std::set_difference(args...); };
+    set_operation_test(tree_difference, set_difference, Execution::Sequential, 1000);
+    set_operation_test(tree_difference, set_difference, Execution::Parallel, 100000);
+}
+
+TEST(SetOperations_tests, symmetric_difference_test) {
+    auto tree_symmetric_difference = [](auto &first, auto &second, Execution execution) {
+        first.symmetric_difference(second, execution);
+    };
+    auto set_symmetric_difference = [](auto... args) { return std::set_symmetric_difference(args...); };
+    set_operation_test(tree_symmetric_difference, set_symmetric_difference, Execution::Sequential, 1000);
+    set_operation_test(tree_symmetric_difference, set_symmetric_difference, Execution::Parallel, 100000);
+}
+
+TEST(PoolAllocator_tests, random_test) {
+    random_insert_erase_test<RedBlackTree<int, std::less<int>, PoolAllocator>>(500);
+}
+
+TEST(PoolAllocator_tests, split_merge_test) {
+    using PoolTree = RedBlackTree<int, std::less<int>, PoolAllocator>;
+    std::multiset<int> expected;
+
+    PoolTree left_part;
+    {
+        PoolTree tree;
+        for (int key = 0; key < 1000; ++key) {
+            tree.insert(key);
+            expected.insert(key);
+        }
+        auto [left, right] = tree.split(500);
+        left_part = std::move(left);
+
+        // Nodes of the right part come from the arena of the left part
+        PoolTree other;
+        for (int key = 1000; key < 1200; ++key) {
+            other.insert(key);
+            expected.insert(key);
+        }
+        right.merge(other);
+        ASSERT_TRUE(right.validate());
+        left_part.merge(right);
+        ASSERT_TRUE(left_part.validate());
+    }
+
+    // Recycled slots are reused by the new nodes
+    for (int key = 0; key < 1000; key += 2) {
+        left_part.erase(key);
+        expected.erase(key);
+    }
+    for (int key = 1200; key < 1400; ++key) {
+        left_part.insert(key);
+        expected.insert(key);
+    }
+
+    ASSERT_TRUE(left_part.validate());
+    expect_same_keys(left_part, expected, 1400);
+}
+
+TEST(PoolAllocator_tests, shared_clear_test) {
+    using PoolTree = RedBlackTree<int, std::less<int>, PoolAllocator>;
+    TreeStats before = stats();
+    PoolTree kept;
+    for (int round = 0; round < 20; ++round) {
+        PoolTree tree;
+        for (int key = 0; key < 1000; ++key) {
+            tree.insert(key);
+        }
+        auto [left, right] = tree.split(500);
+        // Left part shares the arena with the kept tree, so clear frees its nodes one by one
+        kept.join(left);
+        kept.clear();
+        EXPECT_EQ(stats().m_live_nodes - before.m_live_nodes, right.size());
+    }
+    EXPECT_TRUE(kept.empty());
+    EXPECT_EQ(stats().m_live_nodes, before.m_live_nodes);
+}
+
+TEST(PoolAllocator_tests, string_test) {
+    RedBlackTree<std::string, std::less<std::string>, PoolAllocator> tree;
+    for (int key = 0; key < 100; ++key) {
+        tree.insert(std::to_string(key));
+    }
+    std::string num = "42";
+    tree.erase(num);
+
+    EXPECT_EQ(tree.size(), 99);
+    EXPECT_FALSE(tree.contains(num));
+}
+
+TEST(CompactTreeNode_tests, random_test) {
+    static_assert(sizeof(CompactTreeNode<int>) <= 32);
+    random_insert_erase_test<RedBlackTree<int, std::less<int>, NewDeleteAllocator, CompactTreeNode<int>>>(500);
+}
+
+TEST(CompactTreeNode_tests, split_union_test) {
+    using CompactTree = RedBlackTree<int, std::less<int>, PoolAllocator, CompactTreeNode<int>>;
+    std::vector<int> keys(5000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = 2 * i;
+    }
+    CompactTree tree(keys.begin(), keys.end());
+    CompactTree other;
+    for (int key = 1; key < 10000; key += 4) {
+        other.insert(key);
+    }
+
+    tree.union_with(other);
+    EXPECT_EQ(tree.size(), 7500);
+    EXPECT_EQ(tree.rank(5001), 3751);
+
+    auto [left, right] = tree.split(5001);
+    EXPECT_EQ(left.size(), 3751);
+    EXPECT_EQ(*right.begin(), 5001);
+}
+
+template <typename TreeT> void prefix_string_test() {
+    // Keys share long prefixes, so many comparisons are decided by the full keys
+    std::mt19937 rng(42);
+    std::vector<std::string> keys{"", "a", std::string("a\0", 2), "b"};
+    for (int i = 0; i < 600; ++i) {
+        std::string key = i % 2 ? "shared_prefix_" : "";
+        for (int len = rng() % 4; len >= 0; --len) {
+            key += static_cast<char>('a' + rng() % 3);
+        }
+        keys.push_back(key);
+    }
+
+    TreeT tree;
+    std::multiset<std::string> expected;
+    for (int i = 0; i < 3000; ++i) {
+        const std::string &key = keys[rng() % keys.size()];
+        if (i % 3 == 2) {
+            tree.erase(key);
+            if (expected.count(key)) {
+                expected.erase(expected.find(key));
+            }
+        } else {
+            tree.insert(key);
+            expected.insert(key);
+        }
+    }
+    EXPECT_TRUE(tree.validate());
+    ASSERT_EQ(tree.size(), expected.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+    for (const std::string &key : keys) {
+        EXPECT_EQ(tree.contains(key), expected.count(key) != 0) << key;
+        EXPECT_EQ(tree.count_in_range(key, key + "b"),
+                  std::distance(expected.lower_bound(key), expected.upper_bound(key + "b")));
+    }
+    // Unsorted batch is searched in the interleaved groups
+    std::vector<char> contained(keys.size());
+    tree.contains_batch(keys.begin(), keys.end(), contained.begin());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(contained[i] != 0, expected.count(keys[i]) != 0) << keys[i];
+    }
+
+    // Bound isn't a key, but shares the prefix with many of them
+    auto [left, right] = tree.split("shared_prefix_b~");
+    EXPECT_TRUE(std::equal(left.begin(), left.end(), expected.begin(), expected.lower_bound("shared_prefix_b~")));
+    EXPECT_TRUE(std::equal(right.begin(), right.end(), expected.lower_bound("shared_prefix_b~"), expected.end()));
+}
+
+TEST(PrefixTreeNode_tests, string_test) {
+    prefix_string_test<RedBlackTree<std::string, std::less<std::string>, NewDeleteAllocator, PrefixTreeNode<std::string>>>();
+    prefix_string_test<RedBlackTree<std::string, StringCompare, PoolAllocator, PrefixTreeNode<std::string>>>();
+    prefix_string_test<RedBlackTree<std::string, StringCompare>>();
+}
+
+TEST(PrefixTreeNode_tests, three_way_test) {
+    static_assert(IsThreeWay<StringCompare, std::string, std::string>::value);
+    static_assert(!IsThreeWay<std::less<std::string>, std::string, std::string>::value);
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(std::to_string(i));
+    }
+    // Set operations split one tree by every key of the other, telling equal keys apart
+    RedBlackTree<std::string> two_way(keys.begin(), keys.end());
+    RedBlackTree<std::string> two_way_other(keys.begin() + 500, keys.end());
+    RedBlackTree<std::string, StringCompare> three_way(keys.begin(), keys.end());
+    RedBlackTree<std::string, StringCompare> three_way_other(keys.begin() + 500, keys.end());
+    TreeStats before = stats();
+    two_way.intersect_with(two_way_other);
+    TreeStats middle = stats();
+    three_way.intersect_with(three_way_other);
+    TreeStats after = stats();
+    EXPECT_EQ(two_way.size(), 500);
+    EXPECT_EQ(three_way.size(), 500);
+    if (StatsEnabled) {
+        EXPECT_LT((after - middle).m_comparisons, (middle - before).m_comparisons);
+    }
+}
+
+TEST(PersistentTree_tests, random_test) { random_insert_erase_test<PersistentRedBlackTree<int>>(500); }
+
+TEST(PersistentTree_tests, snapshot_test) {
+    std::mt19937 rng(42);
+    PersistentRedBlackTree<int> tree;
+    std::multiset<int> expected;
+    std::vector<std::pair<PersistentRedBlackTree<int>, std::multiset<int>>> snapshots;
+
+    for (int i = 0; i < 3000; ++i) {
+        int key = rng() % 1000;
+        if (rng() % 3 == 0) {
+            tree.erase(key);
+            if (expected.count(key)) {
+                expected.erase(expected.find(key));
+            }
+        } else {
+            tree.insert(key);
+            expected.insert(key);
+        }
+        if (i % 500 == 0) {
+            snapshots.emplace_back(tree.snapshot(), expected);
+        }
+    }
+
+    expect_same_keys(tree, expected, 1000);
+    for (auto &[snapshot, snapshot_expected] : snapshots) {
+        expect_same_keys(snapshot, snapshot_expected, 1000);
+    }
+}
+
+TEST(PersistentTree_tests, split_join_test) {
+    std::vector<int> keys(10000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = i;
+    }
+    PersistentRedBlackTree<int> tree(keys.begin(), keys.end());
+
+    auto [left, right] = tree.split(5000);
+    EXPECT_EQ(tree.size(), 10000);
+    EXPECT_EQ(left.size(), 5000);
+    EXPECT_EQ(right.size(), 5000);
+    EXPECT_EQ(*right.begin(), 5000);
+    EXPECT_EQ(tree.rank(5000), 5000);
+    EXPECT_EQ(tree.select(7000), 7000);
+
+    right.erase(5000);
+    left.join(right);
+    EXPECT_EQ(left.size(), 9999);
+    EXPECT_FALSE(left.contains(5000));
+    EXPECT_TRUE(tree.contains(5000));
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), keys.begin(), keys.end()));
+}
+
+TEST(PersistentTree_tests, concurrent_readers_test) {
+    std::vector<int> keys(2000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = i;
+    }
+    PersistentRedBlackTree<int> tree(keys.begin(), keys.end());
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([snapshot = tree.snapshot(), &keys] {
+            for (int j = 0; j < 20; ++j) {
+                EXPECT_TRUE(std::equal(snapshot.begin(), snapshot.end(), keys.begin(), keys.end()));
+            }
+        });
+    }
+    for (int key = 0; key < 2000; ++key) {
+        tree.erase(key);
+        tree.insert(key + 2000);
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(tree.size(), 2000);
+    EXPECT_EQ(*tree.begin(), 2000);
+}
+
+TEST(ConcurrentTree_tests, random_test) {
+    std::mt19937 rng(42);
+    ConcurrentRedBlackTree<int> tree;
+    std::multiset<int> expected;
+    for (int i = 0; i < 2000; ++i) {
+        int key = rng() % 500;
+        if (rng() % 3 == 0) {
+            tree.erase(key);
+            if (expected.count(key)) {
+                expected.erase(expected.find(key));
+            }
+        } else {
+            tree.insert(key);
+            expected.insert(key);
+        }
+    }
+
+    EXPECT_EQ(tree.size(), expected.size());
+    expect_same_keys(tree.snapshot(), expected, 500);
+}
+
+TEST(ConcurrentTree_tests, readers_writer_test) {
+    ConcurrentRedBlackTree<int> tree;
+    for (int key = 0; key < 1000; key += 2) {
+        tree.insert(key);
+    }
+
+    // Writer moves even keys up one by one and never touches odd ones
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&tree, &done] {
+            while (!done) {
+                size_t size = tree.size();
+                EXPECT_TRUE(size == 500 || size == 501) << "size = " << size;
+                EXPECT_FALSE(tree.contains(1));
+                PersistentRedBlackTree<int> snapshot = tree.snapshot();
+                EXPECT_EQ(std::distance(snapshot.begin(), snapshot.end()), snapshot.size());
+            }
+        });
+    }
+    for (int key = 0; key < 1000; key += 2) {
+        tree.insert(key + 1000);
+        tree.erase(key);
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(tree.size(), 500);
+    EXPECT_FALSE(tree.contains(998));
+    EXPECT_TRUE(tree.contains(1998));
+}
+
+TEST(ShardedTree_tests, random_test) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, 1000);
+    std::vector<int> keys(2000);
+    std::generate(keys.begin(), keys.end(), [&] { return key_dist(rng); });
+    ShardedTree<int> tree(4, keys.begin(), keys.end());
+    std::multiset<int> expected(keys.begin(), keys.end());
+    EXPECT_EQ(tree.shard_count(), 4);
+
+    // All new keys go to the last shard, so it is skewed, until keys are moved out of it
+    for (int key = 1000; key < 6000; ++key) {
+        tree.insert(key);
+        expected.insert(key);
+        if (key % 3 == 0) {
+            int erased = key_dist(rng);
+            tree.erase(erased);
+            auto it = expected.find(erased);
+            if (it != expected.end()) {
+                expected.erase(it);
+            }
+        }
+    }
+    tree.rebalance();
+    std::vector<size_t> sizes = tree.shard_sizes();
+    EXPECT_EQ(std::accumulate(sizes.begin(), sizes.end(), size_t(0)), expected.size());
+    for (size_t shard_size : sizes) {
+        EXPECT_LE(shard_size, expected.size() / sizes.size() + 1);
+    }
+
+    std::vector<int> actual;
+    tree.for_each([&actual](int key) { actual.push_back(key); });
+    EXPECT_EQ(tree.size(), expected.size());
+    EXPECT_TRUE(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+    for (int key = 0; key < 1000; key += 7) {
+        EXPECT_EQ(tree.contains(key), expected.count(key) != 0);
+        int high = key + key_dist(rng) * 5;
+        std::vector<int> range;
+        tree.for_each_in_range(key, high, [&range](int key) { range.push_back(key); });
+        EXPECT_TRUE(std::equal(range.begin(), range.end(), expected.lower_bound(key), expected.upper_bound(high)));
+        EXPECT_EQ(tree.count_in_range(key, high), range.size());
+    }
+}
+
+TEST(ShardedTree_tests, equal_keys_test) {
+    std::vector<int> keys(4000);
+    std::iota(keys.begin(), keys.end(), 0);
+    ShardedTree<int> tree(4, keys.begin(), keys.end());
+    std::multiset<int> expected(keys.begin(), keys.end());
+
+    // Run of the equal keys starts the third shard, so no bound inside it leaves the keys on its left
+    for (int i = 0; i < 20000; ++i) {
+        tree.insert(2000);
+        expected.insert(2000);
+    }
+    tree.rebalance();
+    std::vector<size_t> sizes = tree.shard_sizes();
+    ASSERT_EQ(sizes.size(), 4);
+    EXPECT_EQ(std::accumulate(sizes.begin(), sizes.end(), size_t(0)), expected.size());
+    // Shards keep at least one key, the run isn't split between the shards
+    for (size_t shard_size : sizes) {
+        EXPECT_GT(shard_size, 0);
+    }
+    EXPECT_EQ(*std::max_element(sizes.begin(), sizes.end()), 20001);
+    EXPECT_EQ(tree.count_in_range(2000, 2000), 20001);
+
+    // Shard of only the equal keys stays as it is
+    ShardedTree<int> equal(std::vector<int>{10});
+    for (int i = 0; i < 5000; ++i) {
+        equal.insert(20);
+    }
+    EXPECT_EQ(equal.shard_sizes(), std::vector<size_t>({0, 5000}));
+
+    std::vector<int> actual;
+    tree.for_each([&actual](int key) { actual.push_back(key); });
+    EXPECT_TRUE(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+    for (int key = 0; key < 4000; key += 7) {
+        EXPECT_TRUE(tree.contains(key));
+        size_t count = std::distance(expected.lower_bound(key), expected.upper_bound(key + 100));
+        EXPECT_EQ(tree.count_in_range(key, key + 100), count);
+    }
+}
+
+TEST(ShardedTree_tests, writers_test) {
+    ShardedTree<int> tree(std::vector<int>{2500, 5000, 7500});
+
+    // Every writer has its own range, so it runs on its own shard, until the rebalancing moves the bounds
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 4; ++i) {
+        writers.emplace_back([&tree, i] {
+            for (int key = i * 2500; key < i * 2500 + 2500; ++key) {
+                tree.insert(key);
+                tree.insert(key + 10000);
+                tree.erase(key);
+            }
+        });
+    }
+    std::vector<int> counts;
+    while (counts.size() < 100) {
+        counts.push_back(tree.count_in_range(10000, 20000));
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+
+    EXPECT_EQ(tree.size(), 10000);
+    EXPECT_TRUE(std::is_sorted(counts.begin(), counts.end()));
+    std::vector<int> keys;
+    tree.for_each([&keys](int key) { keys.push_back(key); });
+    std::vector<int> expected(10000);
+    std::iota(expected.begin(), expected.end(), 10000);
+    EXPECT_EQ(keys, expected);
+    tree.rebalance();
+    for (size_t shard_size : tree.shard_sizes()) {
+        EXPECT_EQ(shard_size, 2500);
+    }
+}
+
+void batch_test(Execution execution, int size) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, 4 * size);
+    RedBlackTree<int, std::less<int>, PoolAllocator> tree;
+    std::set<int> expected;
+
+    for (int round = 0; round < 4; ++round) {
+        std::vector<int> inserted(size);
+        std::generate(inserted.begin(), inserted.end(), [&] { return key_dist(rng); });
+        tree.insert_batch(inserted.begin(), inserted.end(), execution);
+        expected.insert(inserted.begin(), inserted.end());
+
+        std::vector<int> erased(size / 2);
+        std::generate(erased.begin(), erased.end(), [&] { return key_dist(rng); });
+        tree.erase_batch(erased.begin(), erased.end(), execution);
+        for (int key : erased) {
+            expected.erase(key);
+        }
+
+        EXPECT_EQ(tree.size(), expected.size());
+        EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+    }
+    EXPECT_EQ(tree.rank(2 * size), std::distance(expected.begin(), expected.lower_bound(2 * size)));
+}
+
+TEST(BatchOperations_tests, sequential_test) { batch_test(Execution::Sequential, 3000); }
+
+TEST(BatchOperations_tests, parallel_test) { batch_test(Execution::Parallel, 20000); }
+
+TEST(BatchOperations_tests, small_batch_test) {
+    std::vector<int> keys(10000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = 2 * i;
+    }
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+
+    std::vector<int> batch{7, 3, 7, 4, 19999, 20001};
+    tree.insert_batch(batch.begin(), batch.end());
+    EXPECT_EQ(tree.size(), 10004);
+    EXPECT_EQ(tree.count_in_range(3, 4), 2);
+
+    tree.erase_batch(batch.begin(), batch.end());
+    EXPECT_EQ(tree.size(), 9999);
+    EXPECT_FALSE(tree.contains(batch[3]));
+    EXPECT_TRUE(std::equal(tree.begin(), std::next(tree.begin(), 2), keys.begin()));
+}
+
+TEST(BatchOperations_tests, empty_batch_test) {
+    std::vector<int> keys{5, 1, 3, 3, 1};
+    RedBlackTree<int> tree;
+    tree.insert_batch(keys.begin(), keys.end());
+    EXPECT_EQ(tree.size(), 3);
+
+    std::vector<int> empty;
+    tree.insert_batch(empty.begin(), empty.end());
+    tree.erase_batch(empty.begin(), empty.end());
+    EXPECT_EQ(tree.size(), 3);
+
+    tree.erase_batch(keys.begin(), keys.end());
+    EXPECT_TRUE(tree.empty());
+}
+
+TEST(BatchLookup_tests, random_test) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 20000);
+    RedBlackTree<int> tree;
+    for (int i = 0; i < 5000; ++i) {
+        tree.insert(dist(gen));
+    }
+    std::vector<int> keys(3000);
+    for (auto &key : keys) {
+        key = dist(gen);
+    }
+
+    std::vector<int> sorted_keys = keys;
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    std::list<int> listed_keys(keys.begin(), keys.end());
+    for (auto *batch : {&keys, &sorted_keys}) {
+        std::vector<TreeNode<int> *> nodes;
+        tree.find_batch(batch->begin(), batch->end(), std::back_inserter(nodes));
+        std::vector<bool> contained;
+        tree.contains_batch(batch->begin(), batch->end(), std::back_inserter(contained));
+        ASSERT_EQ(nodes.size(), batch->size());
+        ASSERT_EQ(contained.size(), batch->size());
+        for (size_t i = 0; i < batch->size(); ++i) {
+            EXPECT_EQ(contained[i], tree.contains((*batch)[i]));
+            EXPECT_EQ(nodes[i] != nullptr, contained[i]);
+            if (nodes[i]) {
+                EXPECT_EQ(nodes[i]->get_key(), (*batch)[i]);
+            }
+        }
+    }
+
+    std::vector<bool> listed(listed_keys.size());
+    EXPECT_EQ(tree.contains_batch(listed_keys.begin(), listed_keys.end(), listed.begin()), listed.end());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(listed[i], tree.contains(keys[i]));
+    }
+
+    RedBlackTree<int> empty;
+    std::vector<bool> none(keys.size(), true);
+    empty.contains_batch(keys.begin(), keys.end(), none.begin());
+    empty.contains_batch(sorted_keys.begin(), sorted_keys.end(), none.begin());
+    EXPECT_EQ(std::count(none.begin(), none.end(), true), 0);
+}
+
+TEST(Emplace_tests, move_only_key_test) {
+    RedBlackTree<std::string> tree;
+    std::string long_key(100, 'a');
+    tree.insert(std::move(long_key));
+    auto it = tree.emplace(50, 'b');
+    EXPECT_EQ(*it, std::string(50, 'b'));
+    tree.emplace(std::string(70, 'c'));
+
+    for (int key = 0; key < 100; ++key) {
+        tree.insert(std::to_string(key));
+    }
+    // Erasing inner nodes moves keys of their successors
+    for (int key = 0; key < 100; key += 2) {
+        tree.erase(std::to_string(key));
+    }
+    EXPECT_EQ(tree.size(), 53);
+    EXPECT_TRUE(tree.contains(std::string(100, 'a')));
+    EXPECT_TRUE(tree.contains(std::string(70, 'c')));
+    EXPECT_TRUE(tree.contains("51"));
+    EXPECT_FALSE(tree.contains("50"));
+    EXPECT_TRUE(std::is_sorted(tree.begin(), tree.end()));
+}
+
+TEST(Emplace_tests, heterogeneous_lookup_test) {
+    RedBlackTree<std::string, std::less<>> tree;
+    for (int key = 0; key < 100; ++key) {
+        tree.insert(std::to_string(key));
+    }
+    std::string_view key = "42";
+    EXPECT_TRUE(tree.contains(key));
+    EXPECT_EQ(tree.find(key)->get_key(), "42");
+    EXPECT_EQ(*tree.lower_bound(std::string_view("420")), "43");
+    EXPECT_EQ(*tree.upper_bound(key), "43");
+    tree.erase(key);
+    EXPECT_FALSE(tree.contains(key));
+    EXPECT_EQ(tree.size(), 99);
+}
+
+TEST(FingerSearch_tests, sequential_test) {
+    RedBlackTree<int> tree;
+    auto hint = tree.end();
+    for (int key = 0; key < 2000; ++key) {
+        hint = tree.insert(tree.end(), key);
+        EXPECT_EQ(*hint, key);
+    }
+    // Descending keys are inserted before the previous one
+    for (int key = -1; key > -2000; --key) {
+        hint = tree.insert(hint, key);
+    }
+    EXPECT_EQ(tree.size(), 3999);
+    EXPECT_TRUE(std::is_sorted(tree.begin(), tree.end()));
+    for (int key = -1999; key < 2000; key += 7) {
+        EXPECT_EQ(tree.rank(key), key + 1999);
+        EXPECT_EQ(tree.select(key + 1999)->get_key(), key);
+        EXPECT_EQ(tree.find(tree.begin(), key)->get_key(), key);
+        EXPECT_EQ(tree.find(tree.end(), key)->get_key(), key);
+    }
+    EXPECT_EQ(tree.find(hint, 2000), nullptr);
+    EXPECT_EQ(tree.find(tree.end(), -2000), nullptr);
+}
+
+TEST(FingerSearch_tests, clustered_test) {
+    RedBlackTree<int> tree;
+    std::multiset<int> expected;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> center_dist(0, 10000);
+    std::uniform_int_distribution<int> offset_dist(-20, 20);
+    for (int cluster = 0; cluster < 50; ++cluster) {
+        int center = center_dist(gen);
+        auto hint = tree.lower_bound(center);
+        for (int i = 0; i < 40; ++i) {
+            int key = center + offset_dist(gen);
+            // Last inserted node is the finger of the plain insert, hints alternate with it
+            if (i % 2) {
+                tree.insert(key);
+            } else {
+                hint = tree.insert(hint, key);
+            }
+            expected.insert(key);
+        }
+        EXPECT_EQ(tree.find(hint, center + 30) != nullptr, expected.count(center + 30) != 0);
+        EXPECT_EQ(tree.find(hint, center) != nullptr, expected.count(center) != 0);
+
+        // Erased finger is not used by the next insertion
+        int erased = *expected.begin();
+        tree.erase(erased);
+        expected.erase(expected.begin());
+    }
+    EXPECT_EQ(tree.size(), expected.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+    for (int k = 0; k < static_cast<int>(expected.size()); k += 13) {
+        EXPECT_EQ(tree.select(k)->get_key(), *std::next(expected.begin(), k));
+    }
+}
+
+TEST(FingerSearch_tests, invalidated_finger_test) {
+    RedBlackTree<int> tree;
+    for (int key = 0; key < 100; ++key) {
+        tree.insert(key);
+    }
+    tree.erase(99);
+    tree.insert(50);
+    EXPECT_EQ(tree.count_in_range(50, 50), 2);
+
+    auto [left, right] = tree.split(60);
+    left.insert(59);
+    right.insert(100);
+    tree.insert(1);
+    EXPECT_EQ(tree.size(), 1);
+    tree.clear();
+    tree.insert(2);
+
+    left.merge(right);
+    left.insert(101);
+    EXPECT_EQ(left.size(), 103);
+    EXPECT_EQ(*std::prev(left.end()), 101);
+    EXPECT_TRUE(std::is_sorted(left.begin(), left.end()));
+}
+
+TEST(RedBlackMap_tests, random_test) {
+    RedBlackMap<int, int> map;
+    std::map<int, int> expected;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 300);
+    for (int i = 0; i < 3000; ++i) {
+        int key = dist(gen);
+        switch (i % 4) {
+        case 0:
+            EXPECT_EQ(map.try_emplace(key, i).second, expected.try_emplace(key, i).second);
+            break;
+        case 1:
+            EXPECT_EQ(map.insert_or_assign(key, i).second, expected.insert_or_assign(key, i).second);
+            break;
+        case 2:
+            map[key] += i;
+            expected[key] += i;
+            break;
+        default:
+            EXPECT_EQ(map.erase(key), expected.erase(key));
+        }
+    }
+
+    ASSERT_EQ(map.size(), expected.size());
+    EXPECT_TRUE(std::equal(map.begin(), map.end(), expected.begin(), expected.end(),
+                           [](const auto &entry, const auto &pair) {
+                               return entry.first == pair.first && entry.second == pair.second;
+                           }));
+    EXPECT_EQ(map.find(-1), map.end());
+}
+
+TEST(RedBlackMap_tests, string_test) {
+    RedBlackMap<std::string, std::string> map;
+    std::string key = "key";
+    auto [it, inserted] = map.try_emplace(std::move(key), 3, 'v');
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(it->second, "vvv");
+
+    // Rvalue key is not moved from, if entry is already there
+    std::string same_key = "key";
+    EXPECT_FALSE(map.try_emplace(std::move(same_key), "other").second);
+    EXPECT_EQ(same_key, "key");
+    EXPECT_EQ(map["key"], "vvv");
+
+    map.insert_or_assign("key", "new");
+    EXPECT_EQ(map.find("key")->second, "new");
+    EXPECT_TRUE(map.contains("key"));
+    EXPECT_EQ(map.erase("key"), 1);
+    EXPECT_TRUE(map.empty());
+}
+
+TEST(RedBlackMultiset_tests, random_test) {
+    RedBlackMultiset<int> multiset;
+    std::multiset<int> expected;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 100);
+    for (int i = 0; i < 5000; ++i) {
+        int key = dist(gen);
+        switch (i % 4) {
+        case 0:
+        case 1: {
+            size_t count = i % 8;
+            EXPECT_EQ(multiset.insert(key, count) == multiset.end(), count == 0 && !expected.count(key));
+            for (size_t j = 0; j < count; ++j) {
+                expected.insert(key);
+            }
+            break;
+        }
+        case 2: {
+            auto it = expected.find(key);
+            EXPECT_EQ(multiset.erase_one(key), it != expected.end());
+            if (it != expected.end()) {
+                expected.erase(it);
+            }
+            break;
+        }
+        default:
+            if (i % 16 == 3) {
+                EXPECT_EQ(multiset.erase_all(key), expected.erase(key));
+            }
+        }
+        ASSERT_TRUE(multiset.validate()) << "i = " << i;
+    }
+
+    EXPECT_TRUE(multiset.validate());
+    EXPECT_EQ(multiset.size(), expected.size());
+    EXPECT_EQ(multiset.distinct_size(), std::set<int>(expected.begin(), expected.end()).size());
+    for (int key = -1; key <= 101; ++key) {
+        EXPECT_EQ(multiset.count(key), expected.count(key)) << "key = " << key;
+        EXPECT_EQ(multiset.count_in_range(key, key + 10),
+                  std::distance(expected.lower_bound(key), expected.upper_bound(key + 10)));
+    }
+    EXPECT_EQ(multiset.count_in_range(50, 40), 0);
+}
+
+TEST(RedBlackMultiset_tests, split_join_merge_test) {
+    RedBlackMultiset<int> multiset;
+    for (int key = 0; key < 1000; ++key) {
+        multiset.insert(key % 100);
+    }
+    EXPECT_EQ(multiset.distinct_size(), 100);
+
+    // Run of the split key goes right as a whole
+    auto [left, right] = multiset.split(30);
+    EXPECT_TRUE(multiset.empty());
+    EXPECT_EQ(left.size(), 300);
+    EXPECT_EQ(right.size(), 700);
+    EXPECT_EQ(right.count(30), 10);
+    EXPECT_EQ(right.begin()->key, 30);
+    EXPECT_TRUE(left.validate());
+    EXPECT_TRUE(right.validate());
+
+    left.join(right);
+    EXPECT_TRUE(right.empty());
+    EXPECT_EQ(left.size(), 1000);
+    EXPECT_TRUE(left.validate());
+
+    std::vector<int> keys{5, 5, 150, 99};
+    RedBlackMultiset<int> other(keys.begin(), keys.end());
+    left.merge(other);
+    EXPECT_TRUE(other.empty());
+    EXPECT_EQ(left.size(), 1004);
+    EXPECT_EQ(left.count(5), 12);
+    EXPECT_EQ(left.count(150), 1);
+    EXPECT_EQ(left.distinct_size(), 101);
+    EXPECT_TRUE(left.validate());
+}
+
+TEST(RedBlackMultiset_tests, range_merge_test) {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(0, 200);
+    for (int size : {0, 1, 100, 2000}) {
+        std::vector<int> left_keys;
+        std::vector<int> right_keys;
+        for (int i = 0; i < size; ++i) {
+            left_keys.push_back(dist(gen));
+            right_keys.push_back(dist(gen) + 100);
+        }
+        std::multiset<int> expected(left_keys.begin(), left_keys.end());
+
+        RedBlackMultiset<int> left(left_keys.begin(), left_keys.end());
+        ASSERT_TRUE(left.validate());
+        EXPECT_EQ(left.size(), expected.size());
+        EXPECT_EQ(left.distinct_size(), std::set<int>(expected.begin(), expected.end()).size());
+
+        // Counts of the keys in both multisets are summed along with the subtree counts
+        RedBlackMultiset<int> right(right_keys.begin(), right_keys.end());
+        left.merge(right);
+        expected.insert(right_keys.begin(), right_keys.end());
+        ASSERT_TRUE(left.validate());
+        EXPECT_TRUE(right.empty());
+        EXPECT_EQ(left.size(), expected.size());
+        for (int key = -1; key <= 301; key += 3) {
+            EXPECT_EQ(left.count(key), expected.count(key)) << "key = " << key;
+            EXPECT_EQ(left.count_in_range(key, key + 20),
+                      std::distance(expected.lower_bound(key), expected.upper_bound(key + 20)));
+        }
+    }
+}
+
+TEST(FrozenTree_tests, random_test) {
+    for (int size : {0, 1, 2, 7, 8, 9, 1000}) {
+        std::mt19937 gen(size);
+        std::uniform_int_distribution<int> dist(0, size);
+        std::multiset<int> expected;
+        RedBlackTree<int> tree;
+        for (int i = 0; i < size; ++i) {
+            int key = 2 * dist(gen);
+            expected.insert(key);
+            tree.insert(key);
+        }
+
+        FrozenTree<int> frozen = tree.freeze();
+        ASSERT_EQ(frozen.size(), expected.size());
+        EXPECT_TRUE(std::equal(frozen.begin(), frozen.end(), expected.begin(), expected.end()));
+        for (int key = -1; key <= 2 * size + 1; ++key) {
+            EXPECT_EQ(frozen.contains(key), expected.count(key) > 0);
+            auto lower = expected.lower_bound(key);
+            EXPECT_EQ(frozen.lower_bound(key) == frozen.end(), lower == expected.end());
+            if (lower != expected.end()) {
+                EXPECT_EQ(*frozen.lower_bound(key), *lower);
+            }
+            auto upper = expected.upper_bound(key);
+            EXPECT_EQ(frozen.upper_bound(key) == frozen.end(), upper == expected.end());
+            if (upper != expected.end()) {
+                EXPECT_EQ(*frozen.upper_bound(key), *upper);
+            }
+        }
+
+        RedBlackTree<int> thawed = frozen.thaw();
+        EXPECT_TRUE(thawed.validate());
+        expect_same_keys(thawed, expected, 2 * size + 1);
+    }
+}
+
+TEST(FrozenTree_tests, string_test) {
+    std::vector<std::string> keys{"pear", "apple", "plum", "fig"};
+    FrozenTree<std::string, std::less<>> frozen(keys.begin(), keys.end());
+    EXPECT_TRUE(frozen.contains(std::string_view("fig")));
+    EXPECT_EQ(*frozen.find("plum"), "plum");
+    EXPECT_EQ(frozen.find("kiwi"), nullptr);
+    EXPECT_EQ(*frozen.lower_bound("kiwi"), "pear");
+    EXPECT_EQ(*frozen.begin(), "apple");
+}
+
+// Keys of the tree, rendered from the frame of the trace
+std::multiset<int> rendered_keys(TraceReplay &replay, size_t frame) {
+    std::ostringstream out;
+    replay.render(frame, out);
+    std::string graph = out.str();
+    std::multiset<int> keys;
+    std::string label = "label = \"";
+    for (size_t pos = graph.find(label); pos != std::string::npos; pos = graph.find(label, pos + 1)) {
+        const char *begin = graph.c_str() + pos + label.size();
+        char *end = nullptr;
+        long key = std::strtol(begin, &end, 10);
+        if (end != begin) {
+            keys.insert(key);
+        }
+    }
+    return keys;
+}
+
+TEST(Trace_tests, replay_test) {
+    std::vector<int> keys(300);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    RedBlackTree<int> tree(keys.begin(), keys.begin() + 100);
+    tree.set_log_name("replay_test");
+    tree.enable_log();
+    for (auto it = keys.begin() + 100; it != keys.begin() + 200; ++it) {
+        tree.insert(*it);
+    }
+    std::multiset<int> inserted(tree.begin(), tree.end());
+    tree.dump_to_graphviz();
+    for (auto it = keys.begin(); it != keys.begin() + 150; it += 2) {
+        tree.erase(*it);
+    }
+    RedBlackTree<int> other(keys.begin() + 200, keys.end());
+    tree.merge(other);
+    tree.dump_to_graphviz();
+    tree.disable_log();
+
+    TraceReplay replay;
+    ASSERT_TRUE(replay.load("replay_test.trace"));
+    ASSERT_GE(replay.frames(), 3);
+    EXPECT_EQ(rendered_keys(replay, 0), std::multiset<int>(keys.begin(), keys.begin() + 100));
+    EXPECT_EQ(rendered_keys(replay, replay.frames() - 1), std::multiset<int>(tree.begin(), tree.end()));
+    // Rewinding to the earlier frame replays the trace from the start
+    size_t inserted_frame = 0;
+    while (rendered_keys(replay, inserted_frame) != inserted) {
+        ASSERT_LT(++inserted_frame, replay.frames());
+    }
+}
+
+TEST(Trace_tests, rename_test) {
+    // Name is set after the recording has started, as in main
+    std::remove("tree.trace");
+    std::vector<int> keys{1, 2, 3};
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+    tree.enable_log();
+    tree.set_log_name("rename_test");
+    for (int key = 4; key < 50; ++key) {
+        tree.insert(key);
+    }
+    tree.dump_to_graphviz();
+    std::vector<int> other_keys{-1, -2};
+    RedBlackTree<int> other(other_keys.begin(), other_keys.end());
+    other.enable_log();
+    other.set_log_name("rename_other_test");
+    other.dump_to_graphviz();
+    tree.disable_log();
+    other.disable_log();
+
+    EXPECT_FALSE(std::ifstream("tree.trace"));
+    TraceReplay replay;
+    ASSERT_TRUE(replay.load("rename_test.trace"));
+    ASSERT_GE(replay.frames(), 2);
+    EXPECT_EQ(rendered_keys(replay, 0), std::multiset<int>(keys.begin(), keys.end()));
+    EXPECT_EQ(rendered_keys(replay, replay.frames() - 1), std::multiset<int>(tree.begin(), tree.end()));
+    TraceReplay other_replay;
+    ASSERT_TRUE(other_replay.load("rename_other_test.trace"));
+    ASSERT_GE(other_replay.frames(), 1);
+    EXPECT_EQ(rendered_keys(other_replay, other_replay.frames() - 1),
+              std::multiset<int>(other_keys.begin(), other_keys.end()));
+}
+
+TEST(Trace_tests, recorder_test) {
+    {
+        TraceRecorder recorder("recorder_test.trace", 64);
+        std::vector<std::thread> threads;
+        for (uint64_t thread = 0; thread < 4; ++thread) {
+            threads.emplace_back([&recorder, thread] {
+                for (uint64_t i = 0; i < 1000; ++i) {
+                    recorder.record({TraceEvent::Type::Frame, 0, thread, i, 0});
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    TraceReplay replay;
+    ASSERT_TRUE(replay.load("recorder_test.trace"));
+    ASSERT_EQ(replay.frames(), 4000);
+    // Events of every thread keep their order
+    std::vector<uint64_t> next(4, 0);
+    for (auto &event : replay.events()) {
+        EXPECT_EQ(event.m_other, next[event.m_node]++);
+    }
+}
+
+TEST(Trace_tests, corrupt_trace_test) {
+    // Nodes are the children of each other, and the link to the missing side is ignored
+    {
+        TraceRecorder recorder("corrupt_trace_test.trace");
+        recorder.record({TraceEvent::Type::Create, 1, 1, 0, 10});
+        recorder.record({TraceEvent::Type::Create, 1, 2, 0, 20});
+        recorder.record({TraceEvent::Type::Link, 1, 1, 2, 0});
+        recorder.record({TraceEvent::Type::Link, 0, 2, 1, 0});
+        recorder.record({TraceEvent::Type::Link, 200, 2, 3, 0});
+        recorder.record({TraceEvent::Type::Root, 0, 1, 0, 0});
+        recorder.record({TraceEvent::Type::Frame, 0, 1, 0, 0});
+    }
+
+    TraceReplay replay;
+    ASSERT_TRUE(replay.load("corrupt_trace_test.trace"));
+    ASSERT_EQ(replay.frames(), 1);
+    EXPECT_EQ(rendered_keys(replay, 0), std::multiset<int>({10, 20}));
+}
+
+TEST(Image_tests, save_load_test) {
+    std::vector<int> keys(5000);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(-3000, 3000);
+    for (auto &key : keys) {
+        key = dist(gen);
+    }
+    RedBlackTree<int> tree;
+    for (int key : keys) {
+        tree.insert(key);
+    }
+    ASSERT_TRUE(tree.save("save_load_test.image"));
+
+    RedBlackTree<int> loaded;
+    loaded.insert(1);
+    ASSERT_TRUE(loaded.load("save_load_test.image"));
+    EXPECT_EQ(loaded.size(), tree.size());
+    EXPECT_TRUE(std::equal(loaded.begin(), loaded.end(), tree.begin(), tree.end()));
+    // Shape is kept, so the loaded tree is as balanced as the saved one and stays valid on changes
+    for (int key = -3000; key <= 3000; key += 101) {
+        EXPECT_EQ(loaded.rank(key), tree.rank(key));
+        loaded.insert(key);
+        loaded.erase(key + 1);
+        tree.insert(key);
+        tree.erase(key + 1);
+    }
+    EXPECT_TRUE(std::equal(loaded.begin(), loaded.end(), tree.begin(), tree.end()));
+
+    MappedTree<int> mapped;
+    ASSERT_TRUE(mapped.load("save_load_test.image"));
+    std::multiset<int> expected(keys.begin(), keys.end());
+    EXPECT_EQ(mapped.size(), expected.size());
+    EXPECT_TRUE(std::equal(mapped.begin(), mapped.end(), expected.begin(), expected.end()));
+    for (int key = -3100; key <= 3100; key += 7) {
+        EXPECT_EQ(mapped.contains(key), expected.count(key) != 0);
+        EXPECT_EQ(mapped.lower_bound(key) - mapped.begin(), std::distance(expected.begin(), expected.lower_bound(key)));
+        EXPECT_EQ(mapped.upper_bound(key) - mapped.begin(), std::distance(expected.begin(), expected.upper_bound(key)));
+    }
+
+    RedBlackTree<int> empty;
+    ASSERT_TRUE(empty.save("save_load_test.image"));
+    ASSERT_TRUE(loaded.load("save_load_test.image"));
+    EXPECT_TRUE(loaded.empty());
+    ASSERT_TRUE(mapped.load("save_load_test.image"));
+    EXPECT_EQ(mapped.begin(), mapped.end());
+}
+
+TEST(Image_tests, invalid_image_test) {
+    std::vector<int64_t> keys(100);
+    std::iota(keys.begin(), keys.end(), 0);
+    RedBlackTree<int64_t> tree(keys.begin(), keys.end());
+    ASSERT_TRUE(tree.save("invalid_image_test.image"));
+
+    RedBlackTree<int> other_key;
+    other_key.insert(1);
+    EXPECT_FALSE(other_key.load("invalid_image_test.image"));
+    EXPECT_FALSE(other_key.load("missing.image"));
+    EXPECT_EQ(other_key.size(), 1);
+
+    std::string image;
+    {
+        std::ifstream in("invalid_image_test.image", std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // Image with the field of the node replaced by value is rejected by both the tree and the mapped tree
+    auto expect_invalid = [&tree, &image](uint32_t index, size_t field_offset, auto value) {
+        std::string corrupt = image;
+        size_t offset = sizeof(ImageHeader) + index * sizeof(ImageNode<int64_t>) + field_offset;
+        std::copy_n(reinterpret_cast<const char *>(&value), sizeof(value), corrupt.begin() + offset);
+        {
+            std::ofstream out("invalid_image_test.image", std::ios::binary);
+            out << corrupt;
+        }
+        EXPECT_FALSE(tree.load("invalid_image_test.image")) << index;
+        EXPECT_EQ(tree.size(), 100);
+        MappedTree<int64_t> mapped;
+        EXPECT_FALSE(mapped.load("invalid_image_test.image")) << index;
+        EXPECT_TRUE(mapped.empty());
+    };
+    const ImageHeader *header = reinterpret_cast<const ImageHeader *>(image.data());
+    const ImageNode<int64_t> *nodes = reinterpret_cast<const ImageNode<int64_t> *>(image.data() + sizeof(ImageHeader));
+    uint32_t root = header->m_root;
+    // Left child of the node 50 points to itself
+    expect_invalid(50, offsetof(ImageNode<int64_t>, m_left), uint32_t{50});
+    // Root is red
+    expect_invalid(root, offsetof(ImageNode<int64_t>, m_black), uint8_t{0});
+    // Black height of the root doesn't match its children
+    expect_invalid(root, offsetof(ImageNode<int64_t>, m_height), uint8_t(nodes[root].m_height + 1));
+    // Red leaf turned black changes the black height of its paths
+    uint32_t red_leaf = 0;
+    while (nodes[red_leaf].m_black || nodes[red_leaf].m_left != NoImageNode) {
+        ASSERT_LT(++red_leaf, 100);
+    }
+    expect_invalid(red_leaf, offsetof(ImageNode<int64_t>, m_black), uint8_t{1});
+    // Its parent turned red has the red child
+    uint32_t parent = red_leaf == 0 ? 1 : red_leaf - 1;
+    if (nodes[parent].m_right != red_leaf) {
+        parent = red_leaf + 1;
+    }
+    ASSERT_TRUE(nodes[parent].m_left == red_leaf || nodes[parent].m_right == red_leaf);
+    expect_invalid(parent, offsetof(ImageNode<int64_t>, m_black), uint8_t{0});
+}
+
+// Keys of the range, joined in the order of the monoid, so that aggregate checks order of the keys too
+struct ConcatAugmentation {
+    using value_type = std::string;
+    static std::string identity() { return ""; }
+    static std::string lift(int key) { return std::to_string(key) + ","; }
+    static std::string combine(const std::string &lhs, const std::string &rhs) { return lhs + rhs; }
+};
+
+template <typename TreeT, typename Augmentation>
+void check_aggregates(const TreeT &tree, const std::multiset<int> &expected, int low, int high) {
+    for (int lo = low; lo <= high; lo += 37) {
+        for (int hi = lo - 10; hi <= high; hi += 53) {
+            auto aggregate = Augmentation::identity();
+            for (auto it = expected.lower_bound(lo); it != expected.end() && *it <= hi; ++it) {
+                aggregate = Augmentation::combine(aggregate, Augmentation::lift(*it));
+            }
+            ASSERT_EQ(tree.aggregate(lo, hi), aggregate) << lo << ' ' << hi;
+        }
+    }
+}
+
+TEST(Augmentation_tests, sum_test) {
+    using Sum = SumAugmentation<int64_t>;
+    using Tree = RedBlackTree<int, std::less<int>, NewDeleteAllocator, TreeNode<int, Sum>>;
+    Tree tree;
+    std::multiset<int> expected;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+    for (int i = 0; i < 3000; ++i) {
+        int key = dist(gen);
+        if (i % 3 == 2) {
+            tree.erase(key);
+            if (expected.count(key)) {
+                expected.erase(expected.find(key));
+            }
+        } else {
+            tree.insert(key);
+            expected.insert(key);
+        }
+    }
+    check_aggregates<Tree, Sum>(tree, expected, -1100, 1100);
+
+    auto [left, right] = tree.split(0);
+    EXPECT_EQ(left.aggregate(-1000, 1000), std::accumulate(expected.begin(), expected.lower_bound(0), int64_t{0}));
+    left.join(right);
+    Tree copy(left);
+    check_aggregates<Tree, Sum>(copy, expected, -1100, 1100);
+
+    std::vector<int> batch{-2000, 5, 7, 2000};
+    copy.insert_batch(batch.begin(), batch.end());
+    for (int key : batch) {
+        if (!expected.count(key)) {
+            expected.insert(key);
+        }
+    }
+    check_aggregates<Tree, Sum>(copy, expected, -2100, 2100);
+
+    ASSERT_TRUE(copy.save("sum_test.image"));
+    Tree loaded;
+    ASSERT_TRUE(loaded.load("sum_test.image"));
+    check_aggregates<Tree, Sum>(loaded, expected, -2100, 2100);
+}
+
+TEST(Augmentation_tests, order_test) {
+    using Tree = RedBlackTree<int, std::less<int>, NewDeleteAllocator, TreeNode<int, ConcatAugmentation>>;
+    std::vector<int> keys(300);
+    std::iota(keys.begin(), keys.end(), 0);
+    Tree tree(keys.begin(), keys.end());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    std::multiset<int> expected(keys.begin(), keys.end());
+    // Rotations of the fixups keep the order of the aggregates too
+    for (int i = 0; i < 150; ++i) {
+        tree.erase(keys[i]);
+        expected.erase(keys[i]);
+        tree.insert(keys[i] + 1000);
+        expected.insert(keys[i] + 1000);
+    }
+    check_aggregates<Tree, ConcatAugmentation>(tree, expected, -10, 1310);
+
+    using Max = MaxAugmentation<int>;
+    RedBlackTree<int, std::less<int>, NewDeleteAllocator, TreeNode<int, Max>> max_tree(keys.begin(), keys.end());
+    EXPECT_EQ(max_tree.aggregate(10, 20), 20);
+    EXPECT_EQ(max_tree.aggregate(400, 500), Max::identity());
+}
+
+TEST(Augmentation_tests, map_test) {
+    RedBlackMap<int, int, std::less<int>, NewDeleteAllocator, SumAugmentation<int64_t>> map;
+    std::map<int, int> expected;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 300);
+    for (int i = 0; i < 3000; ++i) {
+        int key = dist(gen);
+        switch (i % 3) {
+        case 0:
+            map.try_emplace(key, i);
+            expected.try_emplace(key, i);
+            break;
+        case 1:
+            map.insert_or_assign(key, i);
+            expected.insert_or_assign(key, i);
+            break;
+        default:
+            map.erase(key);
+            expected.erase(key);
+        }
+        if (i % 100 == 0) {
+            int low = dist(gen);
+            int64_t sum = 0;
+            for (auto it = expected.lower_bound(low); it != expected.end() && it->first <= low + 50; ++it) {
+                sum += it->second;
+            }
+            EXPECT_EQ(map.aggregate(low, low + 50), sum);
+        }
+    }
+}
+
+// Intervals of the vector, that overlap [low, high], in the order of the tree
+std::vector<Interval<int>> overlapping_intervals(std::vector<Interval<int>> intervals, int low, int high) {
+    intervals.erase(std::remove_if(intervals.begin(), intervals.end(),
+                                   [low, high](const Interval<int> &interval) { return !interval.overlaps(low, high); }),
+                    intervals.end());
+    std::sort(intervals.begin(), intervals.end(), IntervalOrder<int>());
+    return intervals;
+}
+
+TEST(IntervalTree_tests, random_test) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> start_dist(0, 10000);
+    std::uniform_int_distribution<int> length_dist(0, 300);
+    std::vector<Interval<int>> intervals;
+    for (int i = 0; i < 2000; ++i) {
+        int low = start_dist(gen);
+        intervals.push_back({low, low + length_dist(gen)});
+    }
+    IntervalTree<int> tree(intervals.begin(), intervals.begin() + 1000);
+    for (auto it = intervals.begin() + 1000; it != intervals.end(); ++it) {
+        tree.insert(*it);
+    }
+    for (int i = 0; i < 500; ++i) {
+        tree.erase(intervals.back());
+        intervals.pop_back();
+    }
+    EXPECT_EQ(tree.size(), intervals.size());
+
+    for (int low = -50; low < 10500; low += 97) {
+        int high = low + length_dist(gen);
+        EXPECT_EQ(tree.overlapping(low, high), overlapping_intervals(intervals, low, high));
+        const Interval<int> *containing = tree.find_containing(low);
+        if (containing) {
+            EXPECT_TRUE(containing->overlaps(low, low));
+            EXPECT_TRUE(tree.contains(*containing));
+        } else {
+            EXPECT_TRUE(overlapping_intervals(intervals, low, low).empty());
+        }
+    }
+}
+
+TEST(IntervalTree_tests, split_join_test) {
+    std::vector<Interval<int>> intervals;
+    for (int i = 0; i < 1000; ++i) {
+        intervals.push_back({i * 10, i * 10 + (i % 7) * 40});
+    }
+    IntervalTree<int> tree(intervals.begin(), intervals.end());
+
+    auto [left, right] = tree.split(5000);
+    EXPECT_EQ(left.size(), 500);
+    EXPECT_EQ(right.size(), 500);
+    EXPECT_EQ(left.overlapping(5000, 5100), overlapping_intervals({intervals.begin(), intervals.begin() + 500}, 5000, 5100));
+    EXPECT_EQ(right.overlapping(4000, 5010), overlapping_intervals({intervals.begin() + 500, intervals.end()}, 4000, 5010));
+    EXPECT_EQ(right.find_containing(4999), nullptr);
+
+    left.join(right);
+    EXPECT_TRUE(right.empty());
+    EXPECT_EQ(left.size(), 1000);
+    EXPECT_EQ(left.overlapping(4900, 5100), overlapping_intervals(intervals, 4900, 5100));
+    EXPECT_TRUE(std::equal(left.begin(), left.end(), intervals.begin(), intervals.end()));
+}
+
+TEST(Stats_tests, counters_test) {
+    TreeStats before = stats();
+    {
+        RedBlackTree<int> tree;
+        for (int key = 0; key < 1000; ++key) {
+            tree.insert((key * 7919) % 1000);
+        }
+        TreeStats inserted = stats() - before;
+        EXPECT_GE(inserted.m_comparisons, 1000);
+        EXPECT_GT(inserted.m_rotations, 0);
+        EXPECT_GT(inserted.m_recolors, 0);
+        EXPECT_GT(inserted.m_insert_fixups, 0);
+        EXPECT_EQ(inserted.m_live_nodes - before.m_live_nodes, 1000);
+        EXPECT_EQ(inserted.m_allocated_bytes - before.m_allocated_bytes, 1000 * sizeof(TreeNode<int>));
+
+        for (int key = 0; key < 1000; key += 2) {
+            tree.erase(key);
+        }
+        TreeStats erased = stats() - before;
+        EXPECT_GT(erased.m_erase_fixups, 0);
+        EXPECT_EQ(erased.m_live_nodes - before.m_live_nodes, 500);
+
+        auto [left, right] = tree.split(501);
+        left.join(right);
+        TreeStats joined = stats();
+        EXPECT_GT(joined.m_split_depth, 0);
+        EXPECT_GT(joined.m_join_depth, 0);
+        EXPECT_TRUE(left.validate());
+    }
+    EXPECT_EQ(stats().m_live_nodes, before.m_live_nodes);
+
+    // Pool counts its blocks, until the last tree, sharing them, is gone
+    {
+        RedBlackTree<int, std::less<int>, PoolAllocator> tree;
+        for (int key = 0; key < 1000; ++key) {
+            tree.insert(key);
+        }
+        TreeStats pooled = stats();
+        EXPECT_EQ(pooled.m_live_nodes - before.m_live_nodes, 1000);
+        EXPECT_GE(pooled.m_allocated_bytes - before.m_allocated_bytes, 1000 * sizeof(TreeNode<int>));
+    }
+    EXPECT_EQ(stats().m_live_nodes, before.m_live_nodes);
+    EXPECT_EQ(stats().m_allocated_bytes, before.m_allocated_bytes);
+
+    // Counters of the finished threads are kept
+    TreeStats threaded = stats();
+    std::thread([] {
+        RedBlackTree<int> tree;
+        tree.insert(1);
+        tree.insert(2);
+    }).join();
+    EXPECT_GE((stats() - threaded).m_comparisons, 1);
+}
+
+TEST(Stats_tests, validate_test) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, 10000);
+    RedBlackTree<int> tree;
+    EXPECT_TRUE(tree.validate());
+    for (int round = 0; round < 20; ++round) {
+        RedBlackTree<int> other;
+        for (int i = 0; i < 500; ++i) {
+            other.insert(key_dist(rng));
+            tree.erase(key_dist(rng));
+        }
+        tree.merge(other);
+        ASSERT_TRUE(tree.validate()) << round;
+    }
+
+    std::vector<int64_t> keys(100);
+    std::iota(keys.begin(), keys.end(), 0);
+    RedBlackTree<int64_t> saved(keys.begin(), keys.end());
+    ASSERT_TRUE(saved.save("validate_test.image"));
+    std::string image;
+    {
+        std::ifstream in("validate_test.image", std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // Colors are checked by load, but keys are loaded as they are
+    auto corrupted = [&image](size_t index, size_t offset, const void *value, size_t size) {
+        std::string copy = image;
+        std::copy_n(static_cast<const char *>(value), size,
+                    copy.begin() + sizeof(ImageHeader) + index * sizeof(ImageNode<int64_t>) + offset);
+        std::ofstream out("validate_test.image", std::ios::binary);
+        out << copy;
+    };
+    RedBlackTree<int64_t> loaded;
+    uint8_t flipped = !reinterpret_cast<const ImageNode<int64_t> *>(image.data() + sizeof(ImageHeader))->m_black;
+    corrupted(0, offsetof(ImageNode<int64_t>, m_black), &flipped, sizeof(flipped));
+    EXPECT_FALSE(loaded.load("validate_test.image"));
+    EXPECT_TRUE(loaded.validate());
+    int64_t key = 1000;
+    corrupted(0, offsetof(ImageNode<int64_t>, m_key), &key, sizeof(key));
+    ASSERT_TRUE(loaded.load("validate_test.image"));
+    EXPECT_FALSE(loaded.validate());
+    corrupted(0, 0, &keys[0], sizeof(keys[0]));
+    ASSERT_TRUE(loaded.load("validate_test.image"));
+    EXPECT_TRUE(loaded.validate());
+}
+
+TEST(IndexedTree_tests, random_test) {
+    random_insert_erase_test<IndexedRedBlackTree<int>>(500);
+
+    std::mt19937 rng(5);
+    IndexedRedBlackTree<int> tree;
+    for (int i = 0; i < 3000; ++i) {
+        int key = rng() % 1000;
+        rng() % 3 ? tree.insert(key) : tree.erase(key);
+        ASSERT_TRUE(tree.validate()) << "i = " << i;
+    }
+    // Freed slots are reused
+    EXPECT_LE(tree.capacity(), 2000);
+    // Colors take one byte, indices fit into 32 bits
+    EXPECT_EQ(IndexedRedBlackTree<int>::NodeBytes, 17);
+    EXPECT_LE(IndexedRedBlackTree<int>::MaxNodes, size_t{UINT32_MAX});
+}
+
+TEST(IndexedTree_tests, split_join_merge_test) {
+    for (int size : {0, 1, 10, 1000}) {
+        std::vector<int> keys(size);
+        std::iota(keys.begin(), keys.end(), 0);
+        for (int bound : {0, size / 3, size - size / 4, size}) {
+            IndexedRedBlackTree<int> tree(keys.begin(), keys.end());
+            ASSERT_TRUE(tree.validate());
+            auto [left, right] = tree.split(bound);
+            EXPECT_TRUE(tree.empty());
+            ASSERT_TRUE(left.validate());
+            ASSERT_TRUE(right.validate());
+            expect_same_keys(left, std::multiset<int>(keys.begin(), keys.begin() + bound), size);
+            expect_same_keys(right, std::multiset<int>(keys.begin() + bound, keys.end()), size);
+
+            left.join(right);
+            EXPECT_TRUE(right.empty());
+            ASSERT_TRUE(left.validate());
+            expect_same_keys(left, std::multiset<int>(keys.begin(), keys.end()), size);
+        }
+    }
+
+    IndexedRedBlackTree<int> tree;
+    IndexedRedBlackTree<int> other;
+    std::multiset<int> expected;
+    for (int key = 0; key < 3000; ++key) {
+        if (key % 3 != 0) {
+            tree.insert(key);
+            expected.insert(key);
+        }
+        if (key % 2 == 0) {
+            other.insert(key);
+            expected.insert(key);
+        }
+    }
+    // One of the equal keys is kept
+    for (int key = 0; key < 3000; key += 2) {
+        if (key % 3 != 0) {
+            expected.erase(expected.find(key));
+        }
+    }
+    tree.merge(other);
+    EXPECT_TRUE(other.empty());
+    EXPECT_TRUE(tree.validate());
+    expect_same_keys(tree, expected, 3000);
+}
+
+TEST(IndexedTree_tests, iterator_test) {
+    std::vector<int> keys{1, 3, 3, 5, 8};
+    IndexedRedBlackTree<int> tree(keys.rbegin(), keys.rend());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), keys.begin(), keys.end()));
+    EXPECT_EQ(*std::prev(tree.end()), 8);
+    EXPECT_EQ(*tree.lower_bound(3), 3);
+    EXPECT_EQ(*tree.upper_bound(3), 5);
+    EXPECT_EQ(tree.lower_bound(9), tree.end());
+    EXPECT_EQ(std::distance(tree.lower_bound(3), tree.upper_bound(3)), 2);
+
+    IndexedRedBlackTree<int> copy = tree;
+    copy.erase(3);
+    EXPECT_EQ(copy.size(), 4);
+    EXPECT_EQ(tree.size(), 5);
+    EXPECT_TRUE(copy.contains(3));
+}
+
+void filter_test(Execution execution, int size) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key_dist(0, size);
+    std::vector<int> keys(size);
+    for (int &key : keys) {
+        key = key_dist(rng);
+    }
+    RedBlackTree<int, std::less<int>, PoolAllocator> tree(keys.begin(), keys.end());
+    std::multiset<int> expected(keys.begin(), keys.end());
+
+    auto keep = [](int key) { return key % 3 != 0; };
+    EXPECT_EQ(tree.filter(keep, execution), std::count_if(keys.begin(), keys.end(), std::not_fn(keep)));
+    for (auto it = expected.begin(); it != expected.end();) {
+        it = keep(*it) ? std::next(it) : expected.erase(it);
+    }
+    EXPECT_TRUE(tree.validate());
+    expect_same_keys(tree, expected, size);
+
+    EXPECT_EQ(tree.filter([](int) { return false; }, execution), expected.size());
+    EXPECT_TRUE(tree.empty());
+    EXPECT_TRUE(tree.validate());
+}
+
+TEST(BulkOperations_tests, sequential_filter_test) { filter_test(Execution::Sequential, 3000); }
+
+TEST(BulkOperations_tests, parallel_filter_test) { filter_test(Execution::Parallel, 30000); }
+
+TEST(BulkOperations_tests, augmented_filter_test) {
+    using Sum = SumAugmentation<int64_t>;
+    using Tree = RedBlackTree<int, std::less<int>, NewDeleteAllocator, TreeNode<int, Sum>>;
+    std::vector<int> keys(2000);
+    std::iota(keys.begin(), keys.end(), -1000);
+    Tree tree(keys.begin(), keys.end());
+    tree.filter([](int key) { return key % 4 != 0; });
+    std::multiset<int> expected;
+    std::copy_if(keys.begin(), keys.end(), std::inserter(expected, expected.end()),
+                 [](int key) { return key % 4 != 0; });
+    check_aggregates<Tree, Sum>(tree, expected, -1100, 1100);
+}
+
+TEST(BulkOperations_tests, reduce_for_each_test) {
+    std::vector<int> keys(100000);
+    std::iota(keys.begin(), keys.end(), 1);
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+
+    int64_t sum = tree.parallel_reduce(
+        int64_t{0}, [](int key) { return int64_t{key}; }, std::plus<int64_t>());
+    EXPECT_EQ(sum, int64_t{100000} * 100001 / 2);
+    // Reduce keeps the order of the keys
+    RedBlackTree<int> small_tree(keys.begin(), keys.begin() + 10000);
+    std::string digits = small_tree.parallel_reduce(
+        std::string(), [](int key) { return std::to_string(key % 10); }, std::plus<std::string>());
+    ASSERT_EQ(digits.size(), small_tree.size());
+    for (size_t i = 0; i < digits.size(); ++i) {
+        ASSERT_EQ(digits[i], '0' + keys[i] % 10) << "i = " << i;
+    }
+    EXPECT_EQ(RedBlackTree<int>().parallel_reduce(7, [](int key) { return key; }, std::plus<int>()), 7);
+
+    std::atomic<int64_t> visited_sum = 0;
+    std::atomic<size_t> visited = 0;
+    tree.parallel_for_each([&](int key) {
+        visited_sum.fetch_add(key, std::memory_order_relaxed);
+        visited.fetch_add(1, std::memory_order_relaxed);
+    });
+    EXPECT_EQ(visited.load(), keys.size());
+    EXPECT_EQ(visited_sum.load(), sum);
+}
+
+TEST(BulkOperations_tests, exception_test) {
+    // Left task is finished before the exception of the right one leaves fork_join
+    bool left_done = false;
+    EXPECT_THROW(fork_join([&left_done] { left_done = true; }, [] { throw std::runtime_error("right"); }),
+                 std::runtime_error);
+    EXPECT_TRUE(left_done);
+    EXPECT_THROW(fork_join([] { throw std::logic_error("left"); }, [] {}), std::logic_error);
+
+    std::vector<int> keys(100000);
+    std::iota(keys.begin(), keys.end(), 1);
+    RedBlackTree<int> tree(keys.begin(), keys.end());
+    EXPECT_THROW(tree.parallel_for_each([](int key) {
+        if (key % 30000 == 0) {
+            throw std::runtime_error("visit");
+        }
+    }),
+                 std::runtime_error);
+    // Pool is still usable after the exception
+    int64_t sum = tree.parallel_reduce(
+        int64_t{0}, [](int key) { return int64_t{key}; }, std::plus<int64_t>());
+    EXPECT_EQ(sum, int64_t{100000} * 100001 / 2);
+}
+
+} // namespace Tests